@@ -0,0 +1,44 @@
+// Regression check of the performance corpus found by fuzz_perf: every entry
+// is timed in its mode and has to stay under its budget of nanoseconds per
+// byte. Returns 1 if any entry is over it, ctest runs it as perf_corpus.
+//
+// Usage: bench_corpus corpus
+#include "differential.h"
+#include "perf_corpus.h"
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char ** argv)
+{
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " corpus" << std::endl;
+        return 1;
+    }
+    std::vector<calc::PerfCase> corpus;
+    if (!calc::load_perf_corpus(argv[1], corpus)) {
+        return 1;
+    }
+    const auto modes = calc::modes();
+    std::size_t over = 0;
+    for (const auto & entry : corpus) {
+        const calc::Mode * mode = nullptr;
+        for (const auto & candidate : modes) {
+            mode = candidate.name == entry.mode ? &candidate : mode;
+        }
+        if (mode == nullptr) {
+            std::cerr << "Unknown mode '" << entry.mode << "'" << std::endl;
+            return 1;
+        }
+        const double time = calc::ns_per_byte(*mode, entry.current, entry.line);
+        const bool good = time <= entry.budget;
+        over += good ? 0 : 1;
+        std::cout << (good ? "ok   " : "OVER ") << std::setw(24) << std::left << entry.mode << std::right << std::fixed << std::setprecision(1) << std::setw(8)
+                  << time << " / " << std::setw(6) << entry.budget << " ns/byte  " << entry.line.substr(0, 48) << (entry.line.size() > 48 ? "..." : "")
+                  << std::endl;
+    }
+    std::cout << corpus.size() - over << " of " << corpus.size() << " entries within budget" << std::endl;
+    return over == 0 ? 0 : 1;
+}
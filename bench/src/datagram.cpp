@@ -0,0 +1,144 @@
+// Load generator of the datagram server: clients send tiny commands with a
+// window of requests in flight each and time every answer. Reports requests
+// per second and latency percentiles against an in-process DatagramServer
+// receiving one datagram per system call and a batch of them, or against a
+// running `calc_fold --datagram SOCKET`.
+//
+// Usage: bench_datagram [clients] [window] [seconds] [socket]
+#include "datagram.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+sockaddr_un address_of(const std::string & path)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+    return address;
+}
+
+struct Load
+{
+    std::size_t clients;
+    std::size_t window;
+    std::chrono::duration<double> duration;
+};
+
+// latencies of the answers in microseconds, lost ones aren't counted
+std::vector<double> run_client(const std::string & server, const std::string & path, const Load & load)
+{
+    std::vector<double> res;
+    const int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    std::remove(path.c_str());
+    const auto own = address_of(path);
+    const auto other = address_of(server);
+    if (fd < 0 || bind(fd, reinterpret_cast<const sockaddr *>(&own), sizeof(own)) != 0 || connect(fd, reinterpret_cast<const sockaddr *>(&other), sizeof(other)) != 0) {
+        std::cerr << "Can't connect to " << server << std::endl;
+        return res;
+    }
+    // a lost answer doesn't stall the client for long
+    const timeval timeout{0, 100000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    const std::string request = "+ 1";
+    std::deque<Clock::time_point> in_flight;
+    const auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(load.duration);
+    char answer[256];
+    while (Clock::now() < deadline || !in_flight.empty()) {
+        while (in_flight.size() < load.window && Clock::now() < deadline) {
+            if (send(fd, request.data(), request.size(), 0) < 0) {
+                break;
+            }
+            in_flight.push_back(Clock::now());
+        }
+        if (in_flight.empty()) {
+            // the server is gone
+            break;
+        }
+        if (recv(fd, answer, sizeof(answer), 0) < 0) {
+            // answered in order, so the oldest one is lost
+            in_flight.pop_front();
+            continue;
+        }
+        const std::chrono::duration<double, std::micro> latency = Clock::now() - in_flight.front();
+        in_flight.pop_front();
+        res.push_back(latency.count());
+    }
+    close(fd);
+    std::remove(path.c_str());
+    return res;
+}
+
+void run_load(const char * name, const std::string & server, const Load & load)
+{
+    std::vector<std::vector<double>> latencies(load.clients);
+    std::vector<std::thread> clients;
+    const auto start = Clock::now();
+    for (std::size_t k = 0; k < load.clients; ++k) {
+        clients.emplace_back([&, k] { latencies[k] = run_client(server, server + ".client" + std::to_string(k), load); });
+    }
+    for (auto & client : clients) {
+        client.join();
+    }
+    const std::chrono::duration<double> elapsed = Clock::now() - start;
+    std::vector<double> all;
+    for (const auto & part : latencies) {
+        all.insert(all.end(), part.begin(), part.end());
+    }
+    std::sort(all.begin(), all.end());
+    const auto percentile = [&all](const double p) { return all.empty() ? 0.0 : all[std::min(all.size() - 1, static_cast<std::size_t>(p * static_cast<double>(all.size())))]; };
+    std::cout << std::setw(12) << name << std::setw(12) << std::fixed << std::setprecision(0) << static_cast<double>(all.size()) / elapsed.count() << std::setprecision(1)
+              << std::setw(10) << percentile(0.5) << std::setw(10) << percentile(0.99) << std::setw(10) << percentile(0.999) << std::endl;
+}
+
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+    Load load{4, 2, std::chrono::seconds(2)};
+    if (argc > 1) {
+        load.clients = std::stoul(argv[1]);
+    }
+    if (argc > 2) {
+        load.window = std::stoul(argv[2]);
+    }
+    if (argc > 3) {
+        load.duration = std::chrono::duration<double>(std::stod(argv[3]));
+    }
+    std::cout << load.clients << " clients, " << load.window << " requests in flight each" << std::endl;
+    std::cout << std::setw(12) << "server" << std::setw(12) << "requests/s" << std::setw(10) << "p50 us" << std::setw(10) << "p99 us" << std::setw(10) << "p99.9 us" << std::endl;
+    if (argc > 4) {
+        run_load("external", argv[4], load);
+        return 0;
+    }
+    for (const std::size_t batch : {1, 64}) {
+        calc::DatagramConfig config;
+        config.socket_path = "/tmp/calc_fold_bench_datagram.sock";
+        config.batch = batch;
+        calc::DatagramServer server(config);
+        if (!server.open()) {
+            return 1;
+        }
+        std::thread serving([&] { server.run(); });
+        run_load(("batch " + std::to_string(batch)).c_str(), config.socket_path, load);
+        server.stop();
+        serving.join();
+        std::cout << std::setw(12) << "" << "  " << server.datagrams() << " datagrams in " << server.batches() << " recvmmsg calls, " << server.dropped() << " answers dropped" << std::endl;
+    }
+}
@@ -0,0 +1,77 @@
+// Cost of pulling register values through the coroutine generators against
+// a plain loop over the same Session.
+#include "evaluate.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <ranges>
+#include <string>
+#include <vector>
+
+namespace {
+
+template <class Run>
+double measure(const std::size_t count, Run run)
+{
+    double best = 1e300;
+    for (int k = 0; k < 5; ++k) {
+        const auto start = std::chrono::steady_clock::now();
+        run();
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best / count;
+}
+
+calc::Task sum(calc::AsyncGenerator<double> & values, double & res)
+{
+    while (const auto value = co_await values.next()) {
+        res += *value;
+    }
+}
+
+} // anonymous namespace
+
+int main()
+{
+    const std::vector<std::string> script = {"+ 1.5", "* 1.0001", "- 0.25", "/ 1.0002"};
+    std::vector<std::string> lines;
+    for (std::size_t n = 0; n < (1 << 20); ++n) {
+        lines.push_back(script[n % script.size()]);
+    }
+    volatile double sink = 0;
+    const auto loop = measure(lines.size(), [&] {
+        calc::Session session;
+        double res = 0;
+        for (const auto & line : lines) {
+            if (const auto current = session.feed(line)) {
+                res += *current;
+            }
+        }
+        sink = res;
+    });
+    const auto generator = measure(lines.size(), [&] {
+        double res = 0;
+        for (const double value : calc::evaluate(std::views::all(lines))) {
+            res += value;
+        }
+        sink = res;
+    });
+    const auto async = measure(lines.size(), [&] {
+        calc::LineChannel channel;
+        auto values = calc::evaluate(channel);
+        double res = 0;
+        const auto consumer = sum(values, res);
+        for (const auto & line : lines) {
+            channel.push(line);
+        }
+        channel.close();
+        sink = res;
+    });
+    static_cast<void>(sink);
+    std::cout << std::fixed << std::setprecision(2)
+              << "plain loop       " << std::setw(8) << loop << " ns/line\n"
+              << "generator        " << std::setw(8) << generator << " ns/line\n"
+              << "async generator  " << std::setw(8) << async << " ns/line (with copying lines into the channel)" << std::endl;
+}
@@ -0,0 +1,55 @@
+// A three-step formula as three one-op lines against one '= expr' line.
+#include "calc.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+template <class Run>
+double measure(const std::size_t count, Run run)
+{
+    double best = 1e300;
+    for (int k = 0; k < 5; ++k) {
+        const auto start = std::chrono::steady_clock::now();
+        run();
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best / count;
+}
+
+} // anonymous namespace
+
+int main()
+{
+    const std::size_t count = 1 << 18;
+    const calc::Options options;
+    calc::Context context;
+    const std::vector<std::string> lines = {"* 1.05", "+ 3", "/ 2"};
+    volatile double sink = 0;
+    const auto separate = measure(count, [&] {
+        double current = 1;
+        for (std::size_t n = 0; n < count; ++n) {
+            for (const auto & line : lines) {
+                current = process_line(current, line, options, context);
+            }
+        }
+        sink = current;
+    });
+    const std::string formula = "= (x * 1.05 + 3) / 2";
+    const auto expression = measure(count, [&] {
+        double current = 1;
+        for (std::size_t n = 0; n < count; ++n) {
+            current = process_line(current, formula, options, context);
+        }
+        sink = current;
+    });
+    static_cast<void>(sink);
+    std::cout << std::fixed << std::setprecision(2)
+              << "three lines  " << std::setw(8) << separate << " ns/formula\n"
+              << "expression   " << std::setw(8) << expression << " ns/formula" << std::endl;
+}
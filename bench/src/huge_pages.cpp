@@ -0,0 +1,170 @@
+// A script of folds with millions of operands from a file through the main
+// loop (LineReader and Session) with regular, transparent and explicit huge
+// pages: time, throughput and dTLB misses where perf events are allowed.
+//
+// Usage: bench_huge_pages [operands per line] [lines]
+#include "huge_pages.h"
+#include "line_reader.h"
+#include "session.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+// counts dTLB load misses of the process, -1 if perf events aren't allowed
+class TlbMisses
+{
+public:
+    TlbMisses()
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        m_fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+    ~TlbMisses()
+    {
+        if (m_fd >= 0) {
+            close(m_fd);
+        }
+    }
+    TlbMisses(const TlbMisses &) = delete;
+    TlbMisses & operator=(const TlbMisses &) = delete;
+
+    void start() const
+    {
+        if (m_fd >= 0) {
+            ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+    long long stop() const
+    {
+        long long count = -1;
+        if (m_fd >= 0) {
+            ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(m_fd, &count, sizeof(count)) != sizeof(count)) {
+                count = -1;
+            }
+        }
+        return count;
+    }
+
+private:
+    int m_fd = -1;
+};
+
+struct Run
+{
+    double ms = 1e300;
+    long long misses = -1;
+};
+
+Run run_script(const std::string & path, const calc::Options & options, const TlbMisses & tlb)
+{
+    Run best;
+    for (int k = 0; k < 3; ++k) {
+        const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return best;
+        }
+        volatile double sink = 0;
+        tlb.start();
+        const auto start = std::chrono::steady_clock::now();
+        {
+            calc::Session session(options);
+            calc::LineReader input(fd);
+            for (std::string line; input.getline(line);) {
+                if (const auto current = session.feed(line)) {
+                    sink = *current;
+                }
+            }
+        }
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        const auto misses = tlb.stop();
+        static_cast<void>(sink);
+        close(fd);
+        if (elapsed.count() < best.ms) {
+            best = {elapsed.count(), misses};
+        }
+    }
+    return best;
+}
+
+const char * policy_name(const calc::HugePages policy)
+{
+    switch (policy) {
+    case calc::HugePages::Off: return "off";
+    case calc::HugePages::Transparent: return "thp";
+    case calc::HugePages::Explicit: return "explicit";
+    }
+    return "";
+}
+
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+    const std::size_t operands = argc > 1 ? std::stoul(argv[1]) : 1 << 22;
+    const std::size_t lines = argc > 2 ? std::stoul(argv[2]) : 4;
+    const std::string path = "/tmp/calc_fold_bench_huge_pages";
+    {
+        std::mt19937_64 random(1);
+        std::ofstream out(path);
+        out << "0\n";
+        for (std::size_t n = 0; n < lines; ++n) {
+            out << (n % 2 == 0 ? "(+)" : "(-)");
+            for (std::size_t k = 0; k < operands; ++k) {
+                out << ' ' << random() % 100000 << '.' << random() % 100;
+            }
+            out << '\n';
+        }
+    }
+    std::ifstream in(path, std::ios::ate);
+    const auto bytes = static_cast<double>(in.tellg());
+    {
+        calc::set_huge_pages(calc::HugePages::Explicit);
+        const calc::PageBuffer probe(calc::huge_page_size);
+        std::cout << lines << " lines of " << operands << " operands, " << std::fixed << std::setprecision(1) << bytes / 1e6 << " MB, explicit huge pages "
+                  << (probe.explicit_pages() ? "available" : "unavailable (vm.nr_hugepages), thp instead") << std::endl;
+    }
+    const TlbMisses tlb;
+    std::cout << std::setw(10) << "engine" << std::setw(10) << "pages" << std::setw(10) << "ms" << std::setw(10) << "MB/s" << std::setw(14) << "dTLB misses" << std::endl;
+    for (const bool strict : {true, false}) {
+        calc::Options options;
+        options.strict = strict;
+        for (const auto policy : {calc::HugePages::Off, calc::HugePages::Transparent, calc::HugePages::Explicit}) {
+            calc::set_huge_pages(policy);
+            const auto res = run_script(path, options, tlb);
+            std::cout << std::setw(10) << (strict ? "strict" : "fast") << std::setw(10) << policy_name(policy) << std::setw(10) << std::setprecision(1) << res.ms
+                      << std::setw(10) << std::setprecision(0) << bytes / 1e3 / res.ms << std::setw(14);
+            if (res.misses < 0) {
+                std::cout << "n/a";
+            }
+            else {
+                std::cout << res.misses;
+            }
+            std::cout << std::endl;
+        }
+    }
+    std::remove(path.c_str());
+}
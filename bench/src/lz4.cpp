@@ -0,0 +1,90 @@
+// Reading a compressed script: lines cut straight from the decompression
+// buffers against decompressing to a file first and reading that file.
+#include "line_reader.h"
+#include "lz4.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+std::size_t count_lines(const std::string & path)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    calc::LineReader reader(fd);
+    std::size_t lines = 0;
+    for (std::string line; reader.getline(line);) {
+        ++lines;
+    }
+    close(fd);
+    return lines;
+}
+
+void decompress_to(const std::string & from, const std::string & to)
+{
+    const int fd = open(from.c_str(), O_RDONLY);
+    calc::Lz4FrameReader reader([fd](char * data, const std::size_t size) {
+        const auto n = read(fd, data, size);
+        return n > 0 ? static_cast<std::size_t>(n) : 0;
+    });
+    std::ofstream out(to, std::ios::binary);
+    for (auto chunk = reader.next(); !chunk.empty(); chunk = reader.next()) {
+        out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+    }
+    close(fd);
+}
+
+template <class Run>
+double measure(Run run)
+{
+    double best = 1e300;
+    for (int k = 0; k < 3; ++k) {
+        const auto start = std::chrono::steady_clock::now();
+        run();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+} // anonymous namespace
+
+int main()
+{
+    std::mt19937_64 random(1);
+    const char * ops[] = {"+ ", "- ", "* ", "/ ", "(+) 1 2 ", "(*) 1.5 "};
+    std::string text;
+    for (std::size_t n = 0; n < (1 << 21); ++n) {
+        text += ops[random() % 6];
+        text += std::to_string(random() % 100) + "\n";
+    }
+    const std::string plain = "/tmp/calc_fold_bench_script";
+    const std::string compressed = plain + ".lz4";
+    const std::string decompressed = plain + ".out";
+    std::ofstream(plain, std::ios::binary) << text;
+    const auto frame = calc::lz4_compress(text);
+    std::ofstream(compressed, std::ios::binary) << frame;
+
+    const double mb = static_cast<double>(text.size()) / 1e6;
+    std::cout << std::fixed << std::setprecision(1) << mb << " MB script, " << static_cast<double>(frame.size()) / 1e6 << " MB compressed" << std::endl;
+    const auto report = [mb](const char * name, const double seconds) {
+        std::cout << std::setw(28) << std::left << name << std::right << std::setw(8) << mb / seconds << " MB/s" << std::endl;
+    };
+    report("plain file", measure([&] { count_lines(plain); }));
+    report("streaming decompression", measure([&] { count_lines(compressed); }));
+    report("decompress to file, read", measure([&] {
+               decompress_to(compressed, decompressed);
+               count_lines(decompressed);
+           }));
+    std::remove(plain.c_str());
+    std::remove(compressed.c_str());
+    std::remove(decompressed.c_str());
+}
@@ -0,0 +1,129 @@
+// End to end: a script evaluated by Session with the results written into a
+// pipe which another thread drains, by each of the ways to write them. The
+// main loop rows read the script from a pipe with LineReader and flush the
+// way calc_fold does, when the next line isn't there yet.
+#include "line_reader.h"
+#include "output.h"
+#include "session.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+// runs write_all(fd) against a reader thread, returns ns per line
+template <class WriteAll>
+double measure(const std::size_t lines, WriteAll write_all)
+{
+    double best = 1e300;
+    for (int k = 0; k < 3; ++k) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            return 0;
+        }
+        std::thread reader([fd = fds[0]] {
+            std::vector<char> buffer(1 << 16);
+            while (read(fd, buffer.data(), buffer.size()) > 0) {
+            }
+        });
+        const auto start = std::chrono::steady_clock::now();
+        write_all(fds[1]);
+        close(fds[1]);
+        reader.join();
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        close(fds[0]);
+        best = std::min(best, elapsed.count());
+    }
+    return best / static_cast<double>(lines);
+}
+
+} // anonymous namespace
+
+int main()
+{
+    std::mt19937_64 random(1);
+    const char * ops[] = {"+ ", "- ", "* ", "/ "};
+    std::vector<std::string> script;
+    for (std::size_t n = 0; n < (1 << 21); ++n) {
+        script.push_back(ops[random() % 4] + std::to_string(random() % 100 + 1) + "." + std::to_string(random() % 10));
+    }
+    const auto run = [&](auto && write) {
+        calc::Session session;
+        for (const auto & line : script) {
+            write(*session.feed(line));
+        }
+    };
+    const auto ostream = [&](const bool endl) {
+        return [&, endl](const int fd) {
+            std::ofstream out("/dev/fd/" + std::to_string(fd));
+            run([&](const double value) {
+                out << value;
+                endl ? out << std::endl : out << '\n';
+            });
+        };
+    };
+    const auto output = [&](const bool splice) {
+        return [&, splice](const int fd) {
+            calc::Output out(fd, splice);
+            run([&](const double value) { out.write(value); });
+        };
+    };
+    std::string text;
+    for (const auto & line : script) {
+        text += line;
+        text += '\n';
+    }
+    std::size_t flushes = 0;
+    const auto main_loop = [&](const bool splice) {
+        return [&, splice](const int fd) {
+            int input_fds[2];
+            if (pipe(input_fds) != 0) {
+                return;
+            }
+            std::thread writer([&, input = input_fds[1]] {
+                for (std::size_t done = 0; done < text.size();) {
+                    const auto n = ::write(input, text.data() + done, text.size() - done);
+                    if (n <= 0) {
+                        break;
+                    }
+                    done += static_cast<std::size_t>(n);
+                }
+                close(input);
+            });
+            {
+                calc::LineReader input(input_fds[0]);
+                calc::Session session;
+                calc::Output out(fd, splice);
+                flushes = 0;
+                for (std::string line; input.getline(line);) {
+                    if (const auto current = session.feed(line)) {
+                        out.write(*current);
+                    }
+                    if (input.would_block()) {
+                        out.flush();
+                        ++flushes;
+                    }
+                }
+            }
+            writer.join();
+            close(input_fds[0]);
+        };
+    };
+    std::cout << std::fixed << std::setprecision(1)
+              << "ostream, endl     " << std::setw(8) << measure(script.size(), ostream(true)) << " ns/line\n"
+              << "ostream, '\\n'     " << std::setw(8) << measure(script.size(), ostream(false)) << " ns/line\n"
+              << "Output, write     " << std::setw(8) << measure(script.size(), output(false)) << " ns/line\n"
+              << "Output, vmsplice  " << std::setw(8) << measure(script.size(), output(true)) << " ns/line\n";
+    for (const bool splice : {false, true}) {
+        const auto time = measure(script.size(), main_loop(splice));
+        std::cout << (splice ? "main loop, vmsplice" : "main loop, write   ") << std::setw(7) << time << " ns/line, " << flushes << " flushes" << std::endl;
+    }
+}
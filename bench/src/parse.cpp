@@ -0,0 +1,243 @@
+// Operand parsers side by side before any of them replaces parse_arg():
+// the historical per-digit one, the full length fast path (Clinger /
+// Eisel-Lemire), std::from_chars, strtod and a SWAR parser of the historical
+// format, over distributions of digit counts up to max_decimal_digits with
+// and without fractions. Besides the speed each parser gets the share of
+// results bit-equal to the correctly rounded value (strtod) and to
+// parse_arg(), which a replacement has to keep for the old scripts.
+#include "number.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+// ASCII digits in the bytes of value, the first one in the lowest byte
+std::uint64_t eight_digits(std::uint64_t value)
+{
+    value -= 0x3030303030303030;
+    value = value * 10 + (value >> 8);
+    return (((value & 0x000000FF000000FF) * (100 + (1000000ULL << 32))) + (((value >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32)))) >> 32;
+}
+
+const double powers_of_ten[] = {1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10};
+
+// The historical format through SWAR: the digits are packed right-aligned
+// into 16 '0's and converted 8 at a time, the integer of at most 10 digits
+// and the power of ten are exact, so the one division rounds correctly.
+// Returns NaN on anything but digits and one '.'.
+double swar_parse(const std::string_view text)
+{
+    if (text.size() > calc::max_decimal_digits + 1) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    char digits[16];
+    std::memset(digits, '0', sizeof(digits));
+    const auto dot = text.find('.');
+    const auto integer = std::min(dot, text.size());
+    const std::size_t count = text.size() - (dot == std::string_view::npos ? 0 : 1);
+    if (count > calc::max_decimal_digits) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    std::memcpy(digits + 16 - count, text.data(), integer);
+    if (dot != std::string_view::npos) {
+        std::memcpy(digits + 16 - count + integer, text.data() + dot + 1, count - integer);
+    }
+    std::uint64_t high;
+    std::uint64_t low;
+    std::memcpy(&high, digits, 8);
+    std::memcpy(&low, digits + 8, 8);
+    // any byte outside '0'..'9' has its high nibble off 3 or its low nibble above 9
+    const auto check = [](const std::uint64_t v) { return ((v & 0xF0F0F0F0F0F0F0F0) | (((v & 0x0F0F0F0F0F0F0F0F) + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0)) == 0x3030303030303030; };
+    if (!check(high) || !check(low)) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    const auto mantissa = eight_digits(high) * 100000000 + eight_digits(low);
+    return static_cast<double>(mantissa) / powers_of_ten[count - integer];
+}
+
+struct Distribution
+{
+    const char * name;
+    std::size_t min_digits;
+    std::size_t max_digits;
+    bool fractions;
+};
+
+std::vector<std::string> make_numbers(const std::size_t count, const Distribution & distribution)
+{
+    std::mt19937_64 random(1);
+    std::vector<std::string> res;
+    for (std::size_t n = 0; n < count; ++n) {
+        const auto digits = distribution.min_digits + random() % (distribution.max_digits - distribution.min_digits + 1);
+        const auto dot = distribution.fractions ? random() % (digits + 1) : digits;
+        std::string text;
+        for (std::size_t k = 0; k < digits; ++k) {
+            if (k == dot) {
+                text += '.';
+            }
+            text += static_cast<char>('0' + random() % 10);
+        }
+        res.push_back(text);
+    }
+    return res;
+}
+
+std::vector<std::string> make_exponent_numbers(const std::size_t count, const std::size_t digits)
+{
+    std::mt19937_64 random(1);
+    std::vector<std::string> res;
+    for (std::size_t n = 0; n < count; ++n) {
+        std::string text;
+        const auto dot = random() % (digits + 1);
+        for (std::size_t k = 0; k < digits; ++k) {
+            if (k == dot) {
+                text += '.';
+            }
+            text += static_cast<char>('0' + random() % 10);
+        }
+        text += 'e' + std::to_string(static_cast<int>(random() % 600) - 300);
+        res.push_back(text);
+    }
+    return res;
+}
+
+double per_digit(const std::string & text)
+{
+    std::size_t i = 0;
+    bool good = true;
+    return calc::parse_arg(text, i, good);
+}
+
+double fast_path(const std::string & text)
+{
+    std::size_t i = 0;
+    double value = 0;
+    calc::parse_decimal(text, i, value);
+    return value;
+}
+
+// where the first significant digit is relative to the decimal point, the
+// exponent included: 1 for 1.5, 0 for 0.15, 3 for 1.5e2
+long decimal_order(const std::string_view text)
+{
+    const auto mantissa_end = std::min(text.find_first_of("eE"), text.size());
+    long exponent = 0;
+    if (mantissa_end < text.size()) {
+        const auto digits = text.substr(mantissa_end + 1);
+        const auto skip = static_cast<std::size_t>(!digits.empty() && digits[0] == '+');
+        std::from_chars(digits.data() + skip, digits.data() + digits.size(), exponent);
+    }
+    const auto point = std::min(text.find('.'), mantissa_end);
+    const auto first = text.find_first_of("123456789");
+    if (first >= mantissa_end) {
+        return exponent;
+    }
+    return exponent + (first < point ? static_cast<long>(point - first) : -static_cast<long>(first - point - 1));
+}
+
+double std_from_chars(const std::string & text)
+{
+    double value = 0;
+    if (std::from_chars(text.data(), text.data() + text.size(), value).ec == std::errc::result_out_of_range) {
+        // the value is left alone, while strtod() gives inf above the range and 0 below it
+        value = decimal_order(text) > 0 ? std::numeric_limits<double>::infinity() : 0;
+        return text[0] == '-' ? -value : value;
+    }
+    return value;
+}
+
+double std_strtod(const std::string & text)
+{
+    return std::strtod(text.c_str(), nullptr);
+}
+
+double swar(const std::string & text)
+{
+    return swar_parse(text);
+}
+
+bool same_bits(const double a, const double b)
+{
+    return std::memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+template <class Function>
+void run(const char * name, const std::vector<std::string> & numbers, Function parse, const bool legacy)
+{
+    std::size_t bytes = 0;
+    std::size_t rounded = 0;
+    std::size_t historical = 0;
+    for (const auto & text : numbers) {
+        bytes += text.size();
+        const double value = parse(text);
+        rounded += same_bits(value, std_strtod(text));
+        historical += legacy && same_bits(value, per_digit(text));
+    }
+    volatile double sink = 0;
+    double best = 1e300;
+    for (int run = 0; run < 5; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        for (const auto & text : numbers) {
+            sink = parse(text);
+        }
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    static_cast<void>(sink);
+    const auto share = [&numbers](const std::size_t n) { return 100.0 * static_cast<double>(n) / static_cast<double>(numbers.size()); };
+    std::cout << std::setw(14) << name << std::setw(12) << std::fixed << std::setprecision(2) << best / static_cast<double>(numbers.size())
+              << std::setw(12) << static_cast<double>(bytes) / best << std::setw(12) << std::setprecision(1) << share(rounded) << "%";
+    if (legacy) {
+        std::cout << std::setw(12) << share(historical) << "%";
+    }
+    std::cout << std::endl;
+}
+
+void header(const std::string & name, const bool legacy)
+{
+    std::cout << name << "\n"
+              << std::setw(14) << "parser" << std::setw(12) << "ns/number" << std::setw(12) << "bytes/ns" << std::setw(13) << "rounded" << (legacy ? "    parse_arg" : "")
+              << std::endl;
+}
+
+} // anonymous namespace
+
+int main()
+{
+    const std::size_t count = 1 << 20;
+    const Distribution distributions[] = {
+            {"1-3 digits", 1, 3, false},
+            {"1-3 digits with fractions", 1, 3, true},
+            {"1-10 digits", 1, calc::max_decimal_digits, false},
+            {"1-10 digits with fractions", 1, calc::max_decimal_digits, true},
+            {"10 digits", calc::max_decimal_digits, calc::max_decimal_digits, false},
+            {"10 digits with fractions", calc::max_decimal_digits, calc::max_decimal_digits, true},
+    };
+    for (const auto & distribution : distributions) {
+        const auto numbers = make_numbers(count, distribution);
+        header(distribution.name, true);
+        run("per-digit", numbers, per_digit, true);
+        run("fast path", numbers, fast_path, true);
+        run("from_chars", numbers, std_from_chars, true);
+        run("strtod", numbers, std_strtod, true);
+        run("swar", numbers, swar, true);
+    }
+
+    const auto full = make_exponent_numbers(count, 17);
+    header("17 digits with exponent", false);
+    run("fast path", full, fast_path, false);
+    run("from_chars", full, std_from_chars, false);
+    run("strtod", full, std_strtod, false);
+}
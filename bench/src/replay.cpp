@@ -0,0 +1,129 @@
+// Replays a capture recorded by `calc_fold --capture PATH` through a
+// Session with any calc_fold options: every line is due at its captured
+// arrival time divided by the speed, or right after the previous one with
+// --max. Reports the throughput and percentiles of the latency of a line
+// from when it was due to when its result was formatted, so a replay which
+// falls behind shows it in the latency like a real input queue would.
+//
+// Usage: bench_replay CAPTURE [--speed N | --max] [calc_fold options]
+#include "capture.h"
+#include "cli.h"
+#include "output.h"
+#include "session.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// waits until the time, sleeping while it's far and spinning the rest
+void wait_until(const Clock::time_point time)
+{
+    constexpr auto spin = std::chrono::microseconds(100);
+    for (auto now = Clock::now(); now < time; now = Clock::now()) {
+        if (time - now > 2 * spin) {
+            std::this_thread::sleep_for(time - now - spin);
+        }
+    }
+}
+
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+    const auto usage = [argv] {
+        std::cerr << "Usage: " << argv[0] << " CAPTURE [--speed N | --max] [calc_fold options]" << std::endl;
+        return 1;
+    };
+    if (argc < 2) {
+        return usage();
+    }
+    double speed = 1;
+    bool max = false;
+    std::vector<const char *> args = {argv[0]};
+    for (int i = 2; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg == "--max") {
+            max = true;
+        }
+        else if (arg == "--speed" && i + 1 < argc) {
+            char * end = nullptr;
+            speed = std::strtod(argv[++i], &end);
+            if (end == argv[i] || *end != '\0' || !(speed > 0) || std::isinf(speed)) {
+                std::cerr << "Bad speed: '" << argv[i] << "'" << std::endl;
+                return usage();
+            }
+        }
+        else {
+            args.push_back(argv[i]);
+        }
+    }
+    calc::Cli cli;
+    if (!calc::parse_cli(static_cast<int>(args.size()), args.data(), cli)) {
+        return 1;
+    }
+    std::vector<calc::CapturedLine> lines;
+    if (!calc::load_capture(argv[1], lines)) {
+        return 1;
+    }
+    std::size_t bytes = 0;
+    for (const auto & line : lines) {
+        bytes += line.line.size() + 1;
+    }
+
+    // messages of the replayed lines would only slow it down
+    auto * saved = std::cerr.rdbuf(nullptr);
+    calc::Session session(cli.options);
+    std::vector<double> latencies;
+    latencies.reserve(lines.size());
+    volatile std::size_t sink = 0;
+    const auto start = Clock::now();
+    auto due = start;
+    for (const auto & line : lines) {
+        if (max) {
+            due = Clock::now();
+        }
+        else {
+            due = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::nano>(static_cast<double>(line.time) / speed));
+            wait_until(due);
+        }
+        if (const auto current = session.feed(line.line)) {
+            char record[calc::max_record];
+            sink = static_cast<std::size_t>(calc::format_record(*current, record) - record);
+        }
+        const std::chrono::duration<double, std::micro> latency = Clock::now() - due;
+        latencies.push_back(latency.count());
+    }
+    session.finish();
+    const std::chrono::duration<double> elapsed = Clock::now() - start;
+    std::cerr.rdbuf(saved);
+    static_cast<void>(sink);
+
+    std::sort(latencies.begin(), latencies.end());
+    const auto percentile = [&latencies](const double p) {
+        return latencies.empty() ? 0.0 : latencies[std::min(latencies.size() - 1, static_cast<std::size_t>(p * static_cast<double>(latencies.size())))];
+    };
+    const double captured = lines.empty() ? 0 : static_cast<double>(lines.back().time) / 1e9;
+    std::cout << std::fixed << std::setprecision(3) << lines.size() << " lines, " << bytes << " bytes captured over " << captured << " s, replayed ";
+    if (max) {
+        std::cout << "at max speed";
+    }
+    else {
+        std::cout << "at " << speed << "x";
+    }
+    std::cout << " in " << elapsed.count() << " s\n"
+              << std::setprecision(0) << "throughput  " << static_cast<double>(lines.size()) / elapsed.count() << " lines/s, " << std::setprecision(1)
+              << static_cast<double>(bytes) / 1e6 / elapsed.count() << " MB/s\n"
+              << std::setprecision(2) << "latency us  p50 " << percentile(0.5) << "  p99 " << percentile(0.99) << "  p99.9 " << percentile(0.999) << "  max "
+              << (latencies.empty() ? 0.0 : latencies.back()) << std::endl;
+}
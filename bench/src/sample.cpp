@@ -0,0 +1,84 @@
+// Time and accuracy of the sampled '(+)' fold against the exact one over a
+// memory-mapped operand file, for a few sample sizes.
+#include "mapped_file.h"
+#include "number.h"
+#include "sample.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace {
+
+double exact_sum(const std::string_view text)
+{
+    double sum = 0;
+    for (std::size_t i = 0; i < text.size();) {
+        while (i < text.size() && (text[i] == ' ' || text[i] == '\n')) {
+            ++i;
+        }
+        double value = 0;
+        if (i < text.size() && calc::parse_decimal(text, i, value)) {
+            sum += value;
+        }
+    }
+    return sum;
+}
+
+template <class Run>
+double measure(Run run)
+{
+    double best = 1e300;
+    for (int k = 0; k < 3; ++k) {
+        const auto start = std::chrono::steady_clock::now();
+        run();
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+    const std::size_t count = argc > 1 ? std::stoul(argv[1]) : 1 << 22;
+    const std::string path = "/tmp/calc_fold_bench_sample";
+    {
+        std::mt19937_64 random(1);
+        std::ofstream out(path);
+        for (std::size_t n = 0; n < count; ++n) {
+            out << static_cast<double>(random() % 10000000) / 1000 << (n % 16 == 15 ? '\n' : ' ');
+        }
+    }
+    calc::MappedFile file;
+    if (!file.open(path)) {
+        return 1;
+    }
+    const auto text = file.data();
+    double exact = 0;
+    const auto exact_ms = measure([&] { exact = exact_sum(text); });
+    std::cout << count << " operands, " << text.size() << " bytes" << std::endl;
+    std::cout << std::setw(10) << "exact" << std::setw(10) << "" << std::setw(10) << std::fixed << std::setprecision(2) << exact_ms << " ms" << std::endl;
+    for (const auto method : {calc::Sampling::Stride, calc::Sampling::Reservoir}) {
+        for (const std::size_t samples : {1000, 10000, 100000}) {
+            calc::SampleConfig config;
+            config.method = method;
+            config.samples = samples;
+            calc::Estimate estimate;
+            const auto ms = measure([&] { calc::estimate_sum(text, config, estimate); });
+            std::cout << std::setw(10) << (method == calc::Sampling::Stride ? "stride" : "reservoir") << std::setw(10) << samples
+                      << std::setw(10) << ms << " ms" << std::setprecision(4)
+                      << "  error " << std::setw(8) << 100 * std::abs(estimate.value - exact) / exact << "%"
+                      << "  95% interval +-" << std::setw(8) << 100 * (estimate.high - estimate.low) / 2 / exact << "%"
+                      << std::setprecision(2) << std::endl;
+        }
+    }
+    file.close();
+    std::remove(path.c_str());
+}
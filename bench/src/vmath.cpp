@@ -0,0 +1,81 @@
+// The vector math kernels against libm value by value, and one line
+// applied to many registers with process_batch() against process_line()
+// register by register.
+#include "calc.h"
+#include "vmath.h"
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+template <class Run>
+double measure(const std::vector<double> & values, Run run)
+{
+    double best = 1e300;
+    for (int k = 0; k < 5; ++k) {
+        auto copy = values;
+        const auto start = std::chrono::steady_clock::now();
+        run(copy);
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best / static_cast<double>(values.size());
+}
+
+void report(const char * name, const double libm, const double lanes)
+{
+    std::cout << std::setw(24) << std::left << name << std::right << std::fixed << std::setprecision(2) << std::setw(10) << libm << std::setw(10) << lanes
+              << std::setw(9) << libm / lanes << "x" << std::endl;
+}
+
+} // anonymous namespace
+
+int main()
+{
+    std::mt19937_64 random(1);
+    std::vector<double> values(1 << 20);
+    for (auto & value : values) {
+        value = std::uniform_real_distribution<double>(0.5, 1000)(random);
+    }
+    std::cout << std::setw(24) << std::left << "ns/value" << std::right << std::setw(10) << "libm" << std::setw(10) << "lanes" << std::endl;
+    report("sqrt", measure(values, [](std::vector<double> & v) {
+               for (auto & x : v) {
+                   x = std::sqrt(x);
+               }
+           }),
+           measure(values, [](std::vector<double> & v) { calc::sqrt_lanes(v.data(), v.size()); }));
+    report("fmod by 2.75", measure(values, [](std::vector<double> & v) {
+               for (auto & x : v) {
+                   x = std::fmod(x, 2.75);
+               }
+           }),
+           measure(values, [](std::vector<double> & v) { calc::fmod_lanes(v.data(), v.size(), 2.75); }));
+    report("pow by 1.37", measure(values, [](std::vector<double> & v) {
+               for (auto & x : v) {
+                   x = std::pow(x, 1.37);
+               }
+           }),
+           measure(values, [](std::vector<double> & v) { calc::pow_lanes(v.data(), v.size(), 1.37); }));
+
+    // one line over 4096 registers
+    std::vector<double> registers(values.begin(), values.begin() + 4096);
+    for (const char * line : {"(^) 1.1 0.9 1.05", "(%) 7.5 3.25", "SQRT", "(+) 1 2 3 4"}) {
+        for (const bool strict : {true, false}) {
+            calc::Options options;
+            options.strict = strict;
+            const auto name = std::string(line) + (strict ? "" : " --fast");
+            report(name.c_str(), measure(registers, [&](std::vector<double> & v) {
+                       for (auto & x : v) {
+                           x = process_line(x, line, options);
+                       }
+                   }),
+                   measure(registers, [&](std::vector<double> & v) { process_batch(v, line, options); }));
+        }
+    }
+}
@@ -0,0 +1,121 @@
+// Command log throughput: a sync per command against group commits, both
+// for the log alone and for clients of the daemon waiting for each result,
+// and the cost of keeping the registers in the mapped register table.
+#include "registers.h"
+#include "server.h"
+#include "wal.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+const std::string log_path = "/tmp/calc_fold_bench_wal";
+const std::string socket_path = "/tmp/calc_fold_bench_wal.sock";
+
+double seconds_since(const std::chrono::steady_clock::time_point start)
+{
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+double log_rate(const std::size_t commands, const std::size_t batch)
+{
+    std::remove(log_path.c_str());
+    calc::CommandLog log;
+    log.open(log_path, [](std::string_view, std::string_view) {});
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t k = 1; k <= commands; ++k) {
+        log.append("session", "(+) 1 2 3");
+        if (k % batch == 0) {
+            log.commit();
+        }
+    }
+    log.commit();
+    return static_cast<double>(commands) / seconds_since(start);
+}
+
+double table_rate(const std::size_t stores)
+{
+    std::remove(log_path.c_str());
+    calc::RegisterTable table;
+    table.open(log_path, [](std::string_view, double) {});
+    const auto slot = table.slot("session");
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t k = 0; k < stores; ++k) {
+        table.store(slot, static_cast<double>(k));
+    }
+    return static_cast<double>(stores) / seconds_since(start);
+}
+
+// every client sends a line and waits for its result before the next one
+void client(const std::size_t commands)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    socket_path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address));
+    const std::string session = "@session " + std::to_string(fd) + "\n";
+    [[maybe_unused]] auto n = write(fd, session.data(), session.size());
+    char buffer[64];
+    for (std::size_t k = 0; k < commands; ++k) {
+        n = write(fd, "+ 1\n", 4);
+        n = read(fd, buffer, sizeof(buffer));
+    }
+    close(fd);
+}
+
+double server_rate(const std::size_t clients, const std::size_t commands, const bool logging, const std::chrono::microseconds window)
+{
+    std::remove(log_path.c_str());
+    calc::ServerConfig config;
+    config.socket_path = socket_path;
+    config.log_path = logging ? log_path : "";
+    config.commit_window = window;
+    calc::Server server(config);
+    server.open();
+    std::thread serving([&] { server.run(); });
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (std::size_t k = 0; k < clients; ++k) {
+        threads.emplace_back(client, commands);
+    }
+    for (auto & thread : threads) {
+        thread.join();
+    }
+    const double rate = static_cast<double>(clients * commands) / seconds_since(start);
+    server.stop();
+    serving.join();
+    return rate;
+}
+
+} // anonymous namespace
+
+int main()
+{
+    const auto report = [](const std::string & name, const double rate) {
+        std::cout << std::setw(36) << std::left << name << std::right << std::setw(10) << std::fixed << std::setprecision(0) << rate << " commands/s"
+                  << std::endl;
+    };
+    for (const std::size_t batch : {1, 16, 256}) {
+        report("log, " + std::to_string(batch) + " commands per sync", log_rate(2000 * batch > 200000 ? 200000 : 2000 * batch, batch));
+    }
+    report("register table stores", table_rate(10000000));
+    for (const std::size_t clients : {1, 16}) {
+        const auto name = std::to_string(clients) + " clients, ";
+        report(name + "no log", server_rate(clients, 2000, false, {}));
+        report(name + "sync per poll", server_rate(clients, 2000, true, std::chrono::microseconds(0)));
+        report(name + "1 ms commit window", server_rate(clients, 2000, true, std::chrono::microseconds(1000)));
+    }
+    std::remove(log_path.c_str());
+}
@@ -0,0 +1,34 @@
+// Differential fuzzing of every mode against the frozen reference
+// process_line(): random lines, the first divergence of each mode is
+// printed minimized with a calc_fold command reproducing it.
+//
+// Usage: fuzz_diff [lines per mode] [seed] [mode names...]
+#include "differential.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+int main(int argc, char ** argv)
+{
+    const std::size_t lines = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const std::uint64_t seed = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1;
+    int diverged = 0;
+    for (const auto & mode : calc::modes()) {
+        bool selected = argc <= 3;
+        for (int k = 3; k < argc; ++k) {
+            selected = selected || mode.name == argv[k];
+        }
+        if (!selected) {
+            continue;
+        }
+        if (const auto divergence = calc::find_divergence(mode, seed, lines)) {
+            std::cout << *divergence;
+            ++diverged;
+        }
+        else {
+            std::cout << "Mode '" << mode.name << "' agrees on " << lines << " lines" << std::endl;
+        }
+    }
+    return diverged == 0 ? 0 : 1;
+}
@@ -0,0 +1,212 @@
+// Search for lines which are slow for their size: mutations of generated
+// lines are kept when they take longer per byte than their parent or behave
+// in a new way (a new error message, a new kind of line), which stands in
+// for coverage. The worst lines of every mode are printed and, with a corpus
+// path, added to the regression corpus checked by bench_corpus.
+//
+// Usage: fuzz_perf [iterations] [seed] [corpus to update]
+#include "differential.h"
+#include "perf_corpus.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t max_line = 256;
+constexpr std::size_t max_population = 1024;
+constexpr std::size_t worst_per_mode = 2;
+// corpus budgets leave room for slower machines and noisy neighbours
+constexpr double budget_margin = 10;
+
+const char * const dictionary[] = {"(+) ", "(-) ", "(*) ", "(/) ", "(%) ", "(^) ", "= ", "sqrt(", "(", ")", "x", "^", "9999999999", "0.0000000001",
+                                   "1e308", "1e-308", " ", "\t", ".", "0", "$a", "> $a", "_", "SQRT", "-", "{", "}"};
+
+struct Candidate
+{
+    std::size_t mode;
+    double current;
+    std::string line;
+    double score; // ns per byte
+};
+
+class Fuzzer
+{
+public:
+    Fuzzer(const std::uint64_t seed)
+        : m_modes(calc::modes())
+        , m_generator(seed)
+        , m_random(seed)
+        , m_worst(m_modes.size())
+    {
+    }
+
+    void seed(const std::vector<calc::PerfCase> & corpus)
+    {
+        for (const auto & entry : corpus) {
+            for (std::size_t mode = 0; mode < m_modes.size(); ++mode) {
+                if (m_modes[mode].name == entry.mode) {
+                    consider({mode, entry.current, entry.line, 0});
+                }
+            }
+        }
+        for (std::size_t k = 0; k < 64; ++k) {
+            consider({k % m_modes.size(), m_generator.current(), m_generator.line(), 0});
+        }
+    }
+
+    void step(const std::size_t iteration)
+    {
+        const auto & parent = pick();
+        Candidate child = parent;
+        child.mode = iteration % m_modes.size();
+        for (auto mutations = 1 + m_random() % 3; mutations > 0; --mutations) {
+            mutate(child.line);
+        }
+        if (child.line.size() > max_line) {
+            child.line.resize(max_line);
+        }
+        consider(std::move(child), parent.mode == iteration % m_modes.size() ? parent.score : 0);
+    }
+
+    std::vector<calc::PerfCase> worst() const
+    {
+        std::vector<calc::PerfCase> res;
+        for (std::size_t mode = 0; mode < m_modes.size(); ++mode) {
+            for (const auto & candidate : m_worst[mode]) {
+                res.push_back({m_modes[mode].name, std::ceil(candidate.score * budget_margin), candidate.current, candidate.line});
+            }
+        }
+        return res;
+    }
+
+private:
+    const Candidate & pick()
+    {
+        // the slowest of a few random ones
+        const Candidate * best = &m_population[m_random() % m_population.size()];
+        for (int k = 0; k < 2; ++k) {
+            const auto & other = m_population[m_random() % m_population.size()];
+            best = other.score > best->score ? &other : best;
+        }
+        return *best;
+    }
+
+    void mutate(std::string & line)
+    {
+        const std::size_t at = line.empty() ? 0 : m_random() % (line.size() + 1);
+        const std::size_t length = line.empty() ? 0 : 1 + m_random() % std::min<std::size_t>(line.size(), 8);
+        switch (m_random() % 5) {
+        case 0: line.insert(at, dictionary[m_random() % std::size(dictionary)]); break;
+        case 1: line.erase(std::min(at, line.size()), length); break;
+        case 2: {
+            // repeats are what makes a short line slow per byte
+            const auto from = std::min(at, line.size());
+            const auto piece = line.substr(from, length);
+            for (auto times = 1 + m_random() % 16; times > 0; --times) {
+                line.insert(from, piece);
+            }
+            break;
+        }
+        case 3:
+            if (!line.empty()) {
+                line[m_random() % line.size()] = static_cast<char>(" .0123456789()+-*/%^_x$e"[m_random() % 24]);
+            }
+            break;
+        default: {
+            const auto & other = m_population[m_random() % m_population.size()].line;
+            line = line.substr(0, std::min(at, line.size())) + other.substr(std::min(at, other.size()));
+            break;
+        }
+        }
+    }
+
+    // behaviour class of a line in a mode: the messages without numbers,
+    // and the first char
+    std::size_t signature(const Candidate & candidate) const
+    {
+        auto messages = calc::run_captured(m_modes[candidate.mode].process, candidate.current, candidate.line).messages;
+        messages.erase(std::remove_if(messages.begin(), messages.end(), [](const char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; }),
+                       messages.end());
+        messages.resize(std::min<std::size_t>(messages.size(), 40));
+        return std::hash<std::string>()(messages + (candidate.line.empty() ? '\0' : candidate.line[0])) ^ candidate.mode;
+    }
+
+    void consider(Candidate candidate, const double parent_score = 0)
+    {
+        candidate.score = calc::ns_per_byte(m_modes[candidate.mode], candidate.current, candidate.line, 3);
+        const bool novel = m_signatures.insert(signature(candidate)).second;
+        if (!novel && candidate.score <= parent_score * 1.1) {
+            return;
+        }
+        remember(candidate);
+        if (m_population.size() == max_population) {
+            const auto slowest = std::min_element(m_population.begin(), m_population.end(), [](const auto & a, const auto & b) { return a.score < b.score; });
+            *slowest = std::move(candidate);
+        }
+        else {
+            m_population.push_back(std::move(candidate));
+        }
+    }
+
+    void remember(const Candidate & candidate)
+    {
+        auto & worst = m_worst[candidate.mode];
+        for (const auto & other : worst) {
+            if (other.line == candidate.line) {
+                return;
+            }
+        }
+        worst.push_back(candidate);
+        std::sort(worst.begin(), worst.end(), [](const auto & a, const auto & b) { return a.score > b.score; });
+        if (worst.size() > worst_per_mode) {
+            worst.pop_back();
+        }
+    }
+
+    std::vector<calc::Mode> m_modes;
+    calc::LineGenerator m_generator;
+    std::mt19937_64 m_random;
+    std::vector<Candidate> m_population;
+    std::set<std::size_t> m_signatures;
+    std::vector<std::vector<Candidate>> m_worst;
+};
+
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+    const std::size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000;
+    const std::uint64_t seed = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1;
+    std::vector<calc::PerfCase> corpus;
+    if (argc > 3 && !calc::load_perf_corpus(argv[3], corpus)) {
+        return 1;
+    }
+    Fuzzer fuzzer(seed);
+    fuzzer.seed(corpus);
+    for (std::size_t k = 0; k < iterations; ++k) {
+        fuzzer.step(k);
+    }
+    const auto worst = fuzzer.worst();
+    for (const auto & entry : worst) {
+        std::cout << entry.mode << ": " << entry.budget / budget_margin << " ns/byte, register " << entry.current << ", line '" << entry.line << "'"
+                  << std::endl;
+    }
+    if (argc > 3) {
+        for (const auto & entry : worst) {
+            const auto known = std::find_if(corpus.begin(), corpus.end(), [&](const auto & old) { return old.mode == entry.mode && old.line == entry.line; });
+            if (known == corpus.end()) {
+                corpus.push_back(entry);
+            }
+        }
+        return calc::save_perf_corpus(argv[3], corpus) ? 0 : 1;
+    }
+}
@@ -1,5 +1,157 @@
 #pragma once
 
+#include "expr.h"
+#include "ops.h"
+#include "planner.h"
+#include "variables.h"
+
+#include <cstdint>
+#include <memory>
+#include <span>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace calc {
+
+struct Options
+{
+    // strict folds are evaluated left to right exactly like a loop over the
+    // operands, otherwise the planner may pick a reassociating engine
+    bool strict = true;
+    // stop the arithmetic of a fold once the accumulator can't change any
+    // more (e.g. 0 for '*', NaN), the rest of operands is only validated
+    bool short_circuit = false;
+    // validate all operands of '/', '%' and '^' folds before computing any
+    // division, fmod or pow, so malformed lines are rejected cheaply
+    bool two_phase = false;
+    // '+', '-' and '*' folds in exact decimal fixed point instead of double,
+    // registers out of its range fall back to the floating-point evaluation
+    bool fixed_point = false;
+    // operands of any length with sign and exponent instead of the
+    // historical format of at most 10 digits (fixed-point folds keep it)
+    bool full_numbers = false;
+    Tuning tuning;
+};
+
+// State kept between the lines of a script: variables and expressions of
+// '= expr' lines, which are compiled on their first appearance and reused
+// afterwards.
+class Context
+{
+public:
+    // nullptr if the expression doesn't compile
+    const Program * program(std::string_view text);
+
+    Variables & variables() { return m_variables; }
+    const Variables & variables() const { return m_variables; }
+
+private:
+    static constexpr std::size_t max_programs = 1024;
+
+    struct Entry
+    {
+        std::string text;
+        Program program;
+    };
+
+    // keys point into the entries' text, so lookups don't allocate
+    std::unordered_map<std::string_view, std::unique_ptr<Entry>> m_programs;
+    Variables m_variables;
+};
+
+// A fold whose operands come on the following lines, one or many per line:
+//   (+) {
+//   1 2
+//   3
+//   }
+// Operands are folded into the accumulator as they arrive, so memory doesn't
+// grow with their number. Like a single-line fold it is strict and all or
+// nothing: after any error the rest of the block is skipped and the register
+// keeps its value.
+class FoldBlock
+{
+public:
+    // starts a block if the line is its header "(op) {", the operands may
+    // refer to the variables, which must outlive the block
+    bool open(double current, const std::string & line, const Options & options);
+    bool open(double current, const std::string & line, const Options & options, const Variables & variables);
+    bool active() const { return m_active; }
+    // consumes a line of an active block, returns true on the closing "}"
+    bool feed(const std::string & line);
+    // the new register value once the block is closed
+    double result() const { return m_good ? m_acc : m_current; }
+
+private:
+    Op m_op = Op::ERR;
+    double m_current = 0;
+    double m_acc = 0;
+    bool m_active = false;
+    bool m_good = true;
+    bool m_absorbed = false;
+    bool m_any_operand = false;
+    bool m_short_circuit = false;
+    bool m_full_numbers = false;
+    const Variables * m_variables = nullptr;
+};
+
+// whether the line is the "}" closing a fold block
+bool closes_block(const std::string & line);
+
+// the name of an assignment line "> $name", on a malformed name prints it
+// to std::cerr and returns an empty one
+std::string_view assigned_name(const std::string & line);
+
+// An op line parsed once to be applied to any registers, by process_batch()
+// and prepared scripts. Variables are resolved to their slots, like in a
+// Program, so applying the line looks no names up.
+struct CompiledLine
+{
+    enum class Kind
+    {
+        // op with each of args in turn, no args for a unary op
+        Ops,
+        // needs process_line() for every register: assignments and
+        // expressions
+        Dynamic,
+        // malformed, registers keep their values
+        Invalid
+    };
+
+    Kind kind = Kind::Invalid;
+    Op op = Op::ERR;
+    std::vector<double> args;
+    // the args which are variables, as their index in args and the slot
+    std::vector<std::pair<std::size_t, std::size_t>> loads;
+    // the args in decimal fixed point, of a '+', '-' or '*' fold with
+    // Options::fixed_point and no variables; args are for the registers out
+    // of its range
+    std::vector<std::int64_t> integers;
+    std::vector<std::int64_t> fractions;
+};
+
+// Parses the line, the errors which don't depend on the register are
+// printed here and make it Invalid. Variables are looked up here, an
+// unknown one is an error too.
+CompiledLine compile_line(const std::string & line, const Options & options, const Variables & variables = {});
+// Applies an Ops line to the registers with the results of process_line(),
+// the errors which depend on the register or on the values of the
+// variables the line was compiled with are printed here.
+void apply_line(const CompiledLine & line, std::span<double> registers, const Options & options, const std::vector<double> & values = {});
+
+} // namespace calc
 
 double process_line(double current, const std::string & line);
+double process_line(double current, const std::string & line, const calc::Options & options);
+double process_line(double current, const std::string & line, const calc::Options & options, calc::Context & context);
+
+// Evaluates the line for every register, with the same results as
+// process_line() register by register, but an op line is parsed once and
+// each operation is applied to all the registers at once (see vmath.h; not
+// strict folds may use the vector pow, which isn't bit-exact). Messages
+// which don't depend on the register are printed once, so is the one of an
+// unknown variable (there are none here). Assignments and expressions go
+// register by register.
+void process_batch(std::span<double> registers, const std::string & line, const calc::Options & options = {});
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace calc {
+
+// A line of the input and when it arrived, in nanoseconds since the
+// capture started.
+struct CapturedLine
+{
+    std::uint64_t time = 0;
+    std::string line;
+};
+
+// Recording of the input with its arrival times, to replay the load later
+// (bench_replay). What a read() of the input got is recorded as it is with
+// the time it came, so recording costs a clock read and a copy per read and
+// nothing per line. A line arrives with the read which got its end.
+//
+// Record: u64 nanoseconds since the capture started, u32 size, the bytes;
+// all little-endian.
+class Capture
+{
+public:
+    Capture() = default;
+    ~Capture();
+
+    Capture(const Capture &) = delete;
+    Capture & operator=(const Capture &) = delete;
+
+    // creates or truncates the file, on failure prints the reason to
+    // std::cerr and returns false
+    bool open(const std::string & path);
+
+    // the input which has just arrived
+    void add(std::string_view data);
+
+    // writes out the rest of the records, on an I/O error (now or in an
+    // earlier write) prints it to std::cerr and returns false
+    bool close();
+
+private:
+    void write_out();
+
+    int m_fd = -1;
+    std::string m_path;
+    std::string m_buffer;
+    std::chrono::steady_clock::time_point m_start;
+    int m_error = 0;
+};
+
+// Reads a capture and cuts it into lines, the last one may have no newline.
+// On failure prints the reason to std::cerr and returns false.
+bool load_capture(const std::string & path, std::vector<CapturedLine> & lines);
+
+} // namespace calc
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "calc.h"
+#include "datagram.h"
+#include "huge_pages.h"
+#include "sample.h"
+#include "server.h"
+
+#include <ostream>
+#include <string>
+
+namespace calc {
+
+struct Cli
+{
+    Options options;
+    std::string config_path; // empty means default_tuning_path()
+    std::string capture_path; // record the input lines with their arrival times to this file
+    std::string sample_path; // estimate the '(+)' fold over this file instead of running a script
+    SampleConfig sample;
+    ServerConfig server; // serve clients on server.socket_path if it's set
+    DatagramConfig datagram; // serve datagrams on datagram.socket_path if it's set
+    std::size_t line_costs = 0; // report that many most expensive lines at the end
+    HugePages huge_pages = HugePages::Off;
+    bool profile = false; // print where the CPU time went at the end
+    bool autotune = false;
+    bool help = false;
+};
+
+void print_usage(std::ostream & out, const char * program);
+
+// Parses the command line and loads the tuning config, on failure prints
+// the reason to std::cerr and returns false.
+bool parse_cli(int argc, const char * const * argv, Cli & cli);
+
+} // namespace calc
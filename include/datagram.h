@@ -0,0 +1,77 @@
+#pragma once
+
+#include "calc.h"
+#include "session.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace calc {
+
+struct DatagramConfig
+{
+    std::string socket_path;
+    // datagrams received and answered per system call
+    std::size_t batch = 64;
+    // longer datagrams are answered with "@error"
+    std::size_t max_datagram = 4096;
+    Options options;
+};
+
+// Daemon serving tiny commands over a Unix datagram socket. A datagram is
+// one or more lines of a script, evaluated in the session "default"; a line
+// "@session name" switches the session for the rest of the datagram. The
+// answer, sent back to the address of the sender, is what calc_fold would
+// print for the lines, empty if nothing. A bad session name (see
+// valid_session_name()) ends the datagram with "@error". Sessions are shared
+// by all senders and live as long as the server, nothing is logged.
+//
+// Datagrams are received with recvmmsg() and answered with sendmmsg(), up
+// to batch of them per system call, so at high request rates the cost of a
+// request is mostly its evaluation. An answer the sender has no room for is
+// dropped like any datagram.
+class DatagramServer
+{
+public:
+    explicit DatagramServer(const DatagramConfig & config);
+    ~DatagramServer();
+
+    DatagramServer(const DatagramServer &) = delete;
+    DatagramServer & operator=(const DatagramServer &) = delete;
+
+    // binds the socket, on failure prints the reason to std::cerr and returns false
+    bool open();
+    // serves until stop(), false if the socket fails
+    bool run();
+    // makes run() return, async-signal-safe
+    void stop();
+
+    // register of a session, nothing if it doesn't exist
+    std::optional<double> current(std::string_view session) const;
+
+    std::uint64_t datagrams() const { return m_datagrams; }
+    // system calls of recvmmsg() which got anything
+    std::uint64_t batches() const { return m_batches; }
+    std::uint64_t dropped() const { return m_dropped; }
+
+private:
+    void handle(std::string_view datagram, std::string & answer);
+    Session & session(std::string_view name);
+
+    DatagramConfig m_config;
+    int m_socket = -1;
+    int m_wake[2] = {-1, -1};
+    std::map<std::string, Session, std::less<>> m_sessions;
+    // scratch line for Session::feed()
+    std::string m_line;
+    std::uint64_t m_datagrams = 0;
+    std::uint64_t m_batches = 0;
+    std::uint64_t m_dropped = 0;
+};
+
+} // namespace calc
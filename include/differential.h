@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace calc {
+
+// What a mode has to share with reference::process_line().
+enum class Agreement
+{
+    Exact,    // the same bits (any NaN for a NaN) and the same messages
+    Close,    // the same messages, the value within 1e-9, relative above 1 (reassociation, decimal rounding)
+    Extends,  // Close on the lines the reference accepts (correctly rounded operands), anything on the rest (a wider syntax)
+    Messages, // only the same messages
+    Accepts,  // silent on the lines the reference accepts, anything on the rest
+};
+
+// One way of evaluating a line: a set of Options, an entry point.
+struct Mode
+{
+    std::string name;
+    std::string flags; // of calc_fold, for reproducers
+    Agreement agreement;
+    // operations whose results drift from the reference by design, lines
+    // with them only have to print the same (Messages or Accepts)
+    std::string loose;
+    std::function<double(double, const std::string &)> process;
+};
+
+// every mode of the tree, the ones with state (a Context) keep it between calls
+std::vector<Mode> modes();
+
+// result and std::cerr text of a line
+struct Outcome
+{
+    double value;
+    std::string messages;
+};
+
+// how the mode has to agree on the line
+Agreement agreement(const Mode & mode, const std::string & line);
+
+Outcome run_captured(const std::function<double(double, const std::string &)> & process, double current, const std::string & line);
+bool agrees(Agreement agreement, const Outcome & reference, const Outcome & outcome);
+
+// Random operation and fold lines, mostly well-formed with some noise in
+// them, and register values to apply them to.
+class LineGenerator
+{
+public:
+    explicit LineGenerator(std::uint64_t seed);
+
+    std::string line();
+    // Well-formed lines which take a zero register to a value worth testing:
+    // small, tiny down to subnormals, huge, infinite, NaN, with either sign.
+    std::vector<std::string> setup();
+    // where setup() takes a zero register
+    double current();
+    // whether to start a new sequence of lines from a new setup()
+    bool restart();
+
+private:
+    std::string number();
+
+    std::mt19937_64 m_random;
+};
+
+struct Divergence
+{
+    std::string mode;
+    std::string flags;
+    // lines which take a zero register to current
+    std::vector<std::string> script;
+    double current;
+    std::string line;
+    Outcome expected;
+    Outcome actual;
+};
+
+// prints the divergence and a calc_fold command reproducing it
+std::ostream & operator<<(std::ostream & out, const Divergence & divergence);
+
+// Runs sequences of generated lines through the reference and the mode, each
+// line from the register the reference left, returns the first divergence
+// with its line minimized.
+std::optional<Divergence> find_divergence(const Mode & mode, std::uint64_t seed, std::size_t lines);
+
+// Drops chars of the line while the mode still diverges on it.
+std::string minimize(const Mode & mode, double current, std::string line);
+
+} // namespace calc
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "ops.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace calc {
+
+// Ways to compute a left fold over already parsed and validated operands.
+//  * Scalar - left to right, bit-exact with the plain loop over binary()
+//  * Simd - reassociates the operands into a vectorized sum/product first,
+//    when no partial result can over- or underflow
+//  * Parallel - like Simd, but chunks are reduced on the shared executor
+//  * Rewrite - algebraic identity, e.g. (x ^ a) ^ b = x ^ (a * b) for x > 0 when
+//    no intermediate power over- or underflows
+enum class Engine
+{
+    Scalar,
+    Simd,
+    Parallel,
+    Rewrite
+};
+
+const char * engine_name(Engine engine);
+
+// Operands must be valid for the op (no zero divisors), errors aren't reported.
+double fold(Engine engine, Op op, double init, const std::vector<double> & args, std::size_t grain = 1 << 14);
+
+} // namespace calc
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "generator.h"
+#include "session.h"
+
+#include <coroutine>
+#include <deque>
+#include <istream>
+#include <optional>
+#include <ranges>
+#include <string>
+
+namespace calc {
+
+// Register values of a script, each evaluated when the consumer asks for it.
+// Lines inside a fold block yield nothing, the block yields once at its "}".
+// Lines is any range of std::string (taken by value, pass a view to share it).
+template <std::ranges::input_range Lines>
+Generator<double> evaluate(Lines lines, const Options options = {})
+{
+    Session session(options);
+    for (const auto & line : lines) {
+        if (const auto current = session.feed(line)) {
+            co_yield *current;
+        }
+    }
+    session.finish();
+}
+
+// The lines of the stream, which must outlive the generator.
+Generator<double> evaluate(std::istream & in, Options options = {});
+
+// Queue of input lines for evaluate() below, for a single thread: a reader
+// waiting for a line is resumed right inside push() or close().
+class LineChannel
+{
+public:
+    void push(std::string line);
+    void close();
+
+    // awaitable of the next line, nothing once the channel is closed and empty
+    auto next()
+    {
+        struct Next
+        {
+            LineChannel & channel;
+
+            bool await_ready() const noexcept { return !channel.m_lines.empty() || channel.m_closed; }
+            void await_suspend(const std::coroutine_handle<> reader) noexcept { channel.m_reader = reader; }
+            std::optional<std::string> await_resume()
+            {
+                if (channel.m_lines.empty()) {
+                    return std::nullopt;
+                }
+                auto line = std::move(channel.m_lines.front());
+                channel.m_lines.pop_front();
+                return line;
+            }
+        };
+        return Next{*this};
+    }
+
+private:
+    void wake();
+
+    std::deque<std::string> m_lines;
+    bool m_closed = false;
+    std::coroutine_handle<> m_reader;
+};
+
+// Same as evaluate() over lines, but suspends while the channel is empty.
+AsyncGenerator<double> evaluate(LineChannel & channel, Options options = {});
+
+} // namespace calc
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace calc {
+
+// Thread pool shared by all parallel fold engines. Embedders can replace
+// the library-wide instance with their own implementation via set_executor().
+class Executor
+{
+public:
+    using Task = std::function<void()>;
+
+    virtual ~Executor() = default;
+
+    virtual std::size_t concurrency() const = 0;
+    virtual void submit(Task task) = 0;
+};
+
+struct ExecutorConfig
+{
+    std::size_t threads = 0; // 0 means default_concurrency()
+    bool pin_threads = false;
+};
+
+class WorkStealingExecutor : public Executor
+{
+public:
+    explicit WorkStealingExecutor(const ExecutorConfig & config = {});
+    ~WorkStealingExecutor() override;
+
+    WorkStealingExecutor(const WorkStealingExecutor &) = delete;
+    WorkStealingExecutor & operator=(const WorkStealingExecutor &) = delete;
+
+    std::size_t concurrency() const override;
+    void submit(Task task) override;
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    void run(std::size_t index);
+    bool pop(std::size_t index, Task & task);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::mutex m_idle_mutex;
+    std::condition_variable m_idle;
+    std::ptrdiff_t m_pending = 0;
+    bool m_stop = false;
+    std::atomic<std::size_t> m_next{0};
+};
+
+// Number of CPUs the process may actually use: the affinity mask limited by
+// the cgroup (v2 cpu.max or v1 cfs quota) CPU bandwidth, at least 1.
+std::size_t default_concurrency();
+
+// Parses the content of a cgroup v2 cpu.max file ("max 100000" or
+// "150000 100000"), returns the number of CPUs it allows or 0 if unlimited.
+std::size_t parse_cpu_max(const std::string & cpu_max);
+
+std::shared_ptr<Executor> executor();
+void set_executor(std::shared_ptr<Executor> executor);
+
+// Calls body(begin, end) for each of the consecutive chunks of [0, n), all of
+// them grain elements long except maybe the last, and blocks until all are done. The calling thread takes
+// part in the work, so nested calls from executor tasks can't deadlock.
+void parallel_for(Executor & executor, std::size_t n, std::size_t grain, const std::function<void(std::size_t, std::size_t)> & body);
+
+} // namespace calc
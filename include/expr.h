@@ -0,0 +1,55 @@
+#pragma once
+
+#include "variables.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace calc {
+
+// Infix expression over the register compiled to stack bytecode, e.g.
+//   x * 1.05 + 3
+//   -(x - 1) ^ 2 / sqrt(x)
+// '^' binds tighter than unary '-' and is right associative, '*', '/' and
+// '%' bind tighter than '+' and '-'. Numbers are in the full format without
+// a sign (see parse_decimal()), x is the register and $name a variable.
+class Program
+{
+public:
+    enum class Code : std::uint8_t
+    {
+        CONST, // pushes the next of the constants
+        X,
+        LOAD, // pushes the variable of the next of the slots
+        ADD,
+        SUB,
+        MUL,
+        DIV,
+        REM,
+        POW,
+        NEG,
+        SQRT
+    };
+
+    // on a syntax error or an unknown variable prints it to std::cerr and
+    // returns false, variables are resolved to their slots here
+    bool compile(std::string_view text, const Variables & variables = {});
+
+    // evaluates the program for the register value and the values of the
+    // variables it was compiled with, a zero divisor or a bad SQRT argument
+    // is reported to std::cerr and makes the result false
+    bool run(double x, double & res, const std::vector<double> & values = {}) const;
+
+    const std::vector<Code> & code() const { return m_code; }
+
+private:
+    std::vector<Code> m_code;
+    std::vector<double> m_constants;
+    std::vector<std::size_t> m_slots;
+    // scratch space of run(), its size is the deepest stack of the program
+    mutable std::vector<double> m_stack;
+};
+
+} // namespace calc
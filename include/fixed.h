@@ -0,0 +1,29 @@
+#pragma once
+
+#include "ops.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace calc {
+
+// Decimal fixed-point value scaled by fixed_scale. Operands have at most
+// 10 decimal digits, so each one is exactly integer + fraction / fixed_scale
+// with both parts below fixed_scale.
+__extension__ using Fixed = __int128;
+
+constexpr std::int64_t fixed_scale = 10000000000;
+
+// Exact fixed-point form of the value, false for values which are not
+// finite, too large or have nonzero digits below 10^-10 in their shortest
+// decimal form.
+bool to_fixed(double value, Fixed & res);
+
+// Correctly rounded nearest double.
+double to_double(Fixed value);
+
+// Left fold of '+', '-' or '*' over the operands, sums are exact, products
+// are rounded half to even to 10 fractional digits. False on overflow.
+bool fixed_fold(Op op, Fixed & acc, const std::vector<std::int64_t> & integers, const std::vector<std::int64_t> & fractions);
+
+} // namespace calc
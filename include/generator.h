@@ -0,0 +1,239 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace calc {
+
+// Lazily computed sequence: the coroutine runs up to its next co_yield each
+// time the consumer advances, on the consumer's thread.
+template <class T>
+class Generator
+{
+public:
+    struct promise_type
+    {
+        const T * value = nullptr;
+        std::exception_ptr exception;
+
+        Generator get_return_object() { return Generator(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        // the yielded value lives until the coroutine is resumed
+        std::suspend_always yield_value(const T & yielded) noexcept
+        {
+            value = std::addressof(yielded);
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+    class iterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = T;
+
+        iterator() = default;
+        explicit iterator(const std::coroutine_handle<promise_type> handle)
+            : m_handle(handle)
+        {
+        }
+
+        const T & operator*() const { return *m_handle.promise().value; }
+        iterator & operator++()
+        {
+            resume(m_handle);
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+        bool operator==(std::default_sentinel_t) const { return m_handle.done(); }
+
+    private:
+        std::coroutine_handle<promise_type> m_handle;
+    };
+
+    Generator(Generator && other) noexcept
+        : m_handle(std::exchange(other.m_handle, {}))
+    {
+    }
+    Generator & operator=(Generator && other) noexcept
+    {
+        std::swap(m_handle, other.m_handle);
+        return *this;
+    }
+    ~Generator()
+    {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+
+    // starts the coroutine, so begin() may be called only once
+    iterator begin()
+    {
+        resume(m_handle);
+        return iterator(m_handle);
+    }
+    std::default_sentinel_t end() const { return {}; }
+
+private:
+    explicit Generator(const std::coroutine_handle<promise_type> handle)
+        : m_handle(handle)
+    {
+    }
+
+    static void resume(const std::coroutine_handle<promise_type> handle)
+    {
+        handle.resume();
+        if (handle.promise().exception) {
+            std::rethrow_exception(std::exchange(handle.promise().exception, {}));
+        }
+    }
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+// Generator which may also co_await, e.g. for input which isn't there yet.
+// The consumer is a coroutine too: each co_await next() runs the generator
+// up to its next value, meanwhile it may be suspended and later resumed by
+// whoever provides its input, who then continues the consumer as well.
+template <class T>
+class AsyncGenerator
+{
+public:
+    struct promise_type
+    {
+        const T * value = nullptr;
+        std::coroutine_handle<> consumer;
+        std::exception_ptr exception;
+
+        // hands control back to the consumer waiting in next()
+        struct Yield
+        {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(const std::coroutine_handle<promise_type> handle) noexcept { return handle.promise().consumer; }
+            void await_resume() noexcept {}
+        };
+
+        AsyncGenerator get_return_object() { return AsyncGenerator(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        Yield final_suspend() noexcept { return {}; }
+        Yield yield_value(const T & yielded) noexcept
+        {
+            value = std::addressof(yielded);
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+    AsyncGenerator(AsyncGenerator && other) noexcept
+        : m_handle(std::exchange(other.m_handle, {}))
+    {
+    }
+    AsyncGenerator & operator=(AsyncGenerator && other) noexcept
+    {
+        std::swap(m_handle, other.m_handle);
+        return *this;
+    }
+    ~AsyncGenerator()
+    {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+
+    // awaitable of the next value, nothing once the generator is over
+    auto next()
+    {
+        struct Next
+        {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() noexcept { return handle.done(); }
+            std::coroutine_handle<> await_suspend(const std::coroutine_handle<> consumer) noexcept
+            {
+                handle.promise().consumer = consumer;
+                return handle;
+            }
+            std::optional<T> await_resume()
+            {
+                if (handle.promise().exception) {
+                    std::rethrow_exception(std::exchange(handle.promise().exception, {}));
+                }
+                if (handle.done()) {
+                    return std::nullopt;
+                }
+                return *handle.promise().value;
+            }
+        };
+        return Next{m_handle};
+    }
+
+private:
+    explicit AsyncGenerator(const std::coroutine_handle<promise_type> handle)
+        : m_handle(handle)
+    {
+    }
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+// Coroutine which starts right away and owns its frame, e.g. a consumer of
+// an AsyncGenerator; done() once it has returned.
+class Task
+{
+public:
+    struct promise_type
+    {
+        std::exception_ptr exception;
+
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+    Task(Task && other) noexcept
+        : m_handle(std::exchange(other.m_handle, {}))
+    {
+    }
+    Task & operator=(Task && other) noexcept
+    {
+        std::swap(m_handle, other.m_handle);
+        return *this;
+    }
+    ~Task()
+    {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+
+    // rethrows what the coroutine has thrown
+    bool done() const
+    {
+        if (m_handle.promise().exception) {
+            std::rethrow_exception(m_handle.promise().exception);
+        }
+        return m_handle.done();
+    }
+
+private:
+    explicit Task(const std::coroutine_handle<promise_type> handle)
+        : m_handle(handle)
+    {
+    }
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+} // namespace calc
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+namespace calc {
+
+enum class HugePages
+{
+    // regular pages everywhere
+    Off,
+    // large buffers are advised with MADV_HUGEPAGE, the kernel backs them
+    // with 2 MiB pages where it can and with regular ones otherwise
+    Transparent,
+    // buffers of their own mapping come from the reserved pool of huge pages
+    // (MAP_HUGETLB, vm.nr_hugepages), Transparent when the pool is empty;
+    // the rest of large buffers is Transparent
+    Explicit
+};
+
+inline constexpr std::size_t huge_page_size = std::size_t{2} << 20;
+
+// The policy of the process, Off until set. The input buffers, the operand
+// arrays of large folds and the LZ4 window follow it.
+void set_huge_pages(HugePages policy);
+HugePages huge_pages();
+
+// Advises huge pages for the 2 MiB aligned pages inside the memory, as long
+// as the policy isn't Off and the memory is large enough for that to pay.
+// Pages already touched are left to khugepaged, so it's best called on
+// fresh memory. Errors are ignored, the memory just keeps regular pages.
+void advise_huge_pages(void * data, std::size_t size);
+
+// Reserves room for size elements of a vector or a string, at least
+// doubling the capacity like push_back() does, and advises huge pages for
+// the new storage before anything touches it.
+template <class Container>
+void reserve_huge(Container & container, const std::size_t size)
+{
+    if (size <= container.capacity()) {
+        return;
+    }
+    container.reserve(std::max(size, 2 * container.capacity()));
+    advise_huge_pages(container.data(), container.capacity() * sizeof(*container.data()));
+}
+
+// Anonymous memory of its own mapping, backed by huge pages as the policy
+// says. The size is rounded up to whole pages of the kind it got.
+class PageBuffer
+{
+public:
+    PageBuffer() = default;
+    // empty if the memory can't be mapped
+    explicit PageBuffer(std::size_t size);
+    ~PageBuffer();
+
+    PageBuffer(PageBuffer && other) noexcept;
+    PageBuffer & operator=(PageBuffer && other) noexcept;
+    PageBuffer(const PageBuffer &) = delete;
+    PageBuffer & operator=(const PageBuffer &) = delete;
+
+    char * data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_data == nullptr; }
+    // whether it came from the pool of MAP_HUGETLB
+    bool explicit_pages() const { return m_explicit; }
+
+private:
+    char * m_data = nullptr;
+    std::size_t m_size = 0;
+    bool m_explicit = false;
+};
+
+} // namespace calc
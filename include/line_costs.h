@@ -0,0 +1,79 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+namespace calc {
+
+// A cheap timestamp: the CPU's time stamp counter, nanoseconds of
+// std::chrono::steady_clock where there is none.
+inline std::uint64_t ticks()
+{
+#if defined(__x86_64__)
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+struct LineCost
+{
+    std::size_t number = 0; // 1-based
+    std::string op;
+    std::size_t operands = 0;
+    std::size_t bytes = 0;
+    std::uint64_t ticks = 0;
+    std::string text; // the start of the line
+};
+
+// Cost of the lines of a script: the top most expensive lines and the time
+// by operation. Only a line which gets into the top is looked at closer
+// than its first chars, so adding a line costs little more than the two
+// timestamps around its evaluation.
+class LineCosts
+{
+public:
+    // how much of a line's text the report shows
+    static constexpr std::size_t text_size = 40;
+
+    explicit LineCosts(std::size_t top);
+
+    // the line was evaluated in that many ticks(), in_block tells whether
+    // it came inside a fold block
+    void add(std::size_t number, const std::string & line, bool in_block, std::uint64_t ticks);
+
+    // the most expensive lines, the most expensive first
+    std::vector<LineCost> top() const;
+    // ticks() to nanoseconds, measured over the lifetime of the object
+    double ns_per_tick() const;
+
+    // the top lines and the time by operation
+    void report(std::ostream & out) const;
+
+private:
+    struct Total
+    {
+        std::size_t lines = 0;
+        std::uint64_t ticks = 0;
+    };
+
+    std::size_t m_top;
+    // a min-heap by ticks
+    std::vector<LineCost> m_heap;
+    std::vector<Total> m_totals;
+    std::size_t m_lines = 0;
+    std::uint64_t m_ticks = 0;
+    std::uint64_t m_start_ticks;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+} // namespace calc
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "capture.h"
+#include "huge_pages.h"
+#include "lz4.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace calc {
+
+// Input layer of the main loop: reads lines from a file descriptor, input
+// starting with the LZ4 frame magic number is decompressed on the fly, so
+// the lines are cut right out of the decompression buffer.
+class LineReader
+{
+public:
+    explicit LineReader(int fd);
+
+    // same as std::getline(), false at the end of the input or on an error
+    bool getline(std::string & line);
+
+    bool compressed() const { return m_lz4 != nullptr; }
+    // whether getline() would wait for the input: nothing is left of the
+    // data already read and the fd has nothing to read right now
+    bool would_block() const;
+
+    // why the input ended early, empty if it didn't
+    std::string error() const;
+
+    // records the input read from now on with its arrival times, nullptr stops it
+    void capture(Capture * capture) { m_capture = capture; }
+
+private:
+    std::size_t read(char * data, std::size_t size);
+    std::string_view next_chunk();
+
+    int m_fd;
+    // 2 MiB of huge pages if the policy isn't Off
+    PageBuffer m_buffer;
+    // bytes already read to detect the format
+    std::string m_head;
+    std::string_view m_chunk;
+    std::unique_ptr<Lz4FrameReader> m_lz4;
+    std::string m_error;
+    Capture * m_capture = nullptr;
+    bool m_end = false;
+};
+
+} // namespace calc
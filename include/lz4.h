@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace calc {
+
+// XXH32 of the data, the checksum of the LZ4 frame format.
+std::uint32_t xxh32(const void * data, std::size_t size, std::uint32_t seed = 0);
+
+// XXH32 of data which comes in parts.
+class Xxh32
+{
+public:
+    explicit Xxh32(std::uint32_t seed = 0);
+
+    void update(const void * data, std::size_t size);
+    std::uint32_t digest() const;
+
+private:
+    std::uint32_t m_acc[4];
+    std::uint32_t m_seed;
+    std::uint64_t m_total = 0;
+    unsigned char m_buffer[16];
+    std::size_t m_buffered = 0;
+};
+
+constexpr std::uint32_t lz4_frame_magic = 0x184D2204;
+
+// Decoder of the LZ4 frame format (https://github.com/lz4/lz4/blob/dev/doc/lz4_Frame_format.md),
+// it pulls the compressed input with read() one block at a time and hands
+// out the decompressed data block by block. Concatenated and skippable
+// frames, linked blocks and all checksums are supported, dictionaries are not.
+class Lz4FrameReader
+{
+public:
+    // reads up to size bytes, returns how many, 0 at the end of the input
+    using Read = std::function<std::size_t(char * data, std::size_t size)>;
+
+    explicit Lz4FrameReader(Read read);
+
+    // next part of the decompressed data, valid till the next call; empty
+    // at the end of the input or on malformed input (see error())
+    std::string_view next();
+
+    // why the decompression stopped early, empty if it didn't
+    const std::string & error() const { return m_error; }
+
+private:
+    bool read_exact(void * data, std::size_t size);
+    bool read_u32(std::uint32_t & value);
+    bool fail(const char * reason);
+    bool start_frame();
+    bool end_frame();
+
+    Read m_read;
+    std::string m_error;
+    bool m_in_frame = false;
+    bool m_any_frame = false;
+    bool m_independent = true;
+    bool m_block_checksum = false;
+    bool m_content_checksum = false;
+    std::size_t m_block_max = 0;
+    Xxh32 m_content_hash;
+    std::vector<char> m_block;
+    // the last 64 KiB of decompressed data, which linked blocks refer to,
+    // followed by the block being decompressed
+    std::vector<char> m_window;
+    std::size_t m_pos = 0;
+};
+
+// Greedy single-pass LZ4 frame compressor with 64 KiB independent blocks
+// and a content checksum, for tests and benchmarks of the decoder.
+std::string lz4_compress(std::string_view data);
+
+} // namespace calc
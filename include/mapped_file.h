@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace calc {
+
+// Read-only mapping of a whole file, the pages are loaded on first access.
+// Huge pages are advised for it as the policy of huge_pages() says.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(MappedFile && other) noexcept;
+    MappedFile & operator=(MappedFile && other) noexcept;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile & operator=(const MappedFile &) = delete;
+
+    // replaces the current mapping, on failure prints the reason to std::cerr
+    bool open(const std::string & path);
+    void close();
+
+    std::string_view data() const { return {m_data, m_size}; }
+
+private:
+    const char * m_data = nullptr;
+    std::size_t m_size = 0;
+};
+
+} // namespace calc
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace calc {
+
+const std::size_t max_decimal_digits = 10;
+
+// Operands in the historical format: at most max_decimal_digits digits and
+// '.', errors are reported to std::cerr and reset good.
+double parse_arg(std::string_view line, std::size_t & i, bool & good);
+
+// The same checks as parse_arg() without the arithmetic, returns whether
+// the (maybe partially parsed) value is non-zero.
+bool validate_arg(std::string_view line, std::size_t & i, bool & good);
+
+// Exact integer and fraction parts of an operand in the historical format,
+// the latter scaled by fixed_scale.
+void parse_fixed(std::string_view line, std::size_t & i, bool & good, std::int64_t & integer, std::int64_t & fraction);
+
+// Operands of any length with an optional sign and exponent, correctly
+// rounded, errors are reported like parse_arg() does.
+double parse_full_arg(std::string_view line, std::size_t & i, bool & good);
+
+// The full format has no check cheaper than parsing, so this returns the
+// value itself: a zero divisor is reported with its sign.
+double validate_full_arg(std::string_view line, std::size_t & i, bool & good);
+
+// Quiet parser behind parse_full_arg() for [+-]digits[.digits][(e|E)[+-]digits]
+// starting at text[i]. Up to 19 significant digits are converted with the
+// Clinger or Eisel-Lemire fast paths, ambiguous longer inputs fall back to
+// strtod. Returns false and leaves i untouched if there are no digits.
+bool parse_decimal(std::string_view text, std::size_t & i, double & value);
+
+} // namespace calc
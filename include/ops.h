@@ -0,0 +1,19 @@
+#pragma once
+
+namespace calc {
+
+enum class Op
+{
+    ERR,
+    SET,
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    REM,
+    NEG,
+    POW,
+    SQRT
+};
+
+} // namespace calc
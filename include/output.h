@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace calc {
+
+// "-1.23457e-308" and a newline fit with plenty to spare
+constexpr std::size_t max_record = 32;
+
+// Writes the value the way std::ostream prints it and a newline to out,
+// which has room for max_record chars, returns the end of the record.
+char * format_record(double value, char * out);
+
+// Output of the main loop's results. Values are formatted into page-aligned
+// buffers; full buffers go to a pipe with vmsplice(), which maps the pages
+// into the pipe instead of copying them, anything else is written with
+// write(). A spliced buffer is never written again: the reader may splice
+// its pages on, so they are unmapped and a fresh buffer takes their place. A terminal, or stdout shared with stderr, gets every line at
+// once so that results and error messages keep their order.
+class Output
+{
+public:
+    explicit Output(int fd, bool allow_splice = true);
+    ~Output();
+
+    Output(const Output &) = delete;
+    Output & operator=(const Output &) = delete;
+
+    // appends the value the way std::ostream prints it, and a newline
+    void write(double value);
+    // hands the buffered results over to the fd
+    void flush();
+
+    bool spliced() const { return m_splice; }
+    // why the output stopped, empty if it didn't
+    const std::string & error() const { return m_error; }
+
+private:
+    void write_out(const char * data, std::size_t size);
+    void splice_out();
+    void stop_splicing();
+    // drops the buffer, the pipe keeps the pages it refers to
+    void replace_buffer();
+
+    int m_fd;
+    bool m_splice = false;
+    bool m_line = false;
+    std::size_t m_size = 0;
+    char * m_buffer = nullptr;
+    std::size_t m_used = 0;
+    std::string m_error;
+};
+
+} // namespace calc
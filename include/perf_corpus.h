@@ -0,0 +1,34 @@
+#pragma once
+
+#include "differential.h"
+
+#include <string>
+#include <vector>
+
+namespace calc {
+
+// A line which is slow for its size in some mode, with the time per byte
+// it must stay under.
+struct PerfCase
+{
+    std::string mode; // a Mode::name
+    double budget;    // nanoseconds per byte of the line
+    double current;
+    std::string line;
+};
+
+// The corpus is a text file of "mode<TAB>budget<TAB>register<TAB>line"
+// entries, '#' starts a comment line; the line escapes '\\', tabs and newlines
+// like C does. On failure prints the reason to std::cerr and returns false.
+bool load_perf_corpus(const std::string & path, std::vector<PerfCase> & cases);
+bool save_perf_corpus(const std::string & path, const std::vector<PerfCase> & cases);
+
+// Lines are charged for this many bytes at least, otherwise the fixed cost
+// of any line would make the shortest ones the slowest per byte.
+constexpr std::size_t min_charged_bytes = 64;
+
+// Best time of evaluating the line in the mode, in nanoseconds per charged
+// byte, with the messages muted.
+double ns_per_byte(const Mode & mode, double current, const std::string & line, std::size_t rounds = 5);
+
+} // namespace calc
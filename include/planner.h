@@ -0,0 +1,29 @@
+#pragma once
+
+#include "engine.h"
+
+#include <cstddef>
+#include <string>
+
+namespace calc {
+
+// Operand counts from which the non-strict engines pay off, see autotune().
+struct Tuning
+{
+    std::size_t simd_min_operands = 32;
+    std::size_t parallel_min_operands = 1 << 18;
+    std::size_t parallel_grain = 1 << 15;
+};
+
+// Strict folds always use the Scalar engine to keep today's results.
+Engine plan(Op op, std::size_t operands, bool strict, const Tuning & tuning);
+
+// Config file is a list of 'key=value' lines with the Tuning field names.
+bool load_tuning(const std::string & path, Tuning & tuning);
+bool save_tuning(const std::string & path, const Tuning & tuning);
+std::string default_tuning_path();
+
+// Measures the engines' crossover points on the current host.
+Tuning autotune();
+
+} // namespace calc
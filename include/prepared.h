@@ -0,0 +1,95 @@
+#pragma once
+
+#include "calc.h"
+#include "expr.h"
+
+#include <cstdint>
+#include <list>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace calc {
+
+// A script compiled once to be run from many initial registers, as if a
+// Session of its own were fed the lines for each of them. Op lines keep
+// their parsed operands (see compile_line()), a fold block becomes a single
+// fold and an expression a Program, so a run parses nothing. Variables are
+// resolved to slots when the script is compiled, a run keeps their values
+// for each register and only the lines which use them go register by
+// register, the rest is applied to all the registers at once.
+class PreparedScript
+{
+public:
+    // on a fold block left open prints it to std::cerr and returns false
+    bool compile(const std::vector<std::string> & lines, const Options & options);
+
+    // replaces every register with its value after the script; a malformed
+    // line leaves the registers as they are and prints its messages once,
+    // like process_batch() does
+    void run(std::span<double> registers) const;
+
+    // the number of variables a run keeps for each register
+    std::size_t variables() const { return m_variables.values().size(); }
+
+private:
+    struct Step
+    {
+        CompiledLine line;
+        // of an '= expr' line, its line is Dynamic
+        Program program;
+        // of a '> $name' line, its line is Dynamic too
+        bool assigns = false;
+        std::size_t slot = 0;
+        // what the line prints whatever the register is, of an Invalid line
+        std::string message;
+    };
+
+    // compiles the line at k and the rest of its fold block, false if the
+    // block isn't closed
+    bool compile_step(const std::vector<std::string> & lines, std::size_t & k, Step & step);
+
+    Options m_options;
+    std::vector<Step> m_steps;
+    // the slots of the variables assigned so far, their values are unused
+    Variables m_variables;
+};
+
+// Prepared scripts by handle, shared by all the clients of a server. A full
+// cache drops its least recently used script, whose handle is never given
+// out again. Preparing the text of a script which is there already returns
+// its handle.
+class ScriptCache
+{
+public:
+    ScriptCache(std::size_t capacity, const Options & options);
+
+    // handle of the compiled script, 0 if it doesn't compile
+    std::uint64_t prepare(const std::vector<std::string> & lines);
+    // nullptr if there is no such script (any more)
+    const PreparedScript * find(std::uint64_t handle);
+
+    std::size_t size() const { return m_entries.size(); }
+
+private:
+    struct Entry
+    {
+        std::uint64_t handle;
+        std::string text;
+        PreparedScript script;
+    };
+    using Entries = std::list<Entry>;
+
+    std::size_t m_capacity;
+    Options m_options;
+    std::uint64_t m_next = 1;
+    // the most recently used first
+    Entries m_entries;
+    std::unordered_map<std::uint64_t, Entries::iterator> m_handles;
+    // keys point into the entries' text, so lookups don't allocate
+    std::unordered_map<std::string_view, Entries::iterator> m_texts;
+};
+
+} // namespace calc
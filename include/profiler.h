@@ -0,0 +1,102 @@
+#pragma once
+
+#include "ops.h"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <ostream>
+
+namespace calc {
+
+// What the thread is busy with, the code marks it and samples of the
+// profiler record it. Marking is a store of a byte, it's always on.
+enum class Phase : unsigned char
+{
+    Other,
+    Read,
+    ParseOp,
+    ParseArg,
+    Fold,
+    Expression,
+    Format,
+    Write,
+};
+
+constexpr std::size_t phase_count = static_cast<std::size_t>(Phase::Write) + 1;
+constexpr std::size_t op_count = static_cast<std::size_t>(Op::SQRT) + 1;
+
+const char * phase_name(Phase phase);
+
+// the marks of this thread, the profiler's signal handler reads them
+inline thread_local std::atomic<Phase> current_phase{Phase::Other};
+inline thread_local std::atomic<Op> current_op{Op::ERR};
+
+// Marks the phase till the end of the scope, then restores the previous one.
+class PhaseScope
+{
+public:
+    explicit PhaseScope(const Phase phase)
+        : m_saved(current_phase.load(std::memory_order_relaxed))
+    {
+        current_phase.store(phase, std::memory_order_relaxed);
+    }
+    ~PhaseScope() { current_phase.store(m_saved, std::memory_order_relaxed); }
+
+    PhaseScope(const PhaseScope &) = delete;
+    PhaseScope & operator=(const PhaseScope &) = delete;
+
+private:
+    Phase m_saved;
+};
+
+inline void mark_phase(const Phase phase)
+{
+    current_phase.store(phase, std::memory_order_relaxed);
+}
+
+inline void mark_op(const Op op)
+{
+    current_op.store(op, std::memory_order_relaxed);
+}
+
+// Sampling profiler of the process CPU time: a POSIX timer sends SIGPROF to
+// the thread which started the profiler every interval of CPU time spent by
+// any thread, the handler counts the phase and the operation marked by that
+// thread. Work of the engine's threads is thus charged to the fold the main
+// thread waits for. Only one profiler may run at a time, the SIGPROF action
+// it replaces is restored when it stops. The kernel checks
+// CPU time timers on its tick, so shorter intervals than that (4 ms with
+// HZ=250) don't give more samples.
+class Profiler
+{
+public:
+    Profiler() = default;
+    // stops the profiler
+    ~Profiler();
+
+    Profiler(const Profiler &) = delete;
+    Profiler & operator=(const Profiler &) = delete;
+
+    // on failure prints the reason to std::cerr and returns false
+    bool start(std::chrono::microseconds interval = std::chrono::microseconds(5000));
+    void stop();
+
+    std::uint64_t samples() const;
+    std::uint64_t samples(Phase phase) const;
+    std::uint64_t samples(Op op) const;
+
+    // breakdown of the samples by phase and by operation
+    void report(std::ostream & out) const;
+
+private:
+    bool m_running = false;
+    timer_t m_timer{};
+    struct sigaction m_saved_action = {};
+    std::chrono::microseconds m_interval{0};
+};
+
+} // namespace calc
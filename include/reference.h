@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+
+namespace calc::reference {
+
+// The original process_line(), frozen: every other engine and mode has to
+// print and return the same for the lines it accepts. Don't change it.
+double process_line(double current, const std::string & line);
+
+} // namespace calc::reference
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace calc {
+
+// Registers of named sessions in a file mapped into memory. A store is a few
+// writes to a shared page, no syscall; the kernel writes the pages back, so
+// the registers survive a crash or a restart of the process (not of the
+// machine, that needs the command log).
+//
+// Every slot is guarded by a sequence counter (a seqlock): odd while the
+// slot is being written. A slot left odd by a crash, or whose checksum
+// doesn't match, is dropped when the table is opened.
+class RegisterTable
+{
+public:
+    static constexpr std::size_t max_name = 226;
+    static constexpr std::size_t default_capacity = 1 << 16;
+
+    RegisterTable() = default;
+    ~RegisterTable();
+
+    RegisterTable(const RegisterTable &) = delete;
+    RegisterTable & operator=(const RegisterTable &) = delete;
+
+    // Maps the table, creating it with the capacity if the file is empty, and
+    // calls restore(name, value) for every valid slot. On failure prints the
+    // reason to std::cerr and returns false.
+    bool open(const std::string & path, const std::function<void(std::string_view, double)> & restore, std::size_t capacity = default_capacity);
+
+    // slot of the session, a new one if needed; npos if the table is full
+    // or the name is too long
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+    std::size_t slot(std::string_view name);
+
+    void store(std::size_t slot, double value);
+    // consistent value of a slot, even while another process stores to it
+    double load(std::size_t slot) const;
+
+    std::size_t size() const { return m_slots.size(); }
+
+private:
+    struct alignas(64) Slot
+    {
+        std::atomic<std::uint64_t> sequence;
+        std::uint64_t value; // bits of the double
+        std::uint64_t updates;
+        std::uint32_t checksum; // XXH32 of value and updates seeded with the name's
+        std::uint16_t name_size;
+        char name[max_name];
+    };
+    static_assert(sizeof(Slot) == 256);
+
+    struct Header;
+
+    void write(Slot & slot, std::uint32_t seed, std::uint64_t value, std::uint64_t updates);
+
+    Slot * m_table = nullptr;
+    std::size_t m_capacity = 0;
+    std::size_t m_mapped = 0;
+    std::size_t m_next = 0; // no free slots before it
+    std::map<std::string, std::size_t, std::less<>> m_slots;
+    std::vector<std::uint32_t> m_seeds; // XXH32 of the slot names
+};
+
+} // namespace calc
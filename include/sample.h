@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace calc {
+
+enum class Sampling
+{
+    // operands at evenly spaced byte offsets from a random start, reads only
+    // the sampled pages but weights each operand by the bytes it spans
+    Stride,
+    // uniform sample of operands, counts all of them in one pass
+    Reservoir
+};
+
+// More samples mean a narrower interval and a longer run, the time of both
+// methods grows with samples, the reservoir one also with the input size.
+struct SampleConfig
+{
+    Sampling method = Sampling::Stride;
+    std::size_t samples = 4096;
+    double confidence = 0.95;
+    std::uint64_t seed = 1;
+};
+
+// Estimated value with its confidence interval [low, high]. The interval is
+// empty (low == high) when all operands were read.
+struct Estimate
+{
+    double value = 0;
+    double low = 0;
+    double high = 0;
+    std::size_t samples = 0;
+};
+
+// Estimates the '(+)' fold from zero over the whitespace-separated operands
+// of the text (e.g. a MappedFile) from a sample of them. Operands may have
+// any length, sign and exponent. A malformed sampled operand is reported to
+// std::cerr and makes the result false.
+bool estimate_sum(std::string_view text, const SampleConfig & config, Estimate & estimate);
+
+// Two-sided standard normal quantile for the confidence level, e.g. 1.96 for 0.95.
+double normal_quantile(double confidence);
+
+} // namespace calc
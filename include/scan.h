@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string_view>
+
+namespace calc {
+
+// Whether the text consists only of decimal digits, '.' and whitespace,
+// checked 16 bytes at a time where SSE2 is available.
+bool only_number_chars(std::string_view text);
+
+} // namespace calc
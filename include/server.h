@@ -0,0 +1,127 @@
+#pragma once
+
+#include "calc.h"
+#include "prepared.h"
+#include "registers.h"
+#include "session.h"
+#include "wal.h"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace calc {
+
+constexpr std::size_t max_session_name = 255;
+
+// Whether the name can name a session: 1 to max_size bytes, no spaces, tabs
+// or '\r'. A register table keeps names of up to RegisterTable::max_name.
+bool valid_session_name(std::string_view name, std::size_t max_size = max_session_name);
+
+struct ServerConfig
+{
+    std::string socket_path;
+    std::string log_path; // empty means no command log, results are sent at once
+    std::string registers_path; // empty means no register table
+    // How long the first command of a batch may wait for the others before
+    // the batch is synced to the log. With 0 the log is synced once per poll()
+    // round, commands arriving during a sync share the next one; a longer
+    // window pays off when a sync costs much more than a client round trip.
+    std::chrono::microseconds commit_window{0};
+    // a batch this large is synced at once
+    std::size_t commit_bytes = 1 << 20;
+    // how many prepared scripts the server keeps
+    std::size_t prepared_scripts = 1024;
+    // how many lines a script to prepare may have
+    std::size_t max_script_lines = 4096;
+    Options options;
+};
+
+// Daemon serving scripts over a Unix stream socket. Every connection feeds
+// lines to a named session ("@session name" switches it, the initial one is
+// "default") and gets back what calc_fold would print for them. Sessions are
+// shared by all connections and live as long as the server.
+//
+// With a command log every applied line is logged, and its result is sent
+// only once the log is synced. A single poll() loop serves everything, so
+// lines of all clients that arrive within the commit window share one sync.
+// With a register table every register is also kept in it; sessions missing
+// from the log (or without one) are restored from the table.
+//
+// A script sent again and again from different registers can be prepared
+// once: the lines between "@prepare" and "@end" are compiled and answered
+// with "@prepared <handle>", "@execute <handle> <register>..." runs it from
+// each of the registers and answers with the register after the script for
+// each of them. Prepared scripts are shared by all connections, they don't
+// touch the sessions and aren't logged. A script which doesn't compile or is
+// longer than max_script_lines, and a handle which is gone are answered with
+// "@error".
+class Server
+{
+public:
+    explicit Server(const ServerConfig & config);
+    ~Server();
+
+    Server(const Server &) = delete;
+    Server & operator=(const Server &) = delete;
+
+    // Recovers the sessions from the command log and listens on the socket,
+    // on failure prints the reason to std::cerr and returns false.
+    bool open();
+    // serves clients until stop(), false if the command log can't be written
+    bool run();
+    // makes run() return, async-signal-safe
+    void stop();
+
+    // register of a session, nothing if it doesn't exist
+    std::optional<double> current(std::string_view session) const;
+    std::uint64_t commits() const { return m_log.commits(); }
+
+private:
+    struct Client
+    {
+        int fd = -1;
+        std::string session = "default";
+        std::string in;
+        std::string held; // results waiting for the log sync
+        std::string out;
+        // lines of a script being prepared
+        std::optional<std::vector<std::string>> script;
+        // the script had more lines than it may, the rest are dropped
+        bool script_too_long = false;
+        bool eof = false;
+    };
+
+    struct Named
+    {
+        Session session;
+        std::size_t slot; // in the register table
+    };
+
+    Named & session(std::string_view name, double current = 0);
+    void receive(Client & client);
+    void handle(Client & client, std::string_view line);
+    void execute(Client & client, std::string_view arguments);
+    // where answers which aren't logged go: out, unless results of the client
+    // before them still wait for the log sync
+    static std::string & answers(Client & client) { return client.held.empty() ? client.out : client.held; }
+    void send(Client & client);
+    bool commit();
+
+    ServerConfig m_config;
+    int m_listen = -1;
+    int m_wake[2] = {-1, -1};
+    std::map<std::string, Named, std::less<>> m_sessions;
+    std::vector<Client> m_clients;
+    CommandLog m_log;
+    bool m_logging = false;
+    RegisterTable m_registers;
+    ScriptCache m_scripts;
+    std::optional<std::chrono::steady_clock::time_point> m_batch_start;
+};
+
+} // namespace calc
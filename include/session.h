@@ -0,0 +1,36 @@
+#pragma once
+
+#include "calc.h"
+
+#include <optional>
+#include <string>
+
+namespace calc {
+
+// Evaluation of one script line by line: the register, its Context and an
+// open fold block. The main loop and evaluate() are built on it.
+class Session
+{
+public:
+    explicit Session(const Options & options = {}, double current = 0);
+
+    // evaluates the line and returns the new register value, nothing while
+    // the line is a part of a fold block (its value comes with the "}")
+    std::optional<double> feed(const std::string & line);
+
+    // end of the input, reports a fold block left open
+    void finish();
+
+    double current() const { return m_current; }
+    // whether the next line goes to an open fold block
+    bool in_block() const { return m_block.active(); }
+    Context & context() { return m_context; }
+
+private:
+    Options m_options;
+    double m_current;
+    Context m_context;
+    FoldBlock m_block;
+};
+
+} // namespace calc
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace calc {
+
+// Named slots next to the register, written by '> $name' lines and read as
+// '$name' operands. Programs and compiled lines (see compile_line()) keep
+// the slot indices, evaluating them only indexes the flat array of values;
+// process_line() parses a line anew and looks its names up every time.
+class Variables
+{
+public:
+    // slot of the name, created on the first assignment
+    std::size_t assign(std::string_view name, double value);
+    std::optional<std::size_t> find(std::string_view name) const;
+
+    const std::vector<double> & values() const { return m_values; }
+
+    // parses '$name' at text[i] and returns its value, prints an error and
+    // resets good for a malformed or unknown name
+    double parse(std::string_view text, std::size_t & i, bool & good) const;
+
+private:
+    std::vector<double> m_values;
+    std::map<std::string, std::size_t, std::less<>> m_slots;
+};
+
+// Reads '$name' at text[i] (a letter or '_' and then letters, digits and
+// '_'), returns an empty name and keeps i if there is none.
+std::string_view parse_variable_name(std::string_view text, std::size_t & i);
+
+} // namespace calc
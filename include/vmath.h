@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+
+namespace calc {
+
+// Math kernels which apply one op with the same operand to many values, 4
+// lanes at a time with AVX2 and FMA where the CPU has them, value by value
+// with libm otherwise. Domains are handled the way unary() and binary() do
+// it for a single value, the callers report the errors.
+
+// Values > 0 get their square roots, the rest keep their values (the bad
+// arguments of SQRT). Bit-exact with std::sqrt, vsqrtpd rounds correctly.
+void sqrt_lanes(double * values, std::size_t n);
+
+// fmod(value, divisor) for every value, bit-exact with std::fmod: the
+// remainder is exact, q = trunc(|x| / |y|) is at most one too large and
+// |x| - q|y| is computed exactly with one FMA and corrected. Quotients from
+// 2^52, infinities and NaNs go to std::fmod. Returns false and leaves the
+// values if the divisor is zero.
+bool fmod_lanes(double * values, std::size_t n, double divisor);
+
+// pow(value, exponent) for every value, within 1 ULP of the exact result
+// (0.53 ULP at most measured against powl): log in double-double from a
+// 128-entry table and a degree 11 polynomial of log1p, exp from a 128-entry
+// table of 2^(j/128) and a degree 6 polynomial. Not bit-exact with glibc's
+// pow() which is within 1 ULP as well but rounds differently now and then,
+// so strict evaluation doesn't use it. Bases which aren't positive normal
+// numbers and results which aren't normal go to std::pow.
+void pow_lanes(double * values, std::size_t n, double exponent);
+
+} // namespace calc
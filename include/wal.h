@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace calc {
+
+// Append-only log of the commands applied to named sessions. Appended
+// records are only buffered, commit() writes all of them with a single
+// fdatasync(), so that one sync covers many commands (group commit).
+//
+// Record: u32 payload size, u32 XXH32 of the payload, payload = u16 session
+// name size, the name, the line; all little-endian.
+class CommandLog
+{
+public:
+    CommandLog() = default;
+    ~CommandLog();
+
+    CommandLog(const CommandLog &) = delete;
+    CommandLog & operator=(const CommandLog &) = delete;
+
+    // Replays the existing records through apply(session, line), cuts off a
+    // torn or corrupted tail left by a crash and opens the log for appending.
+    // On failure prints the reason to std::cerr and returns false.
+    bool open(const std::string & path, const std::function<void(std::string_view, std::string_view)> & apply);
+
+    void append(std::string_view session, std::string_view line);
+    // bytes appended since the last commit
+    std::size_t pending() const { return m_buffer.size(); }
+    // makes the appended records durable, false on an I/O error
+    bool commit();
+
+    std::uint64_t commits() const { return m_commits; }
+
+private:
+    int m_fd = -1;
+    std::string m_buffer;
+    std::uint64_t m_commits = 0;
+};
+
+} // namespace calc
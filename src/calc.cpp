@@ -1,26 +1,27 @@
 #include "calc.h"
 
+#include "fixed.h"
+#include "huge_pages.h"
+#include "number.h"
+#include "profiler.h"
+#include "scan.h"
+#include "vmath.h"
+
+#include <algorithm>
 #include <cctype>   // for std::isspace
 #include <cmath>    // various math functions
+#include <cstdint>
 #include <iostream> // for error reporting via std::cerr
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
 #include <vector>
 namespace {
 
-const std::size_t max_decimal_digits = 10;
-
-enum class Op
-{
-    ERR,
-    SET,
-    ADD,
-    SUB,
-    MUL,
-    DIV,
-    REM,
-    NEG,
-    POW,
-    SQRT
-};
+using calc::max_decimal_digits;
+using calc::Op;
+using calc::Phase;
 
 std::size_t arity(const Op op)
 {
@@ -77,7 +78,8 @@ Op parse_op(const std::string & line_raw, std::size_t & i)
     case '7':
     case '8':
     case '9':
-        --i; // a first digit is a part of op's argument
+    case '$':
+        --i; // a first digit or a variable is a part of op's argument
         return Op::SET;
     case '+':
         return Op::ADD;
@@ -123,54 +125,6 @@ std::size_t skip_ws(const std::string & line, std::size_t i)
     return i;
 }
 
-double parse_arg(const std::string & line, std::size_t & i, bool & good)
-{
-    double res = 0;
-    std::size_t count = 0;
-    bool integer = true;
-    double fraction = 1;
-    while (good && i < line.size() && count < max_decimal_digits) {
-        switch (line[i]) {
-        case '0':
-        case '1':
-        case '2':
-        case '3':
-        case '4':
-        case '5':
-        case '6':
-        case '7':
-        case '8':
-        case '9':
-            if (integer) {
-                res *= 10;
-                res += line[i] - '0';
-            }
-            else {
-                fraction /= 10;
-                res += (line[i] - '0') * fraction;
-            }
-            ++i;
-            ++count;
-            break;
-        case '.':
-            integer = false;
-            ++i;
-            break;
-        default:
-            good = false;
-            break;
-        }
-    }
-    if (!good) {
-        std::cerr << "Argument parsing error at " << i << ": '" << line.substr(i) << "'" << std::endl;
-    }
-    else if (i < line.size()) {
-        good = false;
-        std::cerr << "Argument isn't fully parsed, suffix left: '" << line.substr(i) << "'" << std::endl;
-    }
-    return res;
-}
-
 double unary(const double current, const Op op)
 {
     switch (op) {
@@ -189,6 +143,24 @@ double unary(const double current, const Op op)
     }
 }
 
+// reports a zero divisor of '/' and '%' the same way binary() does
+bool check_divisor(const Op op, const double right)
+{
+    if (right != 0) {
+        return true;
+    }
+    switch (op) {
+    case Op::DIV:
+        std::cerr << "Bad right argument for division: " << right << std::endl;
+        return false;
+    case Op::REM:
+        std::cerr << "Bad right argument for remainder: " << right << std::endl;
+        return false;
+    default:
+        return true;
+    }
+}
+
 double binary(const Op op, const double left, const double right, bool & good)
 {
     switch (op) {
@@ -201,23 +173,17 @@ double binary(const Op op, const double left, const double right, bool & good)
     case Op::MUL:
         return left * right;
     case Op::DIV:
-        if (right != 0) {
+        if (check_divisor(op, right)) {
             return left / right;
         }
-        else {
-            good = false;
-            std::cerr << "Bad right argument for division: " << right << std::endl;
-            return left;
-        }
+        good = false;
+        return left;
     case Op::REM:
-        if (right != 0) {
+        if (check_divisor(op, right)) {
             return std::fmod(left, right);
         }
-        else {
-            good = false;
-            std::cerr << "Bad right argument for remainder: " << right << std::endl;
-            return left;
-        }
+        good = false;
+        return left;
     case Op::POW:
         return std::pow(left, right);
     default:
@@ -240,96 +206,565 @@ std::size_t skip_brackets(const std::string & line, std::size_t i)
         return old_i;
 }
 
-bool is_fold(const std::string & line)
+double parse_operand(const std::string_view line, std::size_t & i, bool & good, const bool full, const calc::Variables & variables)
 {
-    if (line[0] == '(') {
-        for (const auto & ch : line) {
-            if (ch == ')') {
-                return true;
+    if (i < line.size() && line[i] == '$') {
+        const auto value = variables.parse(line, i, good);
+        if (good && i != line.size()) {
+            std::cerr << "Argument parsing error at " << i << ": '" << line.substr(i) << "'" << std::endl;
+            good = false;
+        }
+        return value;
+    }
+    return full ? calc::parse_full_arg(line, i, good) : calc::parse_arg(line, i, good);
+}
+
+// checks an operand without computing it where the format allows, returns
+// a value with the same sign and zeroness as the operand
+double validate_operand(const std::string_view token, bool & good, const bool full, const calc::Variables & variables)
+{
+    std::size_t pos = 0;
+    if (token[0] == '$') {
+        return parse_operand(token, pos, good, full, variables);
+    }
+    if (full) {
+        return calc::validate_full_arg(token, pos, good);
+    }
+    // historical operands are never negative
+    return calc::validate_arg(token, pos, good) ? 1 : 0;
+}
+
+// values which no further operand of the op can change; operands in the
+// historical format are finite and non-negative, full ones and variables
+// may be anything
+bool absorbing(const Op op, const double value, const bool full)
+{
+    if (full) {
+        return op == Op::POW ? value == 1 : std::isnan(value);
+    }
+    switch (op) {
+    case Op::ADD:
+    case Op::SUB: return std::isnan(value) || std::isinf(value);
+    case Op::MUL:
+    case Op::REM: return std::isnan(value) || value == 0;
+    case Op::DIV: return std::isnan(value) || std::isinf(value) || value == 0;
+    case Op::POW: return value == 1;
+    default: return false;
+    }
+}
+
+// checks the operands which are left after the fold result is already known
+bool validate_rest(const Op op, const std::vector<std::string_view> & tokens, std::size_t k, const bool full, const calc::Variables & variables)
+{
+    bool good = true;
+    for (; k < tokens.size(); ++k) {
+        const double value = validate_operand(tokens[k], good, full, variables);
+        if (!check_divisor(op, value) || !good) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// first phase of the two-phase mode: all operands are checked before any
+// arithmetic, so a malformed line costs only this scan
+bool validate_fold(const Op op, const std::string & line, const std::size_t i, const std::vector<std::string_view> & tokens, const bool full, const calc::Variables & variables)
+{
+    if (!full && calc::only_number_chars(std::string_view(line).substr(i))) {
+        // short tokens of digits and dots always parse, only zero divisors are left to find
+        const bool divides = op == Op::DIV || op == Op::REM;
+        bool clean = true;
+        for (const auto token : tokens) {
+            if (token.size() > max_decimal_digits || (divides && token.find_first_of("123456789") == std::string_view::npos)) {
+                clean = false;
+                break;
             }
         }
-        return false;
+        if (clean) {
+            return true;
+        }
     }
-    else
-        return false;
+    return validate_rest(op, tokens, 0, full, variables);
 }
 
-std::size_t parse_number_length(const std::string & line, std::size_t i)
+// '+', '-' and '*' folds in decimal fixed point, nothing if the values
+// don't fit or some operand is malformed (then good is reset); operands are
+// always in the historical format, longer ones and variables wouldn't fit
+// exactly
+std::optional<double> fixed_fold(const double current, const Op op, const std::vector<std::string_view> & tokens, bool & good)
 {
-    std::size_t count = 0;
-    while (i < line.size() && !std::isspace(line[i])) {
-        i++;
-        count++;
+    for (const auto token : tokens) {
+        if (token[0] == '$') {
+            return std::nullopt;
+        }
     }
-    return count;
+    std::vector<std::int64_t> integers(tokens.size());
+    std::vector<std::int64_t> fractions(tokens.size());
+    calc::mark_phase(Phase::ParseArg);
+    for (std::size_t k = 0; k < tokens.size(); ++k) {
+        std::size_t pos = 0;
+        calc::parse_fixed(tokens[k], pos, good, integers[k], fractions[k]);
+        if (!good) {
+            return std::nullopt;
+        }
+    }
+    calc::mark_phase(Phase::Fold);
+    calc::Fixed acc;
+    if (!calc::to_fixed(current, acc) || !calc::fixed_fold(op, acc, integers, fractions)) {
+        return std::nullopt;
+    }
+    return calc::to_double(acc);
 }
 
-std::vector<std::string> parse_number(const std::string & line, std::size_t i)
+std::vector<std::string_view> split_tokens(const std::string & line, std::size_t i)
 {
-    std::vector<std::string> numbers;
+    std::vector<std::string_view> tokens;
     while (i < line.size()) {
         i = skip_ws(line, i);
-        auto number_length = parse_number_length(line, i);
-        if (number_length != 0) {
-            numbers.push_back(line.substr(i, number_length));
+        const auto begin = i;
+        while (i < line.size() && !std::isspace(line[i])) {
+            ++i;
+        }
+        if (i != begin) {
+            if (tokens.size() == tokens.capacity()) {
+                calc::reserve_huge(tokens, tokens.size() + 1);
+            }
+            tokens.emplace_back(line.data() + begin, i - begin);
         }
-        i += number_length;
     }
-    if (numbers.empty()) {
+    return tokens;
+}
+
+double process_fold(const double current, const Op op, const std::string & line, const std::size_t i, const calc::Options & options, const calc::Variables & variables)
+{
+    calc::mark_phase(Phase::ParseArg);
+    const auto tokens = split_tokens(line, i);
+    if (tokens.empty()) {
         std::cerr << "No argument for a binary operation" << std::endl;
+        return current;
+    }
+    if (op == Op::SET) {
+        std::cerr << "Wrong operation left fold" << std::endl;
+        return current;
+    }
+    const bool full = options.full_numbers;
+    bool good = true;
+    if (options.fixed_point && (op == Op::ADD || op == Op::SUB || op == Op::MUL)) {
+        if (const auto res = fixed_fold(current, op, tokens, good)) {
+            return *res;
+        }
+        if (!good) {
+            return current;
+        }
+        // out of the fixed-point range, fall back to binary floating point
+    }
+    if (options.two_phase && (op == Op::DIV || op == Op::REM || op == Op::POW) && !validate_fold(op, line, i, tokens, full, variables)) {
+        return current;
+    }
+    const auto engine = calc::plan(op, tokens.size(), options.strict, options.tuning);
+    if (engine == calc::Engine::Scalar) {
+        const bool any_value = full || (options.short_circuit && std::any_of(tokens.begin(), tokens.end(), [](const auto token) { return token[0] == '$'; }));
+        auto res = current;
+        for (std::size_t k = 0; k < tokens.size(); ++k) {
+            std::size_t pos = 0;
+            calc::mark_phase(Phase::ParseArg);
+            const auto arg = parse_operand(tokens[k], pos, good, full, variables);
+            calc::mark_phase(Phase::Fold);
+            res = binary(op, res, arg, good);
+            if (!good) {
+                return current;
+            }
+            if (options.short_circuit && absorbing(op, res, any_value)) {
+                calc::mark_phase(Phase::ParseArg);
+                return validate_rest(op, tokens, k + 1, full, variables) ? res : current;
+            }
+        }
+        return res;
+    }
+    // the other engines need all operands up front, an error in the middle
+    // is still reported exactly like the operand-by-operand loop does
+    calc::mark_phase(Phase::ParseArg);
+    std::vector<double> args;
+    calc::reserve_huge(args, tokens.size());
+    for (const auto token : tokens) {
+        std::size_t pos = 0;
+        args.push_back(parse_operand(token, pos, good, full, variables));
+        if (!check_divisor(op, args.back()) || !good) {
+            return current;
+        }
+    }
+    calc::mark_phase(Phase::Fold);
+    return calc::fold(engine, op, current, args, options.tuning.parallel_grain);
+}
+
+// one operation of a line over all the registers, the operand is valid
+void apply_lanes(const Op op, const std::span<double> registers, const double arg, const bool strict)
+{
+    const auto each = [registers](const auto & function) {
+        for (auto & value : registers) {
+            value = function(value);
+        }
+    };
+    switch (op) {
+    case Op::SET: std::fill(registers.begin(), registers.end(), arg); break;
+    case Op::ADD: each([arg](const double value) { return value + arg; }); break;
+    case Op::SUB: each([arg](const double value) { return value - arg; }); break;
+    case Op::MUL: each([arg](const double value) { return value * arg; }); break;
+    case Op::DIV: each([arg](const double value) { return value / arg; }); break;
+    case Op::REM: calc::fmod_lanes(registers.data(), registers.size(), arg); break;
+    case Op::POW:
+        if (strict) {
+            each([arg](const double value) { return std::pow(value, arg); });
+        }
+        else {
+            calc::pow_lanes(registers.data(), registers.size(), arg);
+        }
+        break;
+    default: break;
     }
-    return numbers;
 }
 
 } // anonymous namespace
 
+namespace calc {
+
+bool closes_block(const std::string & line)
+{
+    const auto i = skip_ws(line, 0);
+    return i < line.size() && line[i] == '}' && skip_ws(line, i + 1) == line.size();
+}
+
+std::string_view assigned_name(const std::string & line)
+{
+    auto i = skip_ws(line, 1);
+    const auto name = parse_variable_name(line, i);
+    if (name.empty() || skip_ws(line, i) != line.size()) {
+        std::cerr << "Bad variable name: '" << line.substr(1) << "'" << std::endl;
+        return {};
+    }
+    return name;
+}
+
+const Program * Context::program(const std::string_view text)
+{
+    if (const auto it = m_programs.find(text); it != m_programs.end()) {
+        return &it->second->program;
+    }
+    auto entry = std::make_unique<Entry>();
+    if (!entry->program.compile(text, m_variables)) {
+        return nullptr;
+    }
+    entry->text = text;
+    // scripts rarely have this many distinct expressions, just start over
+    if (m_programs.size() == max_programs) {
+        m_programs.clear();
+    }
+    const std::string_view key = entry->text;
+    return &m_programs.emplace(key, std::move(entry)).first->second->program;
+}
+
+bool FoldBlock::open(const double current, const std::string & line, const Options & options)
+{
+    static const Variables none;
+    return open(current, line, options, none);
+}
+
+bool FoldBlock::open(const double current, const std::string & line, const Options & options, const Variables & variables)
+{
+    const auto close = line.find(')');
+    if (line.empty() || line[0] != '(' || close == std::string::npos) {
+        return false;
+    }
+    const auto i = skip_ws(line, close + 1);
+    if (i == line.size() || line[i] != '{' || skip_ws(line, i + 1) != line.size()) {
+        return false;
+    }
+    std::size_t pos = 0;
+    const PhaseScope scope(Phase::ParseOp);
+    m_op = parse_op(line, pos);
+    m_current = current;
+    m_acc = current;
+    m_active = true;
+    m_good = m_op != Op::ERR;
+    m_absorbed = false;
+    m_any_operand = false;
+    m_short_circuit = options.short_circuit;
+    m_full_numbers = options.full_numbers;
+    m_variables = &variables;
+    if (m_good && (m_op == Op::SET || arity(m_op) != 2)) {
+        std::cerr << "Wrong operation left fold" << std::endl;
+        m_good = false;
+    }
+    return true;
+}
+
+bool FoldBlock::feed(const std::string & line)
+{
+    if (closes_block(line)) {
+        if (m_good && !m_any_operand) {
+            std::cerr << "No argument for a binary operation" << std::endl;
+            m_good = false;
+        }
+        m_active = false;
+        return true;
+    }
+    const PhaseScope scope(Phase::ParseArg);
+    mark_op(m_op);
+    for (std::size_t i = skip_ws(line, 0); m_good && i < line.size(); i = skip_ws(line, i)) {
+        const auto begin = i;
+        while (i < line.size() && !std::isspace(line[i])) {
+            ++i;
+        }
+        const std::string_view token(line.data() + begin, i - begin);
+        m_any_operand = true;
+        // a variable may still change what historical operands can't
+        if (m_absorbed && (token[0] != '$' || absorbing(m_op, m_acc, true))) {
+            const double value = validate_operand(token, m_good, m_full_numbers, *m_variables);
+            m_good = m_good && check_divisor(m_op, value);
+            continue;
+        }
+        std::size_t pos = 0;
+        mark_phase(Phase::ParseArg);
+        const auto arg = parse_operand(token, pos, m_good, m_full_numbers, *m_variables);
+        mark_phase(Phase::Fold);
+        m_acc = binary(m_op, m_acc, arg, m_good);
+        m_absorbed = m_short_circuit && absorbing(m_op, m_acc, m_full_numbers);
+    }
+    return false;
+}
+
+} // namespace calc
+
 double process_line(const double current, const std::string & line)
 {
+    return process_line(current, line, calc::Options{});
+}
+
+double process_line(const double current, const std::string & line, const calc::Options & options)
+{
+    calc::Context context;
+    return process_line(current, line, options, context);
+}
+
+double process_line(const double current, const std::string & line, const calc::Options & options, calc::Context & context)
+{
+    const calc::PhaseScope scope(Phase::ParseOp);
+    if (!line.empty() && line[0] == '>') {
+        if (const auto name = calc::assigned_name(line); !name.empty()) {
+            context.variables().assign(name, current);
+        }
+        return current;
+    }
+    if (!line.empty() && line[0] == '=') {
+        calc::mark_phase(Phase::Expression);
+        const auto * program = context.program(std::string_view(line).substr(1));
+        double res = 0;
+        return program != nullptr && program->run(current, res, context.variables().values()) ? res : current;
+    }
     std::size_t i = 0;
     const auto op = parse_op(line, i);
+    calc::mark_op(op);
     switch (arity(op)) {
     case 2: {
-        auto res = current;
-        i = skip_brackets(line, i);
-        std::vector<std::string> numbers = parse_number(line, i);
+        // parse_op() only accepts a bracket when a closing one follows
+        if (line[0] == '(') {
+            return process_fold(current, op, line, skip_brackets(line, i), options, context.variables());
+        }
+        i = skip_ws(line, i);
+        if (i == line.size()) {
+            std::cerr << "No argument for a binary operation" << std::endl;
+            return current;
+        }
+        const auto old_i = i;
         bool good = true;
-        for (const auto & str_number : numbers) {
-            double arg;
-            // проверка для обхода пробельного бага в тесте : '+ 1 '
-            if (is_fold(line)) {
-                if (op == Op::SET) {
-                    std::cerr << "Wrong operation left fold" << std::endl;
-                    return current;
-                }
-                i = 0;
-                arg = parse_arg(str_number, i, good);
-            }
-            else {
-                i = skip_ws(line, i);
-                const auto old_i = i;
-                arg = parse_arg(line, i, good);
-                //также эта проверка только из-за теста, где для случая '+ -'и др. требуется два cerr: Parsing Err и No arguments
-                //хотя я думаю, что только ошибки парсинга было бы достаточно
-                if (i == old_i) {
-                    std::cerr << "No argument for a binary operation" << std::endl;
-                    return current;
-                }
-            }
-            res = binary(op, res, arg, good);
-            if (!good) {
-                return current;
-            }
+        calc::mark_phase(Phase::ParseArg);
+        const auto arg = parse_operand(line, i, good, options.full_numbers, context.variables());
+        //эта проверка только из-за теста, где для случая '+ -'и др. требуется два cerr: Parsing Err и No arguments
+        //хотя я думаю, что только ошибки парсинга было бы достаточно
+        if (i == old_i) {
+            std::cerr << "No argument for a binary operation" << std::endl;
+            return current;
         }
-        return res;
+        calc::mark_phase(Phase::Fold);
+        const auto res = binary(op, current, arg, good);
+        return good ? res : current;
     }
     case 1: {
         if (i < line.size()) {
             std::cerr << "Unexpected suffix for a unary operation: '" << line.substr(i) << "'" << std::endl;
             break;
         }
+        calc::mark_phase(Phase::Fold);
         return unary(current, op);
     }
     default: break;
     }
     return current;
 }
+
+void process_batch(const std::span<double> registers, const std::string & line, const calc::Options & options)
+{
+    if (registers.empty()) {
+        return;
+    }
+    const auto compiled = calc::compile_line(line, options);
+    if (compiled.kind == calc::CompiledLine::Kind::Dynamic) {
+        for (auto & current : registers) {
+            current = process_line(current, line, options);
+        }
+        return;
+    }
+    calc::apply_line(compiled, registers, options);
+}
+
+namespace calc {
+
+CompiledLine compile_line(const std::string & line, const Options & options, const Variables & variables)
+{
+    CompiledLine res;
+    if (line.empty() || line[0] == '>' || line[0] == '=') {
+        res.kind = CompiledLine::Kind::Dynamic;
+        return res;
+    }
+    const PhaseScope scope(Phase::ParseOp);
+    std::size_t i = 0;
+    const auto op = parse_op(line, i);
+    mark_op(op);
+    const bool full = options.full_numbers;
+    // a variable is kept as its slot and returns true, its value is only
+    // known (and checked) in apply_line()
+    const auto add_operand = [&](const std::string_view text, std::size_t & pos, bool & good) {
+        constexpr auto no_slot = std::string_view::npos;
+        auto end = pos;
+        const auto slot = pos < text.size() && text[pos] == '$' ? variables.find(parse_variable_name(text, end)).value_or(no_slot) : no_slot;
+        res.args.push_back(parse_operand(text, pos, good, full, variables));
+        if (slot != no_slot) {
+            res.loads.emplace_back(res.args.size() - 1, slot);
+        }
+        return slot != no_slot;
+    };
+    switch (arity(op)) {
+    case 2: {
+        mark_phase(Phase::ParseArg);
+        bool good = true;
+        if (line[0] == '(') {
+            const auto tokens = split_tokens(line, skip_brackets(line, i));
+            if (tokens.empty()) {
+                std::cerr << "No argument for a binary operation" << std::endl;
+                return res;
+            }
+            if (op == Op::SET) {
+                std::cerr << "Wrong operation left fold" << std::endl;
+                return res;
+            }
+            // fixed_fold() in its order, variables are never fixed point
+            const auto variable = [](const std::string_view token) { return token[0] == '$'; };
+            if (options.fixed_point && (op == Op::ADD || op == Op::SUB || op == Op::MUL) && std::none_of(tokens.begin(), tokens.end(), variable)) {
+                res.integers.resize(tokens.size());
+                res.fractions.resize(tokens.size());
+                for (std::size_t k = 0; k < tokens.size(); ++k) {
+                    std::size_t pos = 0;
+                    parse_fixed(tokens[k], pos, good, res.integers[k], res.fractions[k]);
+                    if (!good) {
+                        return res;
+                    }
+                }
+            }
+            // the checks of the operand by operand loop, in its order
+            for (const auto token : tokens) {
+                std::size_t pos = 0;
+                const bool variable = add_operand(token, pos, good);
+                if ((!variable && !check_divisor(op, res.args.back())) || !good) {
+                    return res;
+                }
+            }
+        }
+        else {
+            i = skip_ws(line, i);
+            const auto old_i = i;
+            bool variable = false;
+            if (i < line.size()) {
+                variable = add_operand(line, i, good);
+            }
+            if (i == old_i) {
+                std::cerr << "No argument for a binary operation" << std::endl;
+                return res;
+            }
+            if ((!variable && !check_divisor(op, res.args.back())) || !good) {
+                return res;
+            }
+        }
+        break;
+    }
+    case 1:
+        if (i < line.size()) {
+            std::cerr << "Unexpected suffix for a unary operation: '" << line.substr(i) << "'" << std::endl;
+            return res;
+        }
+        break;
+    default: return res;
+    }
+    res.kind = CompiledLine::Kind::Ops;
+    res.op = op;
+    return res;
+}
+
+void apply_line(const CompiledLine & line, const std::span<double> registers, const Options & options, const std::vector<double> & values)
+{
+    if (line.kind != CompiledLine::Kind::Ops) {
+        return;
+    }
+    const PhaseScope scope(Phase::Fold);
+    if (line.op == Op::NEG) {
+        for (auto & current : registers) {
+            current = -current;
+        }
+        return;
+    }
+    if (line.op == Op::SQRT) {
+        sqrt_lanes(registers.data(), registers.size());
+        for (const auto current : registers) {
+            if (!(current > 0)) {
+                std::cerr << "Bad argument for SQRT: " << current << std::endl;
+            }
+        }
+        return;
+    }
+    if (!line.integers.empty()) {
+        for (auto & current : registers) {
+            if (Fixed acc; to_fixed(current, acc) && fixed_fold(line.op, acc, line.integers, line.fractions)) {
+                current = to_double(acc);
+                continue;
+            }
+            // out of the fixed-point range, fall back to binary floating point
+            for (const auto arg : line.args) {
+                apply_lanes(line.op, std::span(&current, 1), arg, options.strict);
+            }
+        }
+        return;
+    }
+    if (line.loads.empty()) {
+        for (const auto arg : line.args) {
+            apply_lanes(line.op, registers, arg, options.strict);
+        }
+        return;
+    }
+    // the values of the variables are checked before any arg is applied, so
+    // the registers are left as they are on an error
+    for (const auto & [k, slot] : line.loads) {
+        if (!check_divisor(line.op, values[slot])) {
+            return;
+        }
+    }
+    auto load = line.loads.begin();
+    for (std::size_t k = 0; k < line.args.size(); ++k) {
+        auto arg = line.args[k];
+        if (load != line.loads.end() && load->first == k) {
+            arg = values[load->second];
+            ++load;
+        }
+        apply_lanes(line.op, registers, arg, options.strict);
+    }
+}
+
+} // namespace calc
@@ -0,0 +1,144 @@
+#include "capture.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace calc {
+
+namespace {
+
+constexpr std::size_t block_size = 1 << 16;
+constexpr std::size_t header_size = 12;
+
+std::uint64_t read_le(const unsigned char * p, const int bytes)
+{
+    std::uint64_t value = 0;
+    for (int k = bytes - 1; k >= 0; --k) {
+        value = (value << 8) | p[k];
+    }
+    return value;
+}
+
+void write_le(std::string & out, const std::uint64_t value, const int bytes)
+{
+    for (int k = 0; k < bytes; ++k) {
+        out += static_cast<char>((value >> (8 * k)) & 0xFF);
+    }
+}
+
+} // anonymous namespace
+
+Capture::~Capture()
+{
+    close();
+}
+
+bool Capture::open(const std::string & path)
+{
+    close();
+    m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        std::cerr << "Can't open " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    m_path = path;
+    m_buffer.reserve(2 * block_size);
+    m_start = std::chrono::steady_clock::now();
+    m_error = 0;
+    return true;
+}
+
+void Capture::add(const std::string_view data)
+{
+    if (m_fd < 0) {
+        return;
+    }
+    const auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+    write_le(m_buffer, static_cast<std::uint64_t>(time), 8);
+    write_le(m_buffer, data.size(), 4);
+    m_buffer.append(data);
+    if (m_buffer.size() >= block_size) {
+        write_out();
+    }
+}
+
+void Capture::write_out()
+{
+    std::size_t done = 0;
+    while (done < m_buffer.size() && m_error == 0) {
+        const auto n = write(m_fd, m_buffer.data() + done, m_buffer.size() - done);
+        if (n >= 0) {
+            done += static_cast<std::size_t>(n);
+        }
+        else if (errno != EINTR) {
+            m_error = errno;
+        }
+    }
+    m_buffer.clear();
+}
+
+bool Capture::close()
+{
+    if (m_fd < 0) {
+        return true;
+    }
+    write_out();
+    if (::close(m_fd) != 0 && m_error == 0) {
+        m_error = errno;
+    }
+    m_fd = -1;
+    if (m_error != 0) {
+        std::cerr << "Can't write the capture " << m_path << ": " << std::strerror(m_error) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool load_capture(const std::string & path, std::vector<CapturedLine> & lines)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "Can't open " << path << std::endl;
+        return false;
+    }
+    std::ostringstream buffer;
+    buffer << in.rdbuf();
+    const std::string content = buffer.str();
+    const auto * bytes = reinterpret_cast<const unsigned char *>(content.data());
+    lines.clear();
+    std::string line;
+    std::uint64_t time = 0;
+    for (std::size_t pos = 0; pos < content.size();) {
+        if (content.size() - pos < header_size || content.size() - pos - header_size < read_le(bytes + pos + 8, 4)) {
+            std::cerr << path << ": truncated capture record at byte " << pos << std::endl;
+            return false;
+        }
+        time = read_le(bytes + pos, 8);
+        const std::size_t size = read_le(bytes + pos + 8, 4);
+        const std::string_view data(content.data() + pos + header_size, size);
+        pos += header_size + size;
+        for (std::size_t begin = 0; begin < data.size();) {
+            const auto end = data.find('\n', begin);
+            if (end == std::string_view::npos) {
+                line.append(data.substr(begin));
+                break;
+            }
+            line.append(data.substr(begin, end - begin));
+            lines.push_back({time, std::move(line)});
+            line.clear();
+            begin = end + 1;
+        }
+    }
+    if (!line.empty()) {
+        lines.push_back({time, std::move(line)});
+    }
+    return true;
+}
+
+} // namespace calc
@@ -0,0 +1,174 @@
+#include "cli.h"
+
+#include <iostream>
+#include <sstream>
+#include <string_view>
+
+namespace calc {
+
+void print_usage(std::ostream & out, const char * program)
+{
+    out << "Usage: " << program << " [options] < script\n"
+        << "  --fast             allow reassociating folds (not bit-exact)\n"
+        << "  --short-circuit    skip fold arithmetic once the result is known\n"
+        << "  --two-phase        validate '/', '%' and '^' folds before computing\n"
+        << "  --fixed-point      exact decimal '+', '-' and '*' folds\n"
+        << "  --full-numbers     operands of any length, with sign and exponent\n"
+        << "  --capture PATH     record the input lines with their arrival times for bench_replay\n"
+        << "  --sample PATH      estimate the '(+)' fold over the operands of a file\n"
+        << "  --samples N        sample size of --sample, default " << SampleConfig{}.samples << "\n"
+        << "  --reservoir        sample uniformly over operands instead of file offsets\n"
+        << "  --confidence C     confidence level of the interval, default " << SampleConfig{}.confidence << "\n"
+        << "  --serve SOCKET     serve scripts of named sessions on a Unix socket\n"
+        << "  --datagram SOCKET  serve a datagram of lines per request on a Unix datagram socket\n"
+        << "  --log PATH         command log of --serve, sessions are recovered from it\n"
+        << "  --registers PATH   register table of --serve, survives restarts without a log\n"
+        << "  --commit-window US how long --serve batches commands per log sync, default "
+        << ServerConfig{}.commit_window.count() << "\n"
+        << "  --huge-pages MODE  back large buffers with huge pages: thp (transparent) or explicit\n"
+        << "  --profile          sample the run and print a breakdown by phase and operation\n"
+        << "  --line-costs N     time every line, print the N most expensive and the time by operation\n"
+        << "  --config PATH      tuning config, default " << default_tuning_path() << "\n"
+        << "  --autotune         measure engine crossovers and write the config\n"
+        << "  --help             show this message\n";
+}
+
+bool parse_cli(const int argc, const char * const * argv, Cli & cli)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        const auto value = [&]() -> const char * {
+            if (i + 1 < argc) {
+                return argv[++i];
+            }
+            std::cerr << "Missing value for " << arg << std::endl;
+            return nullptr;
+        };
+        if (arg == "--fast") {
+            cli.options.strict = false;
+        }
+        else if (arg == "--short-circuit") {
+            cli.options.short_circuit = true;
+        }
+        else if (arg == "--two-phase") {
+            cli.options.two_phase = true;
+        }
+        else if (arg == "--fixed-point") {
+            cli.options.fixed_point = true;
+        }
+        else if (arg == "--full-numbers") {
+            cli.options.full_numbers = true;
+        }
+        else if (arg == "--sample" || arg == "--capture") {
+            const char * path = value();
+            if (path == nullptr) {
+                return false;
+            }
+            (arg == "--sample" ? cli.sample_path : cli.capture_path) = path;
+        }
+        else if (arg == "--samples" || arg == "--confidence" || arg == "--line-costs") {
+            const char * number = value();
+            if (number == nullptr) {
+                return false;
+            }
+            std::istringstream in(number);
+            const bool good = arg == "--samples" ? static_cast<bool>(in >> cli.sample.samples) : arg == "--line-costs" ? static_cast<bool>(in >> cli.line_costs) : static_cast<bool>(in >> cli.sample.confidence);
+            if (!good || !in.eof()) {
+                std::cerr << "Bad value for " << arg << ": " << number << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--serve" || arg == "--log" || arg == "--registers") {
+            const char * path = value();
+            if (path == nullptr) {
+                return false;
+            }
+            (arg == "--serve" ? cli.server.socket_path : arg == "--log" ? cli.server.log_path : cli.server.registers_path) = path;
+        }
+        else if (arg == "--datagram") {
+            const char * path = value();
+            if (path == nullptr) {
+                return false;
+            }
+            cli.datagram.socket_path = path;
+        }
+        else if (arg == "--commit-window") {
+            const char * number = value();
+            if (number == nullptr) {
+                return false;
+            }
+            std::istringstream in(number);
+            long long microseconds;
+            if (!(in >> microseconds) || !in.eof() || microseconds < 0) {
+                std::cerr << "Bad value for " << arg << ": " << number << std::endl;
+                return false;
+            }
+            cli.server.commit_window = std::chrono::microseconds(microseconds);
+        }
+        else if (arg == "--huge-pages") {
+            const char * mode = value();
+            if (mode == nullptr) {
+                return false;
+            }
+            const std::string_view name = mode;
+            if (name == "thp") {
+                cli.huge_pages = HugePages::Transparent;
+            }
+            else if (name == "explicit") {
+                cli.huge_pages = HugePages::Explicit;
+            }
+            else {
+                std::cerr << "Bad value for " << arg << ": " << mode << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--profile") {
+            cli.profile = true;
+        }
+        else if (arg == "--reservoir") {
+            cli.sample.method = Sampling::Reservoir;
+        }
+        else if (arg == "--config") {
+            const char * path = value();
+            if (path == nullptr) {
+                return false;
+            }
+            cli.config_path = path;
+        }
+        else if (arg == "--autotune") {
+            cli.autotune = true;
+        }
+        else if (arg == "--help") {
+            cli.help = true;
+            return true;
+        }
+        else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            print_usage(std::cerr, argv[0]);
+            return false;
+        }
+    }
+    if ((!cli.server.log_path.empty() || !cli.server.registers_path.empty()) && cli.server.socket_path.empty()) {
+        std::cerr << "--log and --registers need --serve" << std::endl;
+        return false;
+    }
+    if (!cli.server.socket_path.empty() && !cli.datagram.socket_path.empty()) {
+        std::cerr << "--serve and --datagram are exclusive" << std::endl;
+        return false;
+    }
+    if (cli.autotune) {
+        return true;
+    }
+    if (!cli.config_path.empty()) {
+        if (!load_tuning(cli.config_path, cli.options.tuning)) {
+            std::cerr << "Can't load tuning config " << cli.config_path << std::endl;
+            return false;
+        }
+    }
+    else {
+        load_tuning(default_tuning_path(), cli.options.tuning);
+    }
+    return true;
+}
+
+} // namespace calc
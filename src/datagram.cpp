@@ -0,0 +1,206 @@
+#include "datagram.h"
+
+#include "output.h"
+#include "profiler.h"
+#include "server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace calc {
+
+namespace {
+
+constexpr std::string_view session_command = "@session";
+
+} // anonymous namespace
+
+DatagramServer::DatagramServer(const DatagramConfig & config)
+    : m_config(config)
+{
+}
+
+DatagramServer::~DatagramServer()
+{
+    if (m_socket >= 0) {
+        close(m_socket);
+        unlink(m_config.socket_path.c_str());
+    }
+    for (const int fd : m_wake) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+bool DatagramServer::open()
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (m_config.socket_path.empty() || m_config.socket_path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Bad socket path: '" << m_config.socket_path << "'" << std::endl;
+        return false;
+    }
+    std::memcpy(address.sun_path, m_config.socket_path.c_str(), m_config.socket_path.size());
+    // a socket left by a previous run
+    unlink(m_config.socket_path.c_str());
+    m_socket = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_socket < 0 || bind(m_socket, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 || pipe2(m_wake, O_NONBLOCK | O_CLOEXEC) != 0) {
+        std::cerr << "Can't bind " << m_config.socket_path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool DatagramServer::run()
+{
+    const auto batch = std::max<std::size_t>(1, m_config.batch);
+    const auto size = std::max<std::size_t>(1, m_config.max_datagram);
+    std::vector<char> buffer(batch * size);
+    std::vector<sockaddr_un> senders(batch);
+    std::vector<iovec> in_iov(batch);
+    std::vector<iovec> out_iov(batch);
+    std::vector<mmsghdr> in(batch);
+    std::vector<mmsghdr> out(batch);
+    std::vector<std::string> answers(batch);
+    pollfd fds[] = {{m_socket, POLLIN, 0}, {m_wake[0], POLLIN, 0}};
+    for (;;) {
+        if (poll(fds, 2, -1) < 0 && errno != EINTR) {
+            std::cerr << "Can't poll the socket: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        if (fds[1].revents != 0) {
+            return true;
+        }
+        if (fds[0].revents == 0) {
+            continue;
+        }
+        // a batch at a time until the socket is drained
+        for (std::size_t got = batch; got == batch;) {
+            for (std::size_t k = 0; k < batch; ++k) {
+                in_iov[k] = {buffer.data() + k * size, size};
+                in[k] = {};
+                in[k].msg_hdr.msg_name = &senders[k];
+                in[k].msg_hdr.msg_namelen = sizeof(sockaddr_un);
+                in[k].msg_hdr.msg_iov = &in_iov[k];
+                in[k].msg_hdr.msg_iovlen = 1;
+            }
+            mark_phase(Phase::Read);
+            const int n = recvmmsg(m_socket, in.data(), static_cast<unsigned>(batch), MSG_DONTWAIT, nullptr);
+            mark_phase(Phase::Other);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                std::cerr << "Can't receive: " << std::strerror(errno) << std::endl;
+                return false;
+            }
+            got = static_cast<std::size_t>(n);
+            m_batches += got != 0;
+            m_datagrams += got;
+            std::size_t answered = 0;
+            for (std::size_t k = 0; k < got; ++k) {
+                auto & answer = answers[k];
+                answer.clear();
+                if ((in[k].msg_hdr.msg_flags & MSG_TRUNC) != 0) {
+                    std::cerr << "Datagram longer than " << size << " bytes" << std::endl;
+                    answer = "@error\n";
+                }
+                else {
+                    handle(std::string_view(buffer.data() + k * size, in[k].msg_len), answer);
+                }
+                // an unbound sender has no address to answer to
+                if (in[k].msg_hdr.msg_namelen <= offsetof(sockaddr_un, sun_path)) {
+                    ++m_dropped;
+                    continue;
+                }
+                out_iov[answered] = {answer.data(), answer.size()};
+                out[answered] = {};
+                out[answered].msg_hdr.msg_name = &senders[k];
+                out[answered].msg_hdr.msg_namelen = in[k].msg_hdr.msg_namelen;
+                out[answered].msg_hdr.msg_iov = &out_iov[answered];
+                out[answered].msg_hdr.msg_iovlen = 1;
+                ++answered;
+            }
+            const PhaseScope scope(Phase::Write);
+            for (std::size_t sent = 0; sent < answered;) {
+                const int m = sendmmsg(m_socket, out.data() + sent, static_cast<unsigned>(answered - sent), MSG_DONTWAIT);
+                if (m > 0) {
+                    sent += static_cast<std::size_t>(m);
+                    continue;
+                }
+                if (m < 0 && errno == EINTR) {
+                    continue;
+                }
+                // the sender is gone or has no room for it
+                ++m_dropped;
+                ++sent;
+            }
+        }
+    }
+}
+
+void DatagramServer::stop()
+{
+    const char byte = 0;
+    [[maybe_unused]] const auto n = write(m_wake[1], &byte, 1);
+}
+
+std::optional<double> DatagramServer::current(const std::string_view name) const
+{
+    const auto it = m_sessions.find(name);
+    if (it == m_sessions.end()) {
+        return std::nullopt;
+    }
+    return it->second.current();
+}
+
+Session & DatagramServer::session(const std::string_view name)
+{
+    auto it = m_sessions.find(name);
+    if (it == m_sessions.end()) {
+        it = m_sessions.emplace(std::string(name), Session(m_config.options)).first;
+    }
+    return it->second;
+}
+
+void DatagramServer::handle(const std::string_view datagram, std::string & answer)
+{
+    auto * current = &session("default");
+    for (std::size_t begin = 0; begin < datagram.size();) {
+        const auto end = std::min(datagram.find('\n', begin), datagram.size());
+        const auto line = datagram.substr(begin, end - begin);
+        begin = end + 1;
+        if (line.starts_with(session_command) && (line.size() == session_command.size() || line[session_command.size()] == ' ')) {
+            const auto name = line.substr(std::min(line.size(), session_command.size() + 1));
+            if (!valid_session_name(name)) {
+                // the rest of the datagram was meant for another session
+                std::cerr << "Bad session name: '" << name << "'" << std::endl;
+                answer += "@error\n";
+                return;
+            }
+            current = &session(name);
+            continue;
+        }
+        m_line.assign(line);
+        if (const auto value = current->feed(m_line)) {
+            const PhaseScope scope(Phase::Format);
+            char record[max_record];
+            answer.append(record, format_record(*value, record));
+        }
+    }
+}
+
+} // namespace calc
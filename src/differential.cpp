@@ -0,0 +1,331 @@
+#include "differential.h"
+
+#include "calc.h"
+#include "reference.h"
+#include "session.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+namespace calc {
+
+namespace {
+
+const char * const ops[] = {"+", "-", "*", "/", "%", "^", "_", "SQRT"};
+// what noise is made of
+const char noise[] = "0123456789.  \t()+-*/%^_SQRTx";
+
+bool same_value(const double a, const double b)
+{
+    return a == b ? std::signbit(a) == std::signbit(b) : std::isnan(a) && std::isnan(b);
+}
+
+std::string quoted(const std::string & text)
+{
+    std::string res = "'";
+    for (const char c : text) {
+        res += c == '\'' ? std::string("'\\''") : std::string(1, c);
+    }
+    return res + "'";
+}
+
+// whether the fixed-point mode computes from the register in decimal: it has
+// no digits below 10^-10 and fits
+bool on_fixed_grid(const double current)
+{
+    char text[512];
+    std::snprintf(text, sizeof(text), "%.10f", current);
+    return std::fabs(current) < 1e27 && std::strtod(text, nullptr) == current;
+}
+
+std::string repeated(const char * op, const char * operand, const std::size_t count)
+{
+    std::string res = op;
+    for (std::size_t k = 0; k < count; ++k) {
+        res += ' ';
+        res += operand;
+    }
+    return res;
+}
+
+} // anonymous namespace
+
+std::vector<Mode> modes()
+{
+    Options fast;
+    fast.strict = false;
+    fast.tuning.simd_min_operands = 1;
+    fast.tuning.parallel_min_operands = 2;
+    fast.tuning.parallel_grain = 2;
+    const auto with = [](const Options & options) {
+        return [options](const double current, const std::string & line) { return process_line(current, line, options); };
+    };
+    Options short_circuit;
+    short_circuit.short_circuit = true;
+    Options two_phase;
+    two_phase.two_phase = true;
+    Options both = short_circuit;
+    both.two_phase = true;
+    Options fixed_point;
+    fixed_point.fixed_point = true;
+    Options fixed_two_phase = fixed_point;
+    fixed_two_phase.two_phase = true;
+    Options full_numbers;
+    full_numbers.full_numbers = true;
+    Options full_two_phase = full_numbers;
+    full_two_phase.two_phase = true;
+    Options full_short_circuit = full_numbers;
+    full_short_circuit.short_circuit = true;
+    const auto batch = [](const Options & options) {
+        return [options](const double current, const std::string & line) {
+            double registers[] = {current};
+            process_batch(registers, line, options);
+            return registers[0];
+        };
+    };
+    Options not_strict;
+    not_strict.strict = false;
+    auto context = std::make_shared<Context>();
+    return {
+            {"default", "", Agreement::Exact, "", [](const double current, const std::string & line) { return process_line(current, line); }},
+            {"context", "", Agreement::Exact, "", [context](const double current, const std::string & line) { return process_line(current, line, {}, *context); }},
+            {"session", "", Agreement::Exact, "", [](const double current, const std::string & line) { return Session({}, current).feed(line).value_or(current); }},
+            {"short-circuit", "--short-circuit", Agreement::Exact, "", with(short_circuit)},
+            {"two-phase", "--two-phase", Agreement::Exact, "", with(two_phase)},
+            {"short-circuit two-phase", "--short-circuit --two-phase", Agreement::Exact, "", with(both)},
+            // fmod() turns the last bit of a correctly rounded operand into any value below the divisor
+            {"full-numbers", "--full-numbers", Agreement::Extends, "%", with(full_numbers)},
+            {"full-numbers two-phase", "--full-numbers --two-phase", Agreement::Extends, "%", with(full_two_phase)},
+            {"full-numbers short-circuit", "--full-numbers --short-circuit", Agreement::Extends, "%", with(full_short_circuit)},
+            // products are rounded to 10 decimals, later operands magnify the difference
+            {"fixed-point", "--fixed-point", Agreement::Close, "*", with(fixed_point)},
+            {"fixed-point two-phase", "--fixed-point --two-phase", Agreement::Close, "*", with(fixed_two_phase)},
+            // a register off the fixed-point grid is computed as usual, products too
+            {"fixed-point off-grid", "--fixed-point", Agreement::Exact, "",
+             [fixed_point](const double current, const std::string & line) {
+                 return on_fixed_grid(current) ? reference::process_line(current, line) : process_line(current, line, fixed_point);
+             }},
+            {"batch", "", Agreement::Exact, "", batch({})},
+            // the vector pow is within 1 ULP
+            {"batch fast", "--fast", Agreement::Close, "", batch(not_strict)},
+            {"batch fixed-point", "--fixed-point", Agreement::Close, "*", batch(fixed_point)},
+            {"fast", "--fast --config <(printf 'simd_min_operands=1\\nparallel_min_operands=2\\nparallel_grain=2\\n')", Agreement::Close, "", with(fast)},
+    };
+}
+
+Outcome run_captured(const std::function<double(double, const std::string &)> & process, const double current, const std::string & line)
+{
+    std::ostringstream messages;
+    auto * const saved = std::cerr.rdbuf(messages.rdbuf());
+    const double value = process(current, line);
+    std::cerr.rdbuf(saved);
+    return {value, messages.str()};
+}
+
+Agreement agreement(const Mode & mode, const std::string & line)
+{
+    if (mode.loose.empty() || line.find_first_of(mode.loose) == std::string::npos) {
+        return mode.agreement;
+    }
+    return mode.agreement == Agreement::Extends ? Agreement::Accepts : Agreement::Messages;
+}
+
+bool agrees(const Agreement agreement, const Outcome & reference, const Outcome & outcome)
+{
+    switch (agreement) {
+    case Agreement::Exact:
+        return reference.messages == outcome.messages && same_value(reference.value, outcome.value);
+    case Agreement::Close:
+        return reference.messages == outcome.messages &&
+                (same_value(reference.value, outcome.value) ||
+                 std::fabs(reference.value - outcome.value) <= 1e-9 * std::fmax(1, std::fmax(std::fabs(reference.value), std::fabs(outcome.value))));
+    case Agreement::Extends:
+        return !reference.messages.empty() || agrees(Agreement::Close, reference, outcome);
+    case Agreement::Messages:
+        return reference.messages == outcome.messages;
+    case Agreement::Accepts:
+        return !reference.messages.empty() || outcome.messages.empty();
+    }
+    return false;
+}
+
+LineGenerator::LineGenerator(const std::uint64_t seed)
+    : m_random(seed)
+{
+}
+
+std::string LineGenerator::number()
+{
+    if (m_random() % 8 == 0) {
+        return "0";
+    }
+    // mostly short, sometimes over the 10 digits limit
+    const std::size_t digits = m_random() % 8 == 0 ? 8 + m_random() % 5 : 1 + m_random() % 6;
+    const std::size_t point = m_random() % 3 == 0 ? m_random() % (digits + 1) : digits + 1;
+    std::string res;
+    for (std::size_t k = 0; k < digits; ++k) {
+        if (k == point) {
+            res += '.';
+        }
+        res += static_cast<char>('0' + m_random() % 10);
+    }
+    return res;
+}
+
+std::string LineGenerator::line()
+{
+    const auto spaces = [this] { return std::string(m_random() % 4 == 0 ? m_random() % 3 : 1, m_random() % 8 == 0 ? '\t' : ' '); };
+    std::string res;
+    const auto kind = m_random() % 8;
+    if (kind < 3) {
+        if (m_random() % 9 != 0) {
+            res += ops[m_random() % std::size(ops)];
+            res += spaces();
+        }
+        if (m_random() % 6 != 0) {
+            res += number();
+        }
+    }
+    else {
+        // appended piece by piece, GCC 12 sees a bogus overlap in a chain of '+'
+        res += '(';
+        res += m_random() % 12 == 0 ? "1" : ops[m_random() % std::size(ops)];
+        res += ')';
+        const std::size_t operands = m_random() % 10;
+        for (std::size_t k = 0; k < operands; ++k) {
+            res += spaces();
+            res += number();
+        }
+    }
+    if (m_random() % 4 == 0) {
+        for (auto edits = 1 + m_random() % 3; edits > 0; --edits) {
+            const std::size_t at = m_random() % (res.size() + 1);
+            const char c = noise[m_random() % (sizeof(noise) - 1)];
+            switch (m_random() % 3) {
+            case 0: res.insert(at, 1, c); break;
+            case 1: res.erase(at, 1); break;
+            default: res.replace(at, 1, 1, c); break;
+            }
+        }
+    }
+    return res;
+}
+
+std::vector<std::string> LineGenerator::setup()
+{
+    std::string value = std::to_string(1 + m_random() % 999);
+    value += '.';
+    value += static_cast<char>('0' + m_random() % 10);
+    std::string add = "+ ";
+    add += value;
+    std::vector<std::string> res;
+    switch (m_random() % 8) {
+    case 0: break;
+    case 1:
+    case 2: res = {add}; break;
+    // 10^-9 a step, subnormal past 34 of them
+    case 3: res = {add, repeated("(/)", "1000000000", 1 + m_random() % 35)}; break;
+    case 4: res = {add, repeated("(*)", "1000000000", 1 + m_random() % 34)}; break;
+    case 5: res = {"+ 1", repeated("(*)", "1000000000", 35)}; break;
+    case 6: res = {"+ 1", repeated("(*)", "1000000000", 35), "* 0"}; break;
+    default: res = {"+ 1", "(/) 3 7"}; break;
+    }
+    if (m_random() % 3 == 0) {
+        // zero turns into -0
+        res.emplace_back("_");
+    }
+    return res;
+}
+
+double LineGenerator::current()
+{
+    double res = 0;
+    for (const auto & line : setup()) {
+        res = run_captured(reference::process_line, res, line).value;
+    }
+    return res;
+}
+
+bool LineGenerator::restart()
+{
+    return m_random() % 6 == 0;
+}
+
+std::ostream & operator<<(std::ostream & out, const Divergence & divergence)
+{
+    const auto outcome = [&out](const char * name, const Outcome & value) {
+        out << name << std::setprecision(17) << value.value << "\n";
+        std::istringstream messages(value.messages);
+        for (std::string line; std::getline(messages, line);) {
+            out << "    " << line << "\n";
+        }
+    };
+    out << "Mode '" << divergence.mode << "' diverges from the reference on line " << quoted(divergence.line) << " with register "
+        << std::setprecision(17) << divergence.current << "\n";
+    outcome("  reference: ", divergence.expected);
+    outcome("  mode:      ", divergence.actual);
+    out << "  reproducer (the last result): printf '%s\\n' ";
+    for (const auto & line : divergence.script) {
+        out << quoted(line) << " ";
+    }
+    out << quoted(divergence.line) << " | calc_fold" << (divergence.flags.empty() ? "" : " ") << divergence.flags << "\n";
+    return out;
+}
+
+std::optional<Divergence> find_divergence(const Mode & mode, const std::uint64_t seed, const std::size_t lines)
+{
+    LineGenerator generator(seed);
+    std::vector<std::string> script;
+    double current = 0;
+    for (std::size_t k = 0; k < lines; ++k) {
+        if (k == 0 || generator.restart()) {
+            script = generator.setup();
+            current = 0;
+            for (const auto & line : script) {
+                current = run_captured(reference::process_line, current, line).value;
+            }
+        }
+        const std::string line = generator.line();
+        const auto expected = run_captured(reference::process_line, current, line);
+        if (!agrees(agreement(mode, line), expected, run_captured(mode.process, current, line))) {
+            const auto minimal = minimize(mode, current, line);
+            return Divergence{mode.name, mode.flags, script, current, minimal, run_captured(reference::process_line, current, minimal),
+                              run_captured(mode.process, current, minimal)};
+        }
+        // the next line goes on from here, the script reproduces it
+        script.push_back(line);
+        current = expected.value;
+    }
+    return std::nullopt;
+}
+
+std::string minimize(const Mode & mode, const double current, std::string line)
+{
+    const auto diverges = [&](const std::string & candidate) {
+        return !agrees(agreement(mode, candidate), run_captured(reference::process_line, current, candidate), run_captured(mode.process, current, candidate));
+    };
+    for (bool shrunk = true; shrunk;) {
+        shrunk = false;
+        for (std::size_t chunk = line.size(); chunk > 0; chunk /= 2) {
+            for (std::size_t at = 0; at + chunk <= line.size();) {
+                auto candidate = line;
+                candidate.erase(at, chunk);
+                if (diverges(candidate)) {
+                    line = std::move(candidate);
+                    shrunk = true;
+                }
+                else {
+                    at += chunk;
+                }
+            }
+        }
+    }
+    return line;
+}
+
+} // namespace calc
@@ -0,0 +1,283 @@
+#include "engine.h"
+
+#include "executor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace calc {
+
+namespace {
+
+bool reassociable(const Op op)
+{
+    return op == Op::ADD || op == Op::SUB || op == Op::MUL || op == Op::DIV;
+}
+
+bool is_product(const Op op)
+{
+    return op == Op::MUL || op == Op::DIV || op == Op::POW;
+}
+
+// A sum or product of the operands in some order, with bounds for every
+// partial result of any order: the sum of |a| (above) for sums; the products
+// of max(1, |a|) (above) and min(1, |a|) (below) for products. The products
+// leave NaN operands out, they make a NaN in any order.
+struct Reduction
+{
+    double value;
+    double above;
+    double below;
+};
+
+void bound(Reduction & res, const double arg, const bool product)
+{
+    const double value = std::fabs(arg);
+    if (!product) {
+        res.above += value;
+    }
+    else if (value > 1) {
+        res.above *= value;
+    }
+    else if (value < 1) {
+        res.below *= value;
+    }
+}
+
+#if defined(__x86_64__)
+bool has_avx2()
+{
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+
+__attribute__((target("avx2"))) double sum_lanes(const __m256d acc)
+{
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, acc);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+__attribute__((target("avx2"))) double product_lanes(const __m256d acc)
+{
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, acc);
+    return (lanes[0] * lanes[1]) * (lanes[2] * lanes[3]);
+}
+
+// The bounds are taken in the same pass, _mm256_max_pd() and _mm256_min_pd()
+// return the 1 for a NaN.
+__attribute__((target("avx2"))) Reduction reduce_avx2(const double * data, const std::size_t n, const bool product)
+{
+    const __m256d identity = _mm256_set1_pd(product ? 1.0 : 0.0);
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const __m256d one = _mm256_set1_pd(1.0);
+    __m256d acc0 = identity;
+    __m256d acc1 = identity;
+    __m256d above0 = identity;
+    __m256d above1 = identity;
+    __m256d below0 = one;
+    __m256d below1 = one;
+    std::size_t i = 0;
+    Reduction res;
+    if (product) {
+        for (; i + 8 <= n; i += 8) {
+            const __m256d arg0 = _mm256_loadu_pd(data + i);
+            const __m256d arg1 = _mm256_loadu_pd(data + i + 4);
+            acc0 = _mm256_mul_pd(acc0, arg0);
+            acc1 = _mm256_mul_pd(acc1, arg1);
+            const __m256d value0 = _mm256_andnot_pd(sign, arg0);
+            const __m256d value1 = _mm256_andnot_pd(sign, arg1);
+            above0 = _mm256_mul_pd(above0, _mm256_max_pd(value0, one));
+            above1 = _mm256_mul_pd(above1, _mm256_max_pd(value1, one));
+            below0 = _mm256_mul_pd(below0, _mm256_min_pd(value0, one));
+            below1 = _mm256_mul_pd(below1, _mm256_min_pd(value1, one));
+        }
+        res = {product_lanes(_mm256_mul_pd(acc0, acc1)), product_lanes(_mm256_mul_pd(above0, above1)), product_lanes(_mm256_mul_pd(below0, below1))};
+    }
+    else {
+        for (; i + 8 <= n; i += 8) {
+            const __m256d arg0 = _mm256_loadu_pd(data + i);
+            const __m256d arg1 = _mm256_loadu_pd(data + i + 4);
+            acc0 = _mm256_add_pd(acc0, arg0);
+            acc1 = _mm256_add_pd(acc1, arg1);
+            above0 = _mm256_add_pd(above0, _mm256_andnot_pd(sign, arg0));
+            above1 = _mm256_add_pd(above1, _mm256_andnot_pd(sign, arg1));
+        }
+        res = {sum_lanes(_mm256_add_pd(acc0, acc1)), sum_lanes(_mm256_add_pd(above0, above1)), 1};
+    }
+    for (; i < n; ++i) {
+        res.value = product ? res.value * data[i] : res.value + data[i];
+        bound(res, data[i], product);
+    }
+    return res;
+}
+#endif
+
+Reduction reduce_portable(const double * data, const std::size_t n, const bool product)
+{
+    const double identity = product ? 1.0 : 0.0;
+    double acc[4] = {identity, identity, identity, identity};
+    Reduction res{identity, identity, 1};
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        for (std::size_t lane = 0; lane < 4; ++lane) {
+            acc[lane] = product ? acc[lane] * data[i + lane] : acc[lane] + data[i + lane];
+            bound(res, data[i + lane], product);
+        }
+    }
+    res.value = product ? (acc[0] * acc[1]) * (acc[2] * acc[3]) : (acc[0] + acc[1]) + (acc[2] + acc[3]);
+    for (; i < n; ++i) {
+        res.value = product ? res.value * data[i] : res.value + data[i];
+        bound(res, data[i], product);
+    }
+    return res;
+}
+
+Reduction reduce(const double * data, const std::size_t n, const bool product)
+{
+#if defined(__x86_64__)
+    if (has_avx2()) {
+        return reduce_avx2(data, n, product);
+    }
+#endif
+    return reduce_portable(data, n, product);
+}
+
+Reduction parallel_reduce(const std::vector<double> & args, const bool product, std::size_t grain)
+{
+    grain = std::max<std::size_t>(grain, 1);
+    std::vector<Reduction> partial((args.size() + grain - 1) / grain);
+    const auto pool = executor();
+    parallel_for(*pool, args.size(), grain, [&](const std::size_t begin, const std::size_t end) {
+        partial[begin / grain] = reduce(args.data() + begin, end - begin, product);
+    });
+    std::vector<double> values(partial.size());
+    Reduction bounds{0, product ? 1.0 : 0.0, 1};
+    for (std::size_t k = 0; k < partial.size(); ++k) {
+        values[k] = partial[k].value;
+        bounds.above = product ? bounds.above * partial[k].above : bounds.above + partial[k].above;
+        bounds.below *= partial[k].below;
+    }
+    return {reduce(values.data(), values.size(), product).value, bounds.above, bounds.below};
+}
+
+double combine(const Op op, const double init, const double reduced)
+{
+    switch (op) {
+    case Op::ADD: return init + reduced;
+    case Op::SUB: return init - reduced;
+    case Op::MUL: return init * reduced;
+    case Op::DIV: return init / reduced;
+    case Op::POW: return std::pow(init, reduced);
+    default: return init;
+    }
+}
+
+// Whether no order of the operands can over- or underflow where the left
+// fold doesn't: every partial sum is below |init| + above; every partial
+// product lies between below and above, times |init| (divided by, for '/').
+// The margin to the double range covers the rounding of the bounds.
+bool reassociation_safe(const Op op, const double init, const Reduction & reduced)
+{
+    constexpr double top = 0x1p1000;
+    constexpr double bottom = 0x1p-1000;
+    if (!is_product(op)) {
+        return std::fabs(init) + reduced.above < top;
+    }
+    if (!(reduced.above < top && reduced.below > bottom)) {
+        return false;
+    }
+    // a zero register stays zero, whatever the product of the operands is
+    const double scale = std::fabs(init);
+    if (scale == 0) {
+        return true;
+    }
+    return op == Op::MUL ? scale * reduced.above < top && scale * reduced.below > bottom : scale / reduced.below < top && scale / reduced.above > bottom;
+}
+
+// Whether x ^ p stays a normal number for every prefix product p of the
+// exponents, so that a single pow() can't skip an overflow or underflow of
+// the left fold. Sets the product of all of them.
+bool rewritable(const double init, const std::vector<double> & args, double & exponent)
+{
+    const double scale = std::fabs(std::log2(init));
+    exponent = 1;
+    for (const auto arg : args) {
+        exponent *= arg;
+        if (!(std::fabs(exponent) * scale < 1000)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <class F>
+double left_fold(double acc, const std::vector<double> & args, F f)
+{
+    for (const auto arg : args) {
+        acc = f(acc, arg);
+    }
+    return acc;
+}
+
+double scalar(const Op op, const double init, const std::vector<double> & args)
+{
+    switch (op) {
+    case Op::ADD: return left_fold(init, args, std::plus<>());
+    case Op::SUB: return left_fold(init, args, std::minus<>());
+    case Op::MUL: return left_fold(init, args, std::multiplies<>());
+    case Op::DIV: return left_fold(init, args, std::divides<>());
+    case Op::REM: return left_fold(init, args, [](const double l, const double r) { return std::fmod(l, r); });
+    case Op::POW: return left_fold(init, args, [](const double l, const double r) { return std::pow(l, r); });
+    default: return init;
+    }
+}
+
+} // anonymous namespace
+
+const char * engine_name(const Engine engine)
+{
+    switch (engine) {
+    case Engine::Scalar: return "scalar";
+    case Engine::Simd: return "simd";
+    case Engine::Parallel: return "parallel";
+    case Engine::Rewrite: return "rewrite";
+    }
+    return "";
+}
+
+double fold(const Engine engine, const Op op, const double init, const std::vector<double> & args, const std::size_t grain)
+{
+    switch (engine) {
+    case Engine::Scalar:
+        break;
+    case Engine::Simd:
+        if (reassociable(op)) {
+            if (const auto reduced = reduce(args.data(), args.size(), is_product(op)); reassociation_safe(op, init, reduced)) {
+                return combine(op, init, reduced.value);
+            }
+        }
+        break;
+    case Engine::Parallel:
+        if (reassociable(op)) {
+            if (const auto reduced = parallel_reduce(args, is_product(op), grain); reassociation_safe(op, init, reduced)) {
+                return combine(op, init, reduced.value);
+            }
+        }
+        break;
+    case Engine::Rewrite:
+        if (double exponent; op == Op::POW && init > 0 && rewritable(init, args, exponent)) {
+            return combine(op, init, exponent);
+        }
+        break;
+    }
+    return scalar(op, init, args);
+}
+
+} // namespace calc
@@ -0,0 +1,48 @@
+#include "evaluate.h"
+
+#include <utility>
+
+namespace calc {
+
+Generator<double> evaluate(std::istream & in, const Options options)
+{
+    Session session(options);
+    for (std::string line; std::getline(in, line);) {
+        if (const auto current = session.feed(line)) {
+            co_yield *current;
+        }
+    }
+    session.finish();
+}
+
+void LineChannel::push(std::string line)
+{
+    m_lines.push_back(std::move(line));
+    wake();
+}
+
+void LineChannel::close()
+{
+    m_closed = true;
+    wake();
+}
+
+void LineChannel::wake()
+{
+    if (m_reader) {
+        std::exchange(m_reader, {}).resume();
+    }
+}
+
+AsyncGenerator<double> evaluate(LineChannel & channel, const Options options)
+{
+    Session session(options);
+    while (const auto line = co_await channel.next()) {
+        if (const auto current = session.feed(*line)) {
+            co_yield *current;
+        }
+    }
+    session.finish();
+}
+
+} // namespace calc
@@ -0,0 +1,274 @@
+#include "executor.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace calc {
+
+namespace {
+
+thread_local const WorkStealingExecutor * current_owner = nullptr;
+thread_local std::size_t current_index = 0;
+
+std::vector<int> allowed_cpus()
+{
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    return cpus;
+}
+
+void pin(std::thread & thread, const int cpu)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+    static_cast<void>(thread);
+    static_cast<void>(cpu);
+#endif
+}
+
+std::string read_file(const std::string & path)
+{
+    std::ifstream in(path);
+    std::stringstream content;
+    content << in.rdbuf();
+    return content.str();
+}
+
+std::string cgroup_path()
+{
+    std::ifstream in("/proc/self/cgroup");
+    for (std::string line; std::getline(in, line);) {
+        if (line.rfind("0::", 0) == 0) {
+            return line.substr(3);
+        }
+    }
+    return {};
+}
+
+std::size_t cgroup_cpu_limit()
+{
+    const std::string root = "/sys/fs/cgroup";
+    for (const auto & path : {root + cgroup_path() + "/cpu.max", root + "/cpu.max"}) {
+        const auto content = read_file(path);
+        if (!content.empty()) {
+            return parse_cpu_max(content);
+        }
+    }
+    long long quota = -1;
+    long long period = 0;
+    std::istringstream(read_file(root + "/cpu/cpu.cfs_quota_us")) >> quota;
+    std::istringstream(read_file(root + "/cpu/cpu.cfs_period_us")) >> period;
+    if (quota <= 0 || period <= 0) {
+        return 0;
+    }
+    return static_cast<std::size_t>((quota + period - 1) / period);
+}
+
+std::mutex global_mutex;
+std::shared_ptr<Executor> global_executor;
+
+} // anonymous namespace
+
+WorkStealingExecutor::WorkStealingExecutor(const ExecutorConfig & config)
+{
+    const std::size_t threads = config.threads != 0 ? config.threads : default_concurrency();
+    const auto cpus = allowed_cpus();
+    m_workers.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    for (std::size_t i = 0; i < threads; ++i) {
+        auto & thread = m_workers[i]->thread;
+        thread = std::thread([this, i] { run(i); });
+        if (config.pin_threads && !cpus.empty()) {
+            pin(thread, cpus[i % cpus.size()]);
+        }
+    }
+}
+
+WorkStealingExecutor::~WorkStealingExecutor()
+{
+    {
+        std::lock_guard lock(m_idle_mutex);
+        m_stop = true;
+    }
+    m_idle.notify_all();
+    for (auto & worker : m_workers) {
+        worker->thread.join();
+    }
+}
+
+std::size_t WorkStealingExecutor::concurrency() const
+{
+    return m_workers.size();
+}
+
+void WorkStealingExecutor::submit(Task task)
+{
+    // tasks spawned by a worker stay on its own deque, external ones are spread round-robin
+    const std::size_t index = current_owner == this ? current_index : m_next++ % m_workers.size();
+    {
+        auto & worker = *m_workers[index];
+        std::lock_guard lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard lock(m_idle_mutex);
+        ++m_pending;
+    }
+    m_idle.notify_one();
+}
+
+bool WorkStealingExecutor::pop(const std::size_t index, Task & task)
+{
+    bool found = false;
+    {
+        auto & own = *m_workers[index];
+        std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            found = true;
+        }
+    }
+    for (std::size_t i = 1; !found && i < m_workers.size(); ++i) {
+        auto & victim = *m_workers[(index + i) % m_workers.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            found = true;
+        }
+    }
+    if (found) {
+        std::lock_guard lock(m_idle_mutex);
+        --m_pending;
+    }
+    return found;
+}
+
+void WorkStealingExecutor::run(const std::size_t index)
+{
+    current_owner = this;
+    current_index = index;
+    Task task;
+    for (;;) {
+        if (pop(index, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+        std::unique_lock lock(m_idle_mutex);
+        m_idle.wait(lock, [this] { return m_stop || m_pending > 0; });
+        if (m_stop && m_pending <= 0) {
+            return;
+        }
+    }
+}
+
+std::size_t parse_cpu_max(const std::string & cpu_max)
+{
+    std::istringstream in(cpu_max);
+    std::string quota;
+    long long period = 0;
+    if (!(in >> quota >> period) || quota == "max" || period <= 0) {
+        return 0;
+    }
+    long long value = 0;
+    if (!(std::istringstream(quota) >> value) || value <= 0) {
+        return 0;
+    }
+    return static_cast<std::size_t>((value + period - 1) / period);
+}
+
+std::size_t default_concurrency()
+{
+    std::size_t cpus = allowed_cpus().size();
+    if (cpus == 0) {
+        cpus = std::thread::hardware_concurrency();
+    }
+    const auto limit = cgroup_cpu_limit();
+    if (limit != 0) {
+        cpus = std::min(cpus, limit);
+    }
+    return std::max<std::size_t>(cpus, 1);
+}
+
+std::shared_ptr<Executor> executor()
+{
+    std::lock_guard lock(global_mutex);
+    if (!global_executor) {
+        global_executor = std::make_shared<WorkStealingExecutor>();
+    }
+    return global_executor;
+}
+
+void set_executor(std::shared_ptr<Executor> executor)
+{
+    std::lock_guard lock(global_mutex);
+    global_executor = std::move(executor);
+}
+
+void parallel_for(Executor & executor, const std::size_t n, std::size_t grain, const std::function<void(std::size_t, std::size_t)> & body)
+{
+    grain = std::max<std::size_t>(grain, 1);
+    const std::size_t chunks = (n + grain - 1) / grain;
+    if (chunks <= 1 || executor.concurrency() <= 1) {
+        for (std::size_t begin = 0; begin < n; begin += grain) {
+            body(begin, std::min(n, begin + grain));
+        }
+        return;
+    }
+    struct State
+    {
+        std::atomic<std::size_t> next{0};
+        std::mutex mutex;
+        std::condition_variable done;
+        std::size_t finished = 0;
+    };
+    const auto state = std::make_shared<State>();
+    // helpers which start after all chunks are claimed never touch body
+    const auto work = [state, chunks, n, grain, &body] {
+        std::size_t done = 0;
+        for (std::size_t chunk = state->next++; chunk < chunks; chunk = state->next++) {
+            body(chunk * grain, std::min(n, (chunk + 1) * grain));
+            ++done;
+        }
+        if (done != 0) {
+            std::lock_guard lock(state->mutex);
+            state->finished += done;
+            if (state->finished == chunks) {
+                state->done.notify_all();
+            }
+        }
+    };
+    const auto helpers = std::min(executor.concurrency(), chunks - 1);
+    for (std::size_t i = 0; i < helpers; ++i) {
+        executor.submit(work);
+    }
+    work();
+    std::unique_lock lock(state->mutex);
+    state->done.wait(lock, [&state, chunks] { return state->finished == chunks; });
+}
+
+} // namespace calc
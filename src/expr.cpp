@@ -0,0 +1,290 @@
+#include "expr.h"
+
+#include "number.h"
+
+#include <cmath>
+#include <iostream>
+#include <optional>
+#include <string>
+
+namespace calc {
+
+namespace {
+
+using Code = Program::Code;
+
+struct Infix
+{
+    Code code;
+    int left_power;
+    int right_power;
+};
+
+// unary '-' binds tighter than '*' but not '^': -x^2 is -(x^2)
+constexpr int unary_power = 5;
+
+// brackets, unary minuses and '^' chains recurse, this keeps the stack small
+constexpr std::size_t max_nesting = 256;
+
+std::optional<Infix> infix(const char c)
+{
+    switch (c) {
+    case '+': return Infix{Code::ADD, 1, 2};
+    case '-': return Infix{Code::SUB, 1, 2};
+    case '*': return Infix{Code::MUL, 3, 4};
+    case '/': return Infix{Code::DIV, 3, 4};
+    case '%': return Infix{Code::REM, 3, 4};
+    case '^': return Infix{Code::POW, 7, 6}; // right associative
+    default: return std::nullopt;
+    }
+}
+
+class Parser
+{
+public:
+    Parser(const std::string_view text, const Variables & variables, std::vector<Code> & code, std::vector<double> & constants, std::vector<std::size_t> & slots)
+        : m_text(text)
+        , m_variables(variables)
+        , m_code(code)
+        , m_constants(constants)
+        , m_slots(slots)
+    {
+    }
+
+    // returns the deepest stack of the emitted code, 0 on error
+    std::size_t parse()
+    {
+        expression(0);
+        skip_ws();
+        if (m_good && m_i != m_text.size()) {
+            fail();
+        }
+        return m_good ? m_max_depth : 0;
+    }
+
+private:
+    void expression(const int min_power)
+    {
+        if (m_nesting == max_nesting) {
+            if (m_good) {
+                std::cerr << "Expression is nested deeper than " << max_nesting << " at " << m_i << std::endl;
+            }
+            m_good = false;
+            return;
+        }
+        ++m_nesting;
+        operators(min_power);
+        --m_nesting;
+    }
+
+    // Pratt parser: an operator is taken while it binds tighter than min_power
+    void operators(const int min_power)
+    {
+        prefix();
+        for (;;) {
+            skip_ws();
+            if (!m_good || m_i == m_text.size()) {
+                return;
+            }
+            const auto op = infix(m_text[m_i]);
+            if (!op || op->left_power < min_power) {
+                return;
+            }
+            ++m_i;
+            expression(op->right_power);
+            emit(op->code, -1);
+        }
+    }
+
+    void prefix()
+    {
+        skip_ws();
+        if (m_i == m_text.size()) {
+            fail();
+            return;
+        }
+        const char c = m_text[m_i];
+        if (c == '(') {
+            ++m_i;
+            expression(0);
+            expect(')');
+        }
+        else if (c == '-') {
+            ++m_i;
+            expression(unary_power);
+            emit(Code::NEG, 0);
+        }
+        else if (c == 'x') {
+            ++m_i;
+            emit(Code::X, 1);
+        }
+        else if (c == '$') {
+            variable();
+        }
+        else if (m_text.substr(m_i, 4) == "sqrt") {
+            m_i += 4;
+            skip_ws();
+            expect('(');
+            expression(0);
+            expect(')');
+            emit(Code::SQRT, 0);
+        }
+        else if ((c >= '0' && c <= '9') || c == '.') {
+            double value = 0;
+            if (!parse_decimal(m_text, m_i, value)) {
+                fail();
+                return;
+            }
+            m_constants.push_back(value);
+            emit(Code::CONST, 1);
+        }
+        else {
+            fail();
+        }
+    }
+
+    void variable()
+    {
+        const auto name = parse_variable_name(m_text, m_i);
+        if (name.empty()) {
+            fail();
+            return;
+        }
+        const auto slot = m_variables.find(name);
+        if (!slot) {
+            std::cerr << "Unknown variable $" << name << std::endl;
+            m_good = false;
+            return;
+        }
+        m_slots.push_back(*slot);
+        emit(Code::LOAD, 1);
+    }
+
+    void expect(const char c)
+    {
+        skip_ws();
+        if (m_good && m_i < m_text.size() && m_text[m_i] == c) {
+            ++m_i;
+        }
+        else {
+            fail();
+        }
+    }
+
+    void emit(const Code code, const int depth_change)
+    {
+        if (!m_good) {
+            return;
+        }
+        m_code.push_back(code);
+        m_depth += depth_change;
+        m_max_depth = std::max(m_max_depth, static_cast<std::size_t>(m_depth));
+    }
+
+    void skip_ws()
+    {
+        while (m_i < m_text.size() && (m_text[m_i] == ' ' || m_text[m_i] == '\t')) {
+            ++m_i;
+        }
+    }
+
+    void fail()
+    {
+        if (m_good) {
+            std::cerr << "Expression parsing error at " << m_i << ": '" << m_text.substr(m_i) << "'" << std::endl;
+        }
+        m_good = false;
+    }
+
+    const std::string_view m_text;
+    const Variables & m_variables;
+    std::vector<Code> & m_code;
+    std::vector<double> & m_constants;
+    std::vector<std::size_t> & m_slots;
+    std::size_t m_i = 0;
+    std::size_t m_nesting = 0;
+    int m_depth = 0;
+    std::size_t m_max_depth = 0;
+    bool m_good = true;
+};
+
+bool check_divisor(const char * name, const double right)
+{
+    if (right != 0) {
+        return true;
+    }
+    std::cerr << "Bad right argument for " << name << ": " << right << std::endl;
+    return false;
+}
+
+} // anonymous namespace
+
+bool Program::compile(const std::string_view text, const Variables & variables)
+{
+    m_code.clear();
+    m_constants.clear();
+    m_slots.clear();
+    const auto depth = Parser(text, variables, m_code, m_constants, m_slots).parse();
+    m_stack.assign(depth, 0);
+    return depth != 0;
+}
+
+bool Program::run(const double x, double & res, const std::vector<double> & values) const
+{
+    if (m_stack.empty()) {
+        return false;
+    }
+    // top points past the topmost value
+    double * top = m_stack.data();
+    const double * constant = m_constants.data();
+    const std::size_t * slot = m_slots.data();
+    for (const auto code : m_code) {
+        switch (code) {
+        case Code::CONST: *top++ = *constant++; break;
+        case Code::X: *top++ = x; break;
+        case Code::LOAD: *top++ = values[*slot++]; break;
+        case Code::ADD:
+            --top;
+            top[-1] += *top;
+            break;
+        case Code::SUB:
+            --top;
+            top[-1] -= *top;
+            break;
+        case Code::MUL:
+            --top;
+            top[-1] *= *top;
+            break;
+        case Code::DIV:
+            --top;
+            if (!check_divisor("division", *top)) {
+                return false;
+            }
+            top[-1] /= *top;
+            break;
+        case Code::REM:
+            --top;
+            if (!check_divisor("remainder", *top)) {
+                return false;
+            }
+            top[-1] = std::fmod(top[-1], *top);
+            break;
+        case Code::POW:
+            --top;
+            top[-1] = std::pow(top[-1], *top);
+            break;
+        case Code::NEG: top[-1] = -top[-1]; break;
+        case Code::SQRT:
+            if (!(top[-1] > 0)) {
+                std::cerr << "Bad argument for SQRT: " << top[-1] << std::endl;
+                return false;
+            }
+            top[-1] = std::sqrt(top[-1]);
+            break;
+        }
+    }
+    res = top[-1];
+    return true;
+}
+
+} // namespace calc
@@ -0,0 +1,151 @@
+#include "fixed.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace calc {
+
+namespace {
+
+// anything above can overflow a product with an operand
+constexpr double max_fixed_value = 1e27;
+
+Fixed power_of_ten(int n)
+{
+    Fixed res = 1;
+    while (n-- > 0) {
+        res *= 10;
+    }
+    return res;
+}
+
+Fixed abs(const Fixed value)
+{
+    return value < 0 ? -value : value;
+}
+
+Fixed divide_rounded(const Fixed value, const Fixed divisor)
+{
+    Fixed quotient = value / divisor;
+    const Fixed twice_remainder = abs(value % divisor) * 2;
+    if (twice_remainder > divisor || (twice_remainder == divisor && quotient % 2 != 0)) {
+        quotient += value < 0 ? -1 : 1;
+    }
+    return quotient;
+}
+
+std::string to_string(Fixed value)
+{
+    std::string res;
+    do {
+        res.insert(res.begin(), static_cast<char>('0' + static_cast<int>(value % 10)));
+        value /= 10;
+    } while (value != 0);
+    return res;
+}
+
+bool add(const Op op, Fixed & acc, const std::vector<std::int64_t> & integers, const std::vector<std::int64_t> & fractions)
+{
+    // plain int64 sums over blocks which can't overflow, the compiler vectorizes them
+    constexpr std::size_t block = 1 << 26;
+    Fixed total = 0;
+    for (std::size_t begin = 0; begin < integers.size(); begin += block) {
+        const std::size_t end = std::min(integers.size(), begin + block);
+        std::int64_t integer_sum = 0;
+        std::int64_t fraction_sum = 0;
+        for (std::size_t k = begin; k < end; ++k) {
+            integer_sum += integers[k];
+            fraction_sum += fractions[k];
+        }
+        total += Fixed{integer_sum} * fixed_scale + fraction_sum;
+    }
+    return op == Op::ADD ? !__builtin_add_overflow(acc, total, &acc) : !__builtin_sub_overflow(acc, total, &acc);
+}
+
+bool multiply(Fixed & acc, const std::vector<std::int64_t> & integers, const std::vector<std::int64_t> & fractions)
+{
+    for (std::size_t k = 0; k < integers.size(); ++k) {
+        // acc * (i + f / scale) = acc * i + acc * f / scale, only the last term needs rounding
+        Fixed whole;
+        Fixed part;
+        if (__builtin_mul_overflow(acc, Fixed{integers[k]}, &whole) ||
+            __builtin_mul_overflow(acc, Fixed{fractions[k]}, &part) ||
+            __builtin_add_overflow(whole, divide_rounded(part, fixed_scale), &acc)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+bool to_fixed(const double value, Fixed & res)
+{
+    if (!std::isfinite(value) || std::fabs(value) >= max_fixed_value) {
+        return false;
+    }
+    // the shortest representation which reads back as the same double
+    char buffer[32];
+    for (int precision = 0; precision < 17; ++precision) {
+        std::snprintf(buffer, sizeof(buffer), "%.*e", precision, value);
+        if (std::strtod(buffer, nullptr) == value) {
+            break;
+        }
+    }
+    Fixed digits = 0;
+    int fraction_digits = 0;
+    bool fraction = false;
+    const char * p = buffer + (buffer[0] == '-' ? 1 : 0);
+    for (; *p != 'e'; ++p) {
+        if (*p == '.') {
+            fraction = true;
+            continue;
+        }
+        digits = digits * 10 + (*p - '0');
+        fraction_digits += fraction ? 1 : 0;
+    }
+    const int shift = 10 - fraction_digits + std::atoi(p + 1);
+    if (shift >= 0) {
+        res = digits * power_of_ten(shift);
+    }
+    else {
+        // digits below 10^-10 would be lost
+        if (-shift > 30 || digits % power_of_ten(-shift) != 0) {
+            return false;
+        }
+        res = digits / power_of_ten(-shift);
+    }
+    if (buffer[0] == '-') {
+        res = -res;
+    }
+    return true;
+}
+
+double to_double(const Fixed value)
+{
+    std::string fraction = to_string(abs(value) % fixed_scale);
+    fraction.insert(0, 10 - fraction.size(), '0');
+    std::string text = value < 0 ? "-" : "";
+    text += to_string(abs(value) / fixed_scale);
+    text += '.';
+    text += fraction;
+    return std::strtod(text.c_str(), nullptr);
+}
+
+bool fixed_fold(const Op op, Fixed & acc, const std::vector<std::int64_t> & integers, const std::vector<std::int64_t> & fractions)
+{
+    switch (op) {
+    case Op::ADD:
+    case Op::SUB:
+        return add(op, acc, integers, fractions);
+    case Op::MUL:
+        return multiply(acc, integers, fractions);
+    default:
+        return false;
+    }
+}
+
+} // namespace calc
@@ -0,0 +1,124 @@
+#include "huge_pages.h"
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace calc {
+
+namespace {
+
+std::atomic<HugePages> policy{HugePages::Off};
+
+std::size_t round_up(const std::size_t size, const std::size_t page)
+{
+    return (size + page - 1) / page * page;
+}
+
+} // anonymous namespace
+
+void set_huge_pages(const HugePages value)
+{
+    policy.store(value, std::memory_order_relaxed);
+}
+
+HugePages huge_pages()
+{
+    return policy.load(std::memory_order_relaxed);
+}
+
+void advise_huge_pages(void * data, const std::size_t size)
+{
+#ifdef MADV_HUGEPAGE
+    // less than two huge pages may have none aligned inside
+    if (huge_pages() == HugePages::Off || size < 2 * huge_page_size) {
+        return;
+    }
+    const auto begin = round_up(reinterpret_cast<std::uintptr_t>(data), huge_page_size);
+    const auto end = (reinterpret_cast<std::uintptr_t>(data) + size) / huge_page_size * huge_page_size;
+    if (begin < end) {
+        madvise(reinterpret_cast<void *>(begin), end - begin, MADV_HUGEPAGE);
+    }
+#else
+    static_cast<void>(data);
+    static_cast<void>(size);
+#endif
+}
+
+PageBuffer::PageBuffer(const std::size_t size)
+{
+    if (size == 0) {
+        return;
+    }
+    const auto mode = huge_pages();
+#ifdef MAP_HUGETLB
+    if (mode == HugePages::Explicit) {
+        const auto rounded = round_up(size, huge_page_size);
+        void * data = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data != MAP_FAILED) {
+            m_data = static_cast<char *>(data);
+            m_size = rounded;
+            m_explicit = true;
+            return;
+        }
+        // the pool is empty or there is none, fall back to transparent pages
+    }
+#endif
+    const auto page = mode == HugePages::Off ? static_cast<std::size_t>(sysconf(_SC_PAGESIZE)) : huge_page_size;
+    const auto rounded = round_up(size, page);
+    // one huge page more to align the buffer on one, the extra is unmapped
+    const auto mapped = mode == HugePages::Off ? rounded : rounded + huge_page_size;
+    void * data = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+        return;
+    }
+    auto * begin = static_cast<char *>(data);
+    if (mode != HugePages::Off) {
+        const auto address = reinterpret_cast<std::uintptr_t>(begin);
+        const auto head = round_up(address, huge_page_size) - address;
+        if (head != 0) {
+            munmap(begin, head);
+        }
+        if (huge_page_size - head != 0) {
+            munmap(begin + head + rounded, huge_page_size - head);
+        }
+        begin += head;
+#ifdef MADV_HUGEPAGE
+        madvise(begin, rounded, MADV_HUGEPAGE);
+#endif
+    }
+    m_data = begin;
+    m_size = rounded;
+}
+
+PageBuffer::~PageBuffer()
+{
+    if (m_data != nullptr) {
+        munmap(m_data, m_size);
+    }
+}
+
+PageBuffer::PageBuffer(PageBuffer && other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr))
+    , m_size(std::exchange(other.m_size, 0))
+    , m_explicit(std::exchange(other.m_explicit, false))
+{
+}
+
+PageBuffer & PageBuffer::operator=(PageBuffer && other) noexcept
+{
+    if (this != &other) {
+        if (m_data != nullptr) {
+            munmap(m_data, m_size);
+        }
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+        m_explicit = std::exchange(other.m_explicit, false);
+    }
+    return *this;
+}
+
+} // namespace calc
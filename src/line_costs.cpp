@@ -0,0 +1,180 @@
+#include "line_costs.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iomanip>
+
+namespace calc {
+
+namespace {
+
+const char * const labels[] = {"set", "+", "-", "*", "/", "%", "^", "_", "SQRT", "(+)", "(-)", "(*)", "(/)", "(%)", "(^)", "=", ">", "block", "empty", "error"};
+constexpr std::size_t set_label = 0;
+constexpr std::size_t sqrt_label = 8;
+constexpr std::size_t fold_labels = 9;
+constexpr std::size_t expression_label = 15;
+constexpr std::size_t variable_label = 16;
+constexpr std::size_t block_label = 17;
+constexpr std::size_t empty_label = 18;
+constexpr std::size_t error_label = 19;
+
+const std::string_view op_chars = "+-*/%^_";
+
+// what kind of line it is, judging by its first chars only
+std::size_t classify(const std::string & line, const bool in_block)
+{
+    if (in_block) {
+        return block_label;
+    }
+    if (line.empty()) {
+        return empty_label;
+    }
+    const char c = line[0];
+    if (std::isdigit(static_cast<unsigned char>(c)) || c == '$') {
+        return set_label;
+    }
+    if (const auto k = op_chars.find(c); k != std::string_view::npos) {
+        return 1 + k;
+    }
+    switch (c) {
+    case '=': return expression_label;
+    case '>': return variable_label;
+    case 'S': return line.compare(0, 4, "SQRT") == 0 ? sqrt_label : error_label;
+    case '(':
+        if (line.size() > 2 && line[2] == ')' && line[1] != '_') {
+            if (const auto k = op_chars.find(line[1]); k != std::string_view::npos) {
+                return fold_labels + k;
+            }
+        }
+        return error_label;
+    default: return error_label;
+    }
+}
+
+std::size_t count_tokens(const std::string & line, std::size_t i)
+{
+    std::size_t count = 0;
+    while (i < line.size()) {
+        while (i < line.size() && std::isspace(static_cast<unsigned char>(line[i]))) {
+            ++i;
+        }
+        const auto begin = i;
+        while (i < line.size() && !std::isspace(static_cast<unsigned char>(line[i]))) {
+            ++i;
+        }
+        if (i != begin && line.compare(begin, i - begin, "}") != 0) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+std::size_t count_operands(const std::string & line, const std::size_t label)
+{
+    switch (label) {
+    case set_label:
+    case block_label: return count_tokens(line, 0);
+    case expression_label:
+    case variable_label:
+    case empty_label:
+    case error_label: return 0;
+    default:
+        if (label >= fold_labels) {
+            return count_tokens(line, 3);
+        }
+        return count_tokens(line, label == sqrt_label ? 4 : 1);
+    }
+}
+
+bool cheaper(const LineCost & a, const LineCost & b)
+{
+    return a.ticks > b.ticks;
+}
+
+} // anonymous namespace
+
+LineCosts::LineCosts(const std::size_t top)
+    : m_top(top)
+    , m_totals(std::size(labels))
+    , m_start_ticks(ticks())
+    , m_start(std::chrono::steady_clock::now())
+{
+    m_heap.reserve(top);
+}
+
+void LineCosts::add(const std::size_t number, const std::string & line, const bool in_block, const std::uint64_t ticks)
+{
+    const auto label = classify(line, in_block);
+    ++m_lines;
+    m_ticks += ticks;
+    ++m_totals[label].lines;
+    m_totals[label].ticks += ticks;
+    if (m_top == 0 || (m_heap.size() == m_top && ticks <= m_heap.front().ticks)) {
+        return;
+    }
+    LineCost cost;
+    cost.number = number;
+    cost.op = labels[label];
+    cost.operands = count_operands(line, label);
+    cost.bytes = line.size();
+    cost.ticks = ticks;
+    cost.text = line.substr(0, text_size);
+    if (m_heap.size() == m_top) {
+        std::pop_heap(m_heap.begin(), m_heap.end(), cheaper);
+        m_heap.back() = std::move(cost);
+    }
+    else {
+        m_heap.push_back(std::move(cost));
+    }
+    std::push_heap(m_heap.begin(), m_heap.end(), cheaper);
+}
+
+std::vector<LineCost> LineCosts::top() const
+{
+    auto res = m_heap;
+    std::sort(res.begin(), res.end(), [](const LineCost & a, const LineCost & b) { return a.ticks != b.ticks ? a.ticks > b.ticks : a.number < b.number; });
+    return res;
+}
+
+double LineCosts::ns_per_tick() const
+{
+    const auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - m_start).count();
+    const auto counted = ticks() - m_start_ticks;
+    return counted == 0 ? 0 : elapsed / static_cast<double>(counted);
+}
+
+void LineCosts::report(std::ostream & out) const
+{
+    const double scale = ns_per_tick();
+    const auto ns = [scale](const std::uint64_t ticks) { return static_cast<double>(ticks) * scale; };
+    const auto flags = out.flags();
+    out << std::fixed << std::setprecision(0);
+    out << "Line costs: " << m_lines << " lines, " << ns(m_ticks) / 1e6 << " ms of evaluation\n";
+    out << "top " << m_heap.size() << " lines:\n";
+    out << std::setw(10) << "line" << "  " << std::setw(6) << std::left << "op" << std::right << std::setw(10) << "operands" << std::setw(10) << "bytes"
+        << std::setw(12) << "ns"
+        << "  text\n";
+    for (const auto & cost : top()) {
+        out << std::setw(10) << cost.number << "  " << std::setw(6) << std::left << cost.op << std::right << std::setw(10) << cost.operands << std::setw(10)
+            << cost.bytes << std::setw(12) << ns(cost.ticks) << "  " << cost.text << (cost.bytes > text_size ? "..." : "") << "\n";
+    }
+    std::vector<std::size_t> order;
+    for (std::size_t label = 0; label < m_totals.size(); ++label) {
+        if (m_totals[label].lines != 0) {
+            order.push_back(label);
+        }
+    }
+    std::sort(order.begin(), order.end(), [this](const std::size_t a, const std::size_t b) { return m_totals[a].ticks > m_totals[b].ticks; });
+    out << "by operation:\n";
+    out << "  " << std::setw(6) << std::left << "op" << std::right << std::setw(12) << "lines" << std::setw(12) << "ms" << std::setw(8) << "share"
+        << std::setw(11) << "ns/line" << "\n";
+    for (const auto label : order) {
+        const auto & total = m_totals[label];
+        out << "  " << std::setw(6) << std::left << labels[label] << std::right << std::setw(12) << total.lines << std::setw(12) << std::setprecision(1)
+            << ns(total.ticks) / 1e6 << std::setw(7) << 100.0 * static_cast<double>(total.ticks) / static_cast<double>(std::max<std::uint64_t>(m_ticks, 1))
+            << "%" << std::setw(11) << std::setprecision(0) << ns(total.ticks) / static_cast<double>(total.lines) << "\n";
+    }
+    out.flags(flags);
+}
+
+} // namespace calc
@@ -0,0 +1,120 @@
+#include "line_reader.h"
+
+#include "huge_pages.h"
+#include "profiler.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <poll.h>
+#include <unistd.h>
+
+namespace calc {
+
+LineReader::LineReader(const int fd)
+    : m_fd(fd)
+    , m_buffer(huge_pages() == HugePages::Off ? 64 * 1024 : huge_page_size)
+{
+    unsigned char magic[4];
+    std::size_t got = 0;
+    while (got < sizeof(magic)) {
+        const auto n = read(reinterpret_cast<char *>(magic) + got, sizeof(magic) - got);
+        if (n == 0) {
+            break;
+        }
+        got += n;
+    }
+    m_head.assign(reinterpret_cast<const char *>(magic), got);
+    const std::uint32_t value = got == sizeof(magic) ? magic[0] | (magic[1] << 8) | (magic[2] << 16) | (std::uint32_t{magic[3]} << 24) : 0;
+    if (value == lz4_frame_magic) {
+        m_lz4 = std::make_unique<Lz4FrameReader>([this](char * data, const std::size_t size) { return read(data, size); });
+    }
+}
+
+std::size_t LineReader::read(char * data, const std::size_t size)
+{
+    if (!m_head.empty()) {
+        const auto n = std::min(size, m_head.size());
+        std::memcpy(data, m_head.data(), n);
+        m_head.erase(0, n);
+        return n;
+    }
+    for (;;) {
+        const auto n = ::read(m_fd, data, size);
+        if (n >= 0) {
+            return static_cast<std::size_t>(n);
+        }
+        if (errno != EINTR) {
+            m_error = std::strerror(errno);
+            return 0;
+        }
+    }
+}
+
+std::string_view LineReader::next_chunk()
+{
+    if (m_lz4) {
+        return m_lz4->next();
+    }
+    if (m_buffer.empty()) {
+        m_error = "Can't allocate the input buffer";
+        return {};
+    }
+    const auto n = read(m_buffer.data(), m_buffer.size());
+    return {m_buffer.data(), n};
+}
+
+bool LineReader::getline(std::string & line)
+{
+    const PhaseScope scope(Phase::Read);
+    line.clear();
+    for (;;) {
+        if (m_chunk.empty()) {
+            if (m_end) {
+                return !line.empty();
+            }
+            m_chunk = next_chunk();
+            if (m_chunk.empty()) {
+                m_end = true;
+                return !line.empty();
+            }
+            if (m_capture != nullptr) {
+                m_capture->add(m_chunk);
+            }
+        }
+        const auto newline = m_chunk.find('\n');
+        if (newline != std::string_view::npos) {
+            line.append(m_chunk.data(), newline);
+            m_chunk.remove_prefix(newline + 1);
+            return true;
+        }
+        // a line longer than the buffer, may grow to a fold of millions of operands
+        reserve_huge(line, line.size() + m_chunk.size());
+        line.append(m_chunk.data(), m_chunk.size());
+        m_chunk = {};
+    }
+}
+
+bool LineReader::would_block() const
+{
+    if (!m_chunk.empty() || !m_head.empty() || m_end) {
+        return false;
+    }
+    pollfd input{m_fd, POLLIN, 0};
+    while (poll(&input, 1, 0) < 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+    return input.revents == 0;
+}
+
+std::string LineReader::error() const
+{
+    if (!m_error.empty()) {
+        return m_error;
+    }
+    return m_lz4 ? m_lz4->error() : std::string();
+}
+
+} // namespace calc
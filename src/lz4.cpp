@@ -0,0 +1,444 @@
+#include "lz4.h"
+
+#include "huge_pages.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace calc {
+
+namespace {
+
+constexpr std::uint32_t prime1 = 2654435761U;
+constexpr std::uint32_t prime2 = 2246822519U;
+constexpr std::uint32_t prime3 = 3266489917U;
+constexpr std::uint32_t prime4 = 668265263U;
+constexpr std::uint32_t prime5 = 374761393U;
+
+constexpr std::size_t window_size = 64 * 1024;
+
+std::uint32_t rotl(const std::uint32_t x, const int r)
+{
+    return (x << r) | (x >> (32 - r));
+}
+
+std::uint32_t read_le32(const unsigned char * p)
+{
+    return std::uint32_t{p[0]} | (std::uint32_t{p[1]} << 8) | (std::uint32_t{p[2]} << 16) | (std::uint32_t{p[3]} << 24);
+}
+
+void write_le32(std::string & out, const std::uint32_t value)
+{
+    for (int shift = 0; shift < 32; shift += 8) {
+        out += static_cast<char>((value >> shift) & 0xFF);
+    }
+}
+
+std::uint32_t xxh_round(const std::uint32_t acc, const std::uint32_t input)
+{
+    return rotl(acc + input * prime2, 13) * prime1;
+}
+
+// 255-byte continuation of a literal or match length
+bool read_length(const unsigned char *& ip, const unsigned char * const end, std::size_t & length)
+{
+    unsigned char byte;
+    do {
+        if (ip == end) {
+            return false;
+        }
+        byte = *ip++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+// Decompresses a block of LZ4 sequences to window[pos, limit), matches may
+// reach back before pos into what the window already has.
+bool decode_block(const unsigned char * ip, const std::size_t size, char * window, std::size_t & pos, const std::size_t limit)
+{
+    const unsigned char * const end = ip + size;
+    std::size_t op = pos;
+    for (;;) {
+        if (ip == end) {
+            return false;
+        }
+        const unsigned token = *ip++;
+        std::size_t literals = token >> 4;
+        if (literals == 15 && !read_length(ip, end, literals)) {
+            return false;
+        }
+        if (literals > static_cast<std::size_t>(end - ip) || literals > limit - op) {
+            return false;
+        }
+        std::memcpy(window + op, ip, literals);
+        ip += literals;
+        op += literals;
+        // the last sequence has no match
+        if (ip == end) {
+            break;
+        }
+        if (end - ip < 2) {
+            return false;
+        }
+        const std::size_t offset = ip[0] | (std::size_t{ip[1]} << 8);
+        ip += 2;
+        std::size_t length = token & 15;
+        if (length == 15 && !read_length(ip, end, length)) {
+            return false;
+        }
+        length += 4;
+        if (offset == 0 || offset > op || length > limit - op) {
+            return false;
+        }
+        const char * match = window + op - offset;
+        if (offset >= length) {
+            std::memcpy(window + op, match, length);
+        }
+        else {
+            // overlapping match repeats the last offset bytes
+            for (std::size_t k = 0; k < length; ++k) {
+                window[op + k] = match[k];
+            }
+        }
+        op += length;
+    }
+    pos = op;
+    return true;
+}
+
+void write_length(std::string & out, std::size_t length)
+{
+    for (; length >= 255; length -= 255) {
+        out += static_cast<char>(255);
+    }
+    out += static_cast<char>(length);
+}
+
+void write_sequence(std::string & out, const char * literals, const std::size_t literal_length, const std::size_t offset, const std::size_t match_length)
+{
+    const std::size_t match_code = match_length == 0 ? 0 : match_length - 4;
+    out += static_cast<char>((std::min<std::size_t>(literal_length, 15) << 4) | std::min<std::size_t>(match_code, 15));
+    if (literal_length >= 15) {
+        write_length(out, literal_length - 15);
+    }
+    out.append(literals, literal_length);
+    if (match_length == 0) {
+        return;
+    }
+    out += static_cast<char>(offset & 0xFF);
+    out += static_cast<char>(offset >> 8);
+    if (match_code >= 15) {
+        write_length(out, match_code - 15);
+    }
+}
+
+std::string compress_block(const std::string_view block)
+{
+    // the format wants the last 5 bytes as literals and no match starting
+    // in the last 12
+    constexpr std::size_t last_literals = 5;
+    constexpr std::size_t match_limit = 12;
+    const auto * src = reinterpret_cast<const unsigned char *>(block.data());
+    const std::size_t n = block.size();
+    std::vector<std::int32_t> table(1 << 12, -1);
+    std::string out;
+    std::size_t anchor = 0;
+    for (std::size_t i = 0; n >= match_limit && i <= n - match_limit;) {
+        const auto sequence = read_le32(src + i);
+        auto & slot = table[(sequence * prime1) >> 20];
+        const auto candidate = slot;
+        slot = static_cast<std::int32_t>(i);
+        if (candidate < 0 || i - static_cast<std::size_t>(candidate) > 0xFFFF || read_le32(src + candidate) != sequence) {
+            ++i;
+            continue;
+        }
+        std::size_t length = 4;
+        while (i + length < n - last_literals && src[candidate + length] == src[i + length]) {
+            ++length;
+        }
+        write_sequence(out, block.data() + anchor, i - anchor, i - static_cast<std::size_t>(candidate), length);
+        i += length;
+        anchor = i;
+    }
+    write_sequence(out, block.data() + anchor, n - anchor, 0, 0);
+    return out;
+}
+
+} // anonymous namespace
+
+Xxh32::Xxh32(const std::uint32_t seed)
+    : m_acc{seed + prime1 + prime2, seed + prime2, seed, seed - prime1}
+    , m_seed(seed)
+{
+}
+
+void Xxh32::update(const void * data, std::size_t size)
+{
+    const auto * p = static_cast<const unsigned char *>(data);
+    m_total += size;
+    if (m_buffered + size < 16) {
+        std::memcpy(m_buffer + m_buffered, p, size);
+        m_buffered += size;
+        return;
+    }
+    if (m_buffered != 0) {
+        const std::size_t fill = 16 - m_buffered;
+        std::memcpy(m_buffer + m_buffered, p, fill);
+        for (int lane = 0; lane < 4; ++lane) {
+            m_acc[lane] = xxh_round(m_acc[lane], read_le32(m_buffer + 4 * lane));
+        }
+        p += fill;
+        size -= fill;
+        m_buffered = 0;
+    }
+    for (; size >= 16; p += 16, size -= 16) {
+        for (int lane = 0; lane < 4; ++lane) {
+            m_acc[lane] = xxh_round(m_acc[lane], read_le32(p + 4 * lane));
+        }
+    }
+    std::memcpy(m_buffer, p, size);
+    m_buffered = size;
+}
+
+std::uint32_t Xxh32::digest() const
+{
+    std::uint32_t h = m_total >= 16 ? rotl(m_acc[0], 1) + rotl(m_acc[1], 7) + rotl(m_acc[2], 12) + rotl(m_acc[3], 18) : m_seed + prime5;
+    h += static_cast<std::uint32_t>(m_total);
+    std::size_t i = 0;
+    for (; i + 4 <= m_buffered; i += 4) {
+        h = rotl(h + read_le32(m_buffer + i) * prime3, 17) * prime4;
+    }
+    for (; i < m_buffered; ++i) {
+        h = rotl(h + m_buffer[i] * prime5, 11) * prime1;
+    }
+    h ^= h >> 15;
+    h *= prime2;
+    h ^= h >> 13;
+    h *= prime3;
+    h ^= h >> 16;
+    return h;
+}
+
+std::uint32_t xxh32(const void * data, const std::size_t size, const std::uint32_t seed)
+{
+    Xxh32 hash(seed);
+    hash.update(data, size);
+    return hash.digest();
+}
+
+Lz4FrameReader::Lz4FrameReader(Read read)
+    : m_read(std::move(read))
+{
+}
+
+bool Lz4FrameReader::read_exact(void * data, const std::size_t size)
+{
+    auto * p = static_cast<char *>(data);
+    for (std::size_t done = 0; done < size;) {
+        const auto n = m_read(p + done, size - done);
+        if (n == 0) {
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+bool Lz4FrameReader::read_u32(std::uint32_t & value)
+{
+    unsigned char bytes[4];
+    if (!read_exact(bytes, sizeof(bytes))) {
+        return false;
+    }
+    value = read_le32(bytes);
+    return true;
+}
+
+bool Lz4FrameReader::fail(const char * reason)
+{
+    if (m_error.empty()) {
+        m_error = reason;
+    }
+    return false;
+}
+
+bool Lz4FrameReader::start_frame()
+{
+    for (;;) {
+        unsigned char bytes[4];
+        std::size_t got = 0;
+        while (got < sizeof(bytes)) {
+            const auto n = m_read(reinterpret_cast<char *>(bytes) + got, sizeof(bytes) - got);
+            if (n == 0) {
+                break;
+            }
+            got += n;
+        }
+        if (got == 0 && m_any_frame) {
+            return false;
+        }
+        if (got < sizeof(bytes)) {
+            return fail("truncated frame header");
+        }
+        const auto magic = read_le32(bytes);
+        if ((magic & 0xFFFFFFF0) == 0x184D2A50) {
+            std::uint32_t size;
+            if (!read_u32(size)) {
+                return fail("truncated skippable frame");
+            }
+            m_block.resize(std::min<std::size_t>(size, window_size));
+            for (std::size_t left = size; left > 0;) {
+                const auto part = std::min(left, m_block.size());
+                if (!read_exact(m_block.data(), part)) {
+                    return fail("truncated skippable frame");
+                }
+                left -= part;
+            }
+            m_any_frame = true;
+            continue;
+        }
+        if (magic != lz4_frame_magic) {
+            return fail("unknown frame magic number");
+        }
+        // FLG, BD, optional content size and dictionary id, header checksum
+        unsigned char descriptor[2 + 8 + 4];
+        if (!read_exact(descriptor, 2)) {
+            return fail("truncated frame header");
+        }
+        const unsigned flags = descriptor[0];
+        const unsigned block_descriptor = descriptor[1];
+        if ((flags >> 6) != 1 || (flags & 0x02) != 0 || (block_descriptor & 0x8F) != 0 || (block_descriptor >> 4) < 4) {
+            return fail("unsupported frame descriptor");
+        }
+        if ((flags & 0x01) != 0) {
+            return fail("dictionaries are not supported");
+        }
+        std::size_t length = 2;
+        if ((flags & 0x08) != 0) {
+            if (!read_exact(descriptor + length, 8)) {
+                return fail("truncated frame header");
+            }
+            length += 8;
+        }
+        unsigned char checksum;
+        if (!read_exact(&checksum, 1)) {
+            return fail("truncated frame header");
+        }
+        if (((xxh32(descriptor, length) >> 8) & 0xFF) != checksum) {
+            return fail("frame header checksum mismatch");
+        }
+        m_independent = (flags & 0x20) != 0;
+        m_block_checksum = (flags & 0x10) != 0;
+        m_content_checksum = (flags & 0x04) != 0;
+        m_block_max = std::size_t{1} << (2 * (block_descriptor >> 4) + 8);
+        // the window is the arena of the decompressed lines, the block of the
+        // compressed ones: up to 4 MiB each, worth huge pages if asked for
+        reserve_huge(m_window, (m_independent ? 0 : window_size) + m_block_max);
+        reserve_huge(m_block, m_block_max);
+        m_window.resize((m_independent ? 0 : window_size) + m_block_max);
+        m_pos = 0;
+        m_content_hash = Xxh32();
+        m_in_frame = true;
+        return true;
+    }
+}
+
+bool Lz4FrameReader::end_frame()
+{
+    m_in_frame = false;
+    m_any_frame = true;
+    if (m_content_checksum) {
+        std::uint32_t checksum;
+        if (!read_u32(checksum)) {
+            return fail("truncated content checksum");
+        }
+        if (checksum != m_content_hash.digest()) {
+            return fail("content checksum mismatch");
+        }
+    }
+    return true;
+}
+
+std::string_view Lz4FrameReader::next()
+{
+    while (m_error.empty()) {
+        if (!m_in_frame && !start_frame()) {
+            return {};
+        }
+        std::uint32_t header;
+        if (!read_u32(header)) {
+            fail("truncated block");
+            return {};
+        }
+        if (header == 0) {
+            end_frame();
+            continue;
+        }
+        const bool compressed = (header & 0x80000000) == 0;
+        const std::size_t size = header & 0x7FFFFFFF;
+        if (size > m_block_max) {
+            fail("block larger than its frame allows");
+            return {};
+        }
+        m_block.resize(size);
+        if (!read_exact(m_block.data(), size)) {
+            fail("truncated block");
+            return {};
+        }
+        std::uint32_t checksum;
+        if (m_block_checksum && (!read_u32(checksum) || checksum != xxh32(m_block.data(), size))) {
+            fail("block checksum mismatch");
+            return {};
+        }
+        if (m_independent) {
+            m_pos = 0;
+        }
+        else if (m_pos + m_block_max > m_window.size()) {
+            const auto keep = std::min(m_pos, window_size);
+            std::memmove(m_window.data(), m_window.data() + m_pos - keep, keep);
+            m_pos = keep;
+        }
+        const auto start = m_pos;
+        if (!compressed) {
+            std::memcpy(m_window.data() + m_pos, m_block.data(), size);
+            m_pos += size;
+        }
+        else if (!decode_block(reinterpret_cast<const unsigned char *>(m_block.data()), size, m_window.data(), m_pos, m_window.size())) {
+            fail("malformed compressed block");
+            return {};
+        }
+        m_content_hash.update(m_window.data() + start, m_pos - start);
+        if (m_pos != start) {
+            return {m_window.data() + start, m_pos - start};
+        }
+    }
+    return {};
+}
+
+std::string lz4_compress(const std::string_view data)
+{
+    std::string out;
+    write_le32(out, lz4_frame_magic);
+    // version 1, independent blocks, content checksum; 64 KiB blocks
+    const unsigned char descriptor[] = {0x64, 0x40};
+    out.append(reinterpret_cast<const char *>(descriptor), sizeof(descriptor));
+    out += static_cast<char>((xxh32(descriptor, sizeof(descriptor)) >> 8) & 0xFF);
+    for (std::size_t begin = 0; begin < data.size(); begin += window_size) {
+        const auto block = data.substr(begin, window_size);
+        const auto compressed = compress_block(block);
+        if (compressed.size() < block.size()) {
+            write_le32(out, static_cast<std::uint32_t>(compressed.size()));
+            out += compressed;
+        }
+        else {
+            write_le32(out, static_cast<std::uint32_t>(block.size()) | 0x80000000);
+            out += block;
+        }
+    }
+    write_le32(out, 0);
+    write_le32(out, xxh32(data.data(), data.size()));
+    return out;
+}
+
+} // namespace calc
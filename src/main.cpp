@@ -1,13 +1,157 @@
 #include "calc.h"
+#include "capture.h"
+#include "cli.h"
+#include "datagram.h"
+#include "line_costs.h"
+#include "line_reader.h"
+#include "mapped_file.h"
+#include "output.h"
+#include "profiler.h"
+#include "server.h"
+#include "session.h"
 
+#include <csignal>
 #include <iostream>
+#include <optional>
 #include <string>
 
-int main()
+#include <unistd.h>
+
+namespace {
+
+calc::Server * server = nullptr;
+calc::DatagramServer * datagram_server = nullptr;
+
+void stop_server(int)
 {
-    double current = 0;
-    for (std::string line; std::getline(std::cin, line);) {
-        current = process_line(current, line);
-        std::cout << current << std::endl;
+    if (server != nullptr) {
+        server->stop();
+    }
+    if (datagram_server != nullptr) {
+        datagram_server->stop();
+    }
+}
+
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+    calc::Cli cli;
+    if (!calc::parse_cli(argc, argv, cli)) {
+        return 1;
+    }
+    if (cli.help) {
+        calc::print_usage(std::cout, argv[0]);
+        return 0;
+    }
+    if (cli.autotune) {
+        const auto tuning = calc::autotune();
+        const auto path = cli.config_path.empty() ? calc::default_tuning_path() : cli.config_path;
+        if (!calc::save_tuning(path, tuning)) {
+            std::cerr << "Can't write tuning config " << path << std::endl;
+            return 1;
+        }
+        std::cout << "simd_min_operands=" << tuning.simd_min_operands << "\n"
+                  << "parallel_min_operands=" << tuning.parallel_min_operands << "\n"
+                  << "saved to " << path << std::endl;
+        return 0;
+    }
+    calc::set_huge_pages(cli.huge_pages);
+    if (!cli.sample_path.empty()) {
+        calc::MappedFile file;
+        calc::Estimate estimate;
+        if (!file.open(cli.sample_path) || !calc::estimate_sum(file.data(), cli.sample, estimate)) {
+            return 1;
+        }
+        std::cout << estimate.value << " [" << estimate.low << ", " << estimate.high << "]" << std::endl;
+        return 0;
+    }
+    calc::Profiler profiler;
+    if (cli.profile && !profiler.start()) {
+        return 1;
+    }
+    const auto report = [&] {
+        if (cli.profile) {
+            profiler.stop();
+            profiler.report(std::cerr);
+        }
+    };
+    if (!cli.server.socket_path.empty()) {
+        cli.server.options = cli.options;
+        calc::Server daemon(cli.server);
+        if (!daemon.open()) {
+            return 1;
+        }
+        server = &daemon;
+        std::signal(SIGINT, stop_server);
+        std::signal(SIGTERM, stop_server);
+        const bool served = daemon.run();
+        report();
+        return served ? 0 : 1;
+    }
+    if (!cli.datagram.socket_path.empty()) {
+        cli.datagram.options = cli.options;
+        calc::DatagramServer daemon(cli.datagram);
+        if (!daemon.open()) {
+            return 1;
+        }
+        datagram_server = &daemon;
+        std::signal(SIGINT, stop_server);
+        std::signal(SIGTERM, stop_server);
+        const bool served = daemon.run();
+        report();
+        return served ? 0 : 1;
+    }
+    calc::Session session(cli.options);
+    calc::LineReader input(STDIN_FILENO);
+    calc::Capture capture;
+    if (!cli.capture_path.empty()) {
+        if (!capture.open(cli.capture_path)) {
+            return 1;
+        }
+        input.capture(&capture);
+    }
+    calc::Output output(STDOUT_FILENO);
+    std::optional<calc::LineCosts> costs;
+    if (cli.line_costs != 0) {
+        costs.emplace(cli.line_costs);
+    }
+    std::size_t number = 0;
+    for (std::string line; input.getline(line);) {
+        std::optional<double> current;
+        if (costs) {
+            const bool in_block = session.in_block();
+            const auto start = calc::ticks();
+            current = session.feed(line);
+            costs->add(++number, line, in_block, calc::ticks() - start);
+        }
+        else {
+            current = session.feed(line);
+        }
+        if (current) {
+            output.write(*current);
+        }
+        // whoever feeds the input may wait for these results, while more of
+        // it is there the output keeps filling whole buffers to splice
+        if (input.would_block()) {
+            output.flush();
+        }
+    }
+    session.finish();
+    output.flush();
+    report();
+    if (costs) {
+        costs->report(std::cerr);
+    }
+    if (!capture.close()) {
+        return 1;
+    }
+    if (const auto error = input.error(); !error.empty()) {
+        std::cerr << "Can't read the input: " << error << std::endl;
+        return 1;
+    }
+    if (!output.error().empty()) {
+        std::cerr << "Can't write the output: " << output.error() << std::endl;
+        return 1;
     }
 }
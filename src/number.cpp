@@ -0,0 +1,431 @@
+#include "number.h"
+
+#include "fixed.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace calc {
+
+namespace {
+
+// walks over a decimal operand calling on_digit(digit, integer_part) and
+// reports malformed or too long ones
+template <class OnDigit>
+void scan_arg(const std::string_view line, std::size_t & i, bool & good, OnDigit && on_digit)
+{
+    std::size_t count = 0;
+    bool integer = true;
+    while (good && i < line.size() && count < max_decimal_digits) {
+        switch (line[i]) {
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+            on_digit(line[i] - '0', integer);
+            ++i;
+            ++count;
+            break;
+        case '.':
+            integer = false;
+            ++i;
+            break;
+        default:
+            good = false;
+            break;
+        }
+    }
+    if (!good) {
+        std::cerr << "Argument parsing error at " << i << ": '" << line.substr(i) << "'" << std::endl;
+    }
+    else if (i < line.size()) {
+        good = false;
+        std::cerr << "Argument isn't fully parsed, suffix left: '" << line.substr(i) << "'" << std::endl;
+    }
+}
+
+__extension__ using Uint128 = unsigned __int128;
+
+// Eisel-Lemire needs 5^q for q in [smallest_power, largest_power] as 128-bit
+// values with the top bit set: truncated for q >= 0 and rounded up for q < 0,
+// the same table as in the fast_float library, built once on first use.
+constexpr int smallest_power = -342;
+constexpr int largest_power = 308;
+
+// little-endian big integer, just enough to build the table
+using Big = std::vector<std::uint32_t>;
+
+void multiply(Big & x, const std::uint32_t factor)
+{
+    std::uint64_t carry = 0;
+    for (auto & limb : x) {
+        carry += std::uint64_t{limb} * factor;
+        limb = static_cast<std::uint32_t>(carry);
+        carry >>= 32;
+    }
+    if (carry != 0) {
+        x.push_back(static_cast<std::uint32_t>(carry));
+    }
+}
+
+void divide(Big & x, const std::uint32_t divisor)
+{
+    std::uint64_t remainder = 0;
+    for (std::size_t k = x.size(); k-- > 0;) {
+        const std::uint64_t current = (remainder << 32) | x[k];
+        x[k] = static_cast<std::uint32_t>(current / divisor);
+        remainder = current % divisor;
+    }
+    while (!x.empty() && x.back() == 0) {
+        x.pop_back();
+    }
+}
+
+void increment(Big & x)
+{
+    for (auto & limb : x) {
+        if (++limb != 0) {
+            return;
+        }
+    }
+    x.push_back(1);
+}
+
+std::size_t bit_length(const Big & x)
+{
+    return x.empty() ? 0 : 32 * x.size() - static_cast<std::size_t>(__builtin_clz(x.back()));
+}
+
+// the top 128 bits of x, shifted left if it is shorter
+Uint128 top_bits(const Big & x)
+{
+    const std::size_t length = bit_length(x);
+    const std::size_t shift = length > 128 ? length - 128 : 0;
+    Uint128 res = 0;
+    for (std::size_t bit = length; bit-- > shift;) {
+        res = (res << 1) | ((x[bit / 32] >> (bit % 32)) & 1);
+    }
+    return length < 128 ? res << (128 - length) : res;
+}
+
+std::vector<std::uint64_t> build_powers_of_five()
+{
+    std::vector<std::uint64_t> table;
+    const auto push = [&table](const Uint128 value) {
+        table.push_back(static_cast<std::uint64_t>(value >> 64));
+        table.push_back(static_cast<std::uint64_t>(value));
+    };
+    for (int q = smallest_power; q < 0; ++q) {
+        Big power{1};
+        for (int k = 0; k < -q; ++k) {
+            multiply(power, 5);
+        }
+        // floor(2^b / 5^-q) + 1 with enough bits, then truncated
+        const std::size_t z = bit_length(power);
+        const std::size_t b = q >= -27 ? z + 127 : 2 * z + 128;
+        Big value(b / 32 + 1, 0);
+        value.back() = std::uint32_t{1} << (b % 32);
+        for (int k = 0; k < -q; ++k) {
+            divide(value, 5);
+        }
+        increment(value);
+        push(top_bits(value));
+    }
+    Big power{1};
+    for (int q = 0; q <= largest_power; ++q) {
+        push(top_bits(power));
+        multiply(power, 5);
+    }
+    return table;
+}
+
+const std::vector<std::uint64_t> & powers_of_five()
+{
+    static const auto table = build_powers_of_five();
+    return table;
+}
+
+// binary64 as a 52-bit mantissa without the implicit bit and a biased exponent
+struct Binary
+{
+    std::uint64_t mantissa = 0;
+    int power2 = 0;
+
+    bool operator==(const Binary & other) const { return mantissa == other.mantissa && power2 == other.power2; }
+};
+
+constexpr int mantissa_bits = 52;
+constexpr int infinite_power = 0x7FF;
+
+// w * 10^q correctly rounded, see "Number Parsing at a Gigabyte per Second"
+// by D. Lemire and "Fast Number Parsing Without Fallback" by N. Mushtak and
+// D. Lemire for the proof that the 128-bit product is always sufficient
+Binary eisel_lemire(const std::int64_t q, std::uint64_t w)
+{
+    if (w == 0 || q < smallest_power) {
+        return {0, 0};
+    }
+    if (q > largest_power) {
+        return {0, infinite_power};
+    }
+    const int leading_zeros = __builtin_clzll(w);
+    w <<= leading_zeros;
+    const auto & table = powers_of_five();
+    const std::size_t index = 2 * static_cast<std::size_t>(q - smallest_power);
+    const Uint128 first = Uint128{w} * table[index];
+    auto high = static_cast<std::uint64_t>(first >> 64);
+    auto low = static_cast<std::uint64_t>(first);
+    constexpr std::uint64_t precision_mask = ~std::uint64_t{0} >> (mantissa_bits + 3);
+    if ((high & precision_mask) == precision_mask) {
+        const auto second_high = static_cast<std::uint64_t>((Uint128{w} * table[index + 1]) >> 64);
+        low += second_high;
+        if (second_high > low) {
+            ++high;
+        }
+    }
+    const int upper_bit = static_cast<int>(high >> 63);
+    const int shift = upper_bit + 64 - mantissa_bits - 3;
+    Binary res;
+    res.mantissa = high >> shift;
+    // floor(q * log2(10)) + 63
+    res.power2 = static_cast<int>((((152170 + 65536) * q) >> 16) + 63) + upper_bit - leading_zeros + 1023;
+    if (res.power2 <= 0) {
+        // subnormal
+        if (-res.power2 + 1 >= 64) {
+            return {0, 0};
+        }
+        res.mantissa >>= -res.power2 + 1;
+        res.mantissa += res.mantissa & 1;
+        res.mantissa >>= 1;
+        res.power2 = res.mantissa < (std::uint64_t{1} << mantissa_bits) ? 0 : 1;
+        return res;
+    }
+    // exactly halfway between two doubles: round to even instead of up
+    if (low <= 1 && q >= -4 && q <= 23 && (res.mantissa & 3) == 1 && (res.mantissa << shift) == high) {
+        res.mantissa &= ~std::uint64_t{1};
+    }
+    res.mantissa += res.mantissa & 1;
+    res.mantissa >>= 1;
+    if (res.mantissa >= (std::uint64_t{2} << mantissa_bits)) {
+        res.mantissa = std::uint64_t{1} << mantissa_bits;
+        ++res.power2;
+    }
+    res.mantissa &= ~(std::uint64_t{1} << mantissa_bits);
+    if (res.power2 >= infinite_power) {
+        return {0, infinite_power};
+    }
+    return res;
+}
+
+double make_double(const bool negative, const Binary binary)
+{
+    const std::uint64_t bits = binary.mantissa | (std::uint64_t(binary.power2) << mantissa_bits) | (std::uint64_t{negative} << 63);
+    double res;
+    std::memcpy(&res, &bits, sizeof(res));
+    return res;
+}
+
+constexpr std::size_t max_significant = 19;
+
+bool is_digit(const std::string_view text, const std::size_t p)
+{
+    return p < text.size() && text[p] >= '0' && text[p] <= '9';
+}
+
+// appends the run of digits at text[p] to w, which silently wraps around
+// for more than 19 digits
+void scan_digits(const std::string_view text, std::size_t & p, std::uint64_t & w)
+{
+    for (; is_digit(text, p); ++p) {
+        w = w * 10 + static_cast<std::uint64_t>(text[p] - '0');
+    }
+}
+
+// the first 19 significant digits of [integer_begin, integer_end) '.'
+// [fraction_begin, fraction_end) and the power of ten they are missing
+std::uint64_t truncate(const std::string_view text, const std::size_t integer_begin, const std::size_t integer_end, const std::size_t fraction_begin, const std::size_t fraction_end, std::int64_t & exponent)
+{
+    constexpr std::uint64_t min_nineteen_digits = 1000000000000000000;
+    std::uint64_t w = 0;
+    std::size_t p = integer_begin;
+    for (; w < min_nineteen_digits && p < integer_end; ++p) {
+        w = w * 10 + static_cast<std::uint64_t>(text[p] - '0');
+    }
+    if (w >= min_nineteen_digits) {
+        exponent = static_cast<std::int64_t>(integer_end - p);
+        return w;
+    }
+    for (p = fraction_begin; w < min_nineteen_digits && p < fraction_end; ++p) {
+        w = w * 10 + static_cast<std::uint64_t>(text[p] - '0');
+    }
+    exponent = -static_cast<std::int64_t>(p - fraction_begin);
+    return w;
+}
+
+double convert(const bool negative, const std::uint64_t w, const std::int64_t exponent, const bool truncated, const std::string_view text)
+{
+    // Clinger's fast path: both w and the power of ten are exact doubles
+    static const double exact_powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    if (!truncated && w <= (std::uint64_t{1} << 53) && exponent >= -22 && exponent <= 22) {
+        auto value = static_cast<double>(w);
+        value = exponent < 0 ? value / exact_powers[-exponent] : value * exact_powers[exponent];
+        return negative ? -value : value;
+    }
+    const auto binary = eisel_lemire(exponent, w);
+    // digits past the 19th are only known to be somewhere between w and w + 1
+    if (!truncated || binary == eisel_lemire(exponent, w + 1)) {
+        return make_double(negative, binary);
+    }
+    const std::string copy(text);
+    return std::strtod(copy.c_str(), nullptr);
+}
+
+// operands like "." or "1.2.3", which parse_arg() accepts without a word
+bool historical(const std::string_view text)
+{
+    std::size_t digits = 0;
+    for (const char c : text) {
+        if (c != '.' && (c < '0' || c > '9')) {
+            return false;
+        }
+        digits += c == '.' ? 0 : 1;
+    }
+    return digits <= max_decimal_digits;
+}
+
+} // anonymous namespace
+
+double parse_arg(const std::string_view line, std::size_t & i, bool & good)
+{
+    double res = 0;
+    double fraction = 1;
+    scan_arg(line, i, good, [&res, &fraction](const int digit, const bool integer) {
+        if (integer) {
+            res *= 10;
+            res += digit;
+        }
+        else {
+            fraction /= 10;
+            res += digit * fraction;
+        }
+    });
+    return res;
+}
+
+void parse_fixed(const std::string_view line, std::size_t & i, bool & good, std::int64_t & integer, std::int64_t & fraction)
+{
+    integer = 0;
+    fraction = 0;
+    std::int64_t place = fixed_scale;
+    scan_arg(line, i, good, [&integer, &fraction, &place](const int digit, const bool integer_part) {
+        if (integer_part) {
+            integer = integer * 10 + digit;
+        }
+        else {
+            place /= 10;
+            fraction += digit * place;
+        }
+    });
+}
+
+bool validate_arg(const std::string_view line, std::size_t & i, bool & good)
+{
+    bool non_zero = false;
+    scan_arg(line, i, good, [&non_zero](const int digit, bool) { non_zero |= digit != 0; });
+    return non_zero;
+}
+
+double parse_full_arg(const std::string_view line, std::size_t & i, bool & good)
+{
+    double res = 0;
+    std::size_t end = i;
+    if (parse_decimal(line, end, res) && end == line.size()) {
+        i = end;
+        return res;
+    }
+    // the full format extends the historical one, anything it took stays valid
+    if (historical(line.substr(i))) {
+        return parse_arg(line, i, good);
+    }
+    i = end;
+    good = false;
+    std::cerr << "Argument parsing error at " << i << ": '" << line.substr(i) << "'" << std::endl;
+    return res;
+}
+
+double validate_full_arg(const std::string_view line, std::size_t & i, bool & good)
+{
+    return parse_full_arg(line, i, good);
+}
+
+bool parse_decimal(const std::string_view text, std::size_t & i, double & value)
+{
+    std::size_t p = i;
+    const bool negative = p < text.size() && text[p] == '-';
+    if (p < text.size() && (text[p] == '-' || text[p] == '+')) {
+        ++p;
+    }
+    std::uint64_t w = 0;
+    const std::size_t integer_begin = p;
+    scan_digits(text, p, w);
+    const std::size_t integer_end = p;
+    std::size_t fraction_begin = p;
+    if (p < text.size() && text[p] == '.') {
+        fraction_begin = ++p;
+        scan_digits(text, p, w);
+    }
+    const std::size_t fraction_end = p;
+    std::size_t digits = (integer_end - integer_begin) + (fraction_end - fraction_begin);
+    if (digits == 0) {
+        return false;
+    }
+    std::int64_t exponent = 0;
+    if (p < text.size() && (text[p] == 'e' || text[p] == 'E')) {
+        std::size_t e = p + 1;
+        const bool negative_exponent = e < text.size() && text[e] == '-';
+        if (e < text.size() && (text[e] == '-' || text[e] == '+')) {
+            ++e;
+        }
+        // an 'e' without digits isn't a part of the number
+        if (is_digit(text, e)) {
+            for (; is_digit(text, e); ++e) {
+                if (exponent < 100000) {
+                    exponent = exponent * 10 + (text[e] - '0');
+                }
+            }
+            exponent = negative_exponent ? -exponent : exponent;
+            p = e;
+        }
+    }
+    bool truncated = false;
+    if (digits > max_significant) {
+        // leading zeros are not significant
+        for (std::size_t k = integer_begin; k < fraction_end && (text[k] == '0' || text[k] == '.'); ++k) {
+            digits -= text[k] == '0' ? 1 : 0;
+        }
+        if (digits > max_significant) {
+            truncated = true;
+            std::int64_t missing = 0;
+            w = truncate(text, integer_begin, integer_end, fraction_begin, fraction_end, missing);
+            exponent += missing;
+        }
+    }
+    if (!truncated) {
+        exponent -= static_cast<std::int64_t>(fraction_end - fraction_begin);
+    }
+    value = convert(negative, w, exponent, truncated, text.substr(i, p - i));
+    i = p;
+    return true;
+}
+
+} // namespace calc
@@ -0,0 +1,162 @@
+#include "output.h"
+
+#include "profiler.h"
+
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace calc {
+
+namespace {
+
+bool same_file(const int a, const int b)
+{
+    struct stat first;
+    struct stat second;
+    return fstat(a, &first) == 0 && fstat(b, &second) == 0 && first.st_dev == second.st_dev && first.st_ino == second.st_ino;
+}
+
+bool is_pipe(const int fd)
+{
+    struct stat info;
+    return fstat(fd, &info) == 0 && S_ISFIFO(info.st_mode);
+}
+
+} // anonymous namespace
+
+char * format_record(const double value, char * out)
+{
+    out = std::to_chars(out, out + max_record - 1, value, std::chars_format::general, 6).ptr;
+    *out++ = '\n';
+    return out;
+}
+
+Output::Output(const int fd, const bool allow_splice)
+    : m_fd(fd)
+{
+    const auto page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    m_line = isatty(fd) != 0 || same_file(fd, STDERR_FILENO);
+    m_size = 64 * 1024;
+#ifdef F_GETPIPE_SZ
+    if (allow_splice && !m_line && is_pipe(fd)) {
+        // a larger pipe means fewer system calls, it's fine if that's not allowed
+        fcntl(fd, F_SETPIPE_SZ, 1 << 20);
+        const int capacity = fcntl(fd, F_GETPIPE_SZ);
+        if (capacity >= static_cast<int>(2 * page)) {
+            m_size = static_cast<std::size_t>(capacity);
+            m_splice = true;
+        }
+    }
+#endif
+    replace_buffer();
+}
+
+Output::~Output()
+{
+    flush();
+    if (m_buffer != nullptr) {
+        munmap(m_buffer, m_size);
+    }
+}
+
+void Output::write(const double value)
+{
+    const PhaseScope scope(Phase::Format);
+    if (!m_error.empty()) {
+        return;
+    }
+    if (m_used + max_record > m_size) {
+        if (m_splice) {
+            splice_out();
+        }
+        else {
+            flush();
+        }
+        if (!m_error.empty()) {
+            return;
+        }
+    }
+    m_used = static_cast<std::size_t>(format_record(value, m_buffer + m_used) - m_buffer);
+    if (m_line) {
+        flush();
+    }
+}
+
+void Output::flush()
+{
+    // a part of a buffer is copied, the buffer stays in use
+    if (m_used != 0 && m_error.empty()) {
+        write_out(m_buffer, m_used);
+    }
+    m_used = 0;
+}
+
+void Output::write_out(const char * data, std::size_t size)
+{
+    const PhaseScope scope(Phase::Write);
+    while (size > 0) {
+        const auto n = ::write(m_fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            m_error = std::strerror(errno);
+            return;
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+}
+
+void Output::splice_out()
+{
+    const PhaseScope scope(Phase::Write);
+    iovec chunk{m_buffer, m_used};
+    while (chunk.iov_len > 0) {
+        const auto n = vmsplice(m_fd, &chunk, 1, 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // e.g. a kernel without vmsplice, copy from now on
+            write_out(static_cast<const char *>(chunk.iov_base), chunk.iov_len);
+            stop_splicing();
+            return;
+        }
+        chunk.iov_base = static_cast<char *>(chunk.iov_base) + n;
+        chunk.iov_len -= static_cast<std::size_t>(n);
+    }
+    m_used = 0;
+    // the reader may still refer to the pages long after it has read them
+    // (e.g. splice() on to another pipe), they mustn't change
+    replace_buffer();
+}
+
+void Output::stop_splicing()
+{
+    m_splice = false;
+    m_used = 0;
+    replace_buffer();
+}
+
+void Output::replace_buffer()
+{
+    if (m_buffer != nullptr) {
+        munmap(m_buffer, m_size);
+    }
+    // populated at once, one fault per page would cost more than the copy vmsplice() saves
+    void * data = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    m_buffer = data == MAP_FAILED ? nullptr : static_cast<char *>(data);
+    if (m_buffer == nullptr) {
+        m_error = std::strerror(errno);
+    }
+}
+
+} // namespace calc
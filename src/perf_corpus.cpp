@@ -0,0 +1,124 @@
+#include "perf_corpus.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace calc {
+
+namespace {
+
+std::string escape(const std::string & line)
+{
+    std::string res;
+    for (const char c : line) {
+        switch (c) {
+        case '\\': res += "\\\\"; break;
+        case '\t': res += "\\t"; break;
+        case '\n': res += "\\n"; break;
+        case '\r': res += "\\r"; break;
+        default: res += c; break;
+        }
+    }
+    return res;
+}
+
+bool unescape(const std::string & text, std::string & line)
+{
+    line.clear();
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        if (text[i] != '\\') {
+            line += text[i];
+            continue;
+        }
+        if (++i == text.size()) {
+            return false;
+        }
+        switch (text[i]) {
+        case '\\': line += '\\'; break;
+        case 't': line += '\t'; break;
+        case 'n': line += '\n'; break;
+        case 'r': line += '\r'; break;
+        default: return false;
+        }
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+bool load_perf_corpus(const std::string & path, std::vector<PerfCase> & cases)
+{
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Can't open corpus " << path << std::endl;
+        return false;
+    }
+    std::size_t number = 0;
+    for (std::string text; std::getline(in, text);) {
+        ++number;
+        if (text.empty() || text[0] == '#') {
+            continue;
+        }
+        PerfCase entry;
+        const auto first = text.find('\t');
+        const auto second = text.find('\t', first + 1);
+        const auto third = second == std::string::npos ? second : text.find('\t', second + 1);
+        std::istringstream budget(text.substr(first + 1, second - first - 1));
+        // strtod() reads back inf and nan registers too
+        const std::string current = text.substr(second + 1, third - second - 1);
+        char * end = nullptr;
+        entry.current = std::strtod(current.c_str(), &end);
+        if (third == std::string::npos || !(budget >> entry.budget) || current.empty() || *end != '\0' || !unescape(text.substr(third + 1), entry.line)) {
+            std::cerr << "Bad corpus entry at " << path << ":" << number << std::endl;
+            return false;
+        }
+        entry.mode = text.substr(0, first);
+        cases.push_back(std::move(entry));
+    }
+    return true;
+}
+
+bool save_perf_corpus(const std::string & path, const std::vector<PerfCase> & cases)
+{
+    std::ofstream out(path);
+    out << "# mode\tbudget, ns per byte\tregister\tline\n";
+    for (const auto & entry : cases) {
+        out << entry.mode << '\t' << entry.budget << '\t' << std::setprecision(17) << entry.current << '\t' << escape(entry.line) << '\n';
+    }
+    out.flush();
+    if (!out) {
+        std::cerr << "Can't write corpus " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+double ns_per_byte(const Mode & mode, const double current, const std::string & line, const std::size_t rounds)
+{
+    auto * const saved = std::cerr.rdbuf(nullptr);
+    // enough calls per round to see a difference on the clock
+    std::size_t calls = 1;
+    double best = 1e300;
+    for (std::size_t round = 0; round < rounds;) {
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t k = 0; k < calls; ++k) {
+            mode.process(current, line);
+        }
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed.count() < 20000 && calls < (1 << 20)) {
+            calls *= 2;
+            continue;
+        }
+        best = std::min(best, elapsed.count() / static_cast<double>(calls));
+        ++round;
+    }
+    std::cerr.rdbuf(saved);
+    return best / static_cast<double>(std::max(line.size(), min_charged_bytes));
+}
+
+} // namespace calc
@@ -0,0 +1,154 @@
+#include "planner.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace calc {
+
+namespace {
+
+// ns per fold of args, best of several runs
+double measure(const Engine engine, const std::vector<double> & args, const std::size_t grain)
+{
+    using clock = std::chrono::steady_clock;
+    const std::size_t reps = std::max<std::size_t>(1, (1 << 20) / args.size());
+    volatile double sink = 0;
+    double best = std::numeric_limits<double>::infinity();
+    for (int run = 0; run < 5; ++run) {
+        const auto start = clock::now();
+        for (std::size_t rep = 0; rep < reps; ++rep) {
+            sink = fold(engine, Op::ADD, 0, args, grain);
+        }
+        const std::chrono::duration<double, std::nano> elapsed = clock::now() - start;
+        best = std::min(best, elapsed.count() / static_cast<double>(reps));
+    }
+    static_cast<void>(sink);
+    return best;
+}
+
+// smallest measured size from which 'fast' stays faster than 'slow'
+std::size_t crossover(const std::vector<std::size_t> & sizes, const std::vector<double> & fast, const std::vector<double> & slow)
+{
+    std::size_t res = std::numeric_limits<std::size_t>::max();
+    for (std::size_t i = sizes.size(); i-- > 0;) {
+        if (fast[i] >= slow[i]) {
+            break;
+        }
+        res = sizes[i];
+    }
+    return res;
+}
+
+} // anonymous namespace
+
+Engine plan(const Op op, const std::size_t operands, const bool strict, const Tuning & tuning)
+{
+    if (strict) {
+        return Engine::Scalar;
+    }
+    switch (op) {
+    case Op::ADD:
+    case Op::SUB:
+    case Op::MUL:
+    case Op::DIV:
+        if (operands >= tuning.parallel_min_operands) {
+            return Engine::Parallel;
+        }
+        if (operands >= tuning.simd_min_operands) {
+            return Engine::Simd;
+        }
+        return Engine::Scalar;
+    case Op::POW:
+        return operands > 1 ? Engine::Rewrite : Engine::Scalar;
+    default:
+        return Engine::Scalar;
+    }
+}
+
+bool load_tuning(const std::string & path, Tuning & tuning)
+{
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    Tuning res = tuning;
+    for (std::string line; std::getline(in, line);) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        const auto eq = line.find('=');
+        std::size_t value = 0;
+        std::istringstream value_in(eq == std::string::npos ? std::string() : line.substr(eq + 1));
+        if (!(value_in >> value)) {
+            std::cerr << "Bad tuning line '" << line << "' in " << path << std::endl;
+            return false;
+        }
+        const auto key = line.substr(0, eq);
+        if (key == "simd_min_operands") {
+            res.simd_min_operands = value;
+        }
+        else if (key == "parallel_min_operands") {
+            res.parallel_min_operands = value;
+        }
+        else if (key == "parallel_grain") {
+            res.parallel_grain = value;
+        }
+        else {
+            std::cerr << "Unknown tuning key '" << key << "' in " << path << std::endl;
+            return false;
+        }
+    }
+    tuning = res;
+    return true;
+}
+
+bool save_tuning(const std::string & path, const Tuning & tuning)
+{
+    std::ofstream out(path);
+    out << "# generated by calc_fold --autotune\n"
+        << "simd_min_operands=" << tuning.simd_min_operands << "\n"
+        << "parallel_min_operands=" << tuning.parallel_min_operands << "\n"
+        << "parallel_grain=" << tuning.parallel_grain << "\n";
+    return static_cast<bool>(out);
+}
+
+std::string default_tuning_path()
+{
+    if (const char * path = std::getenv("CALC_FOLD_CONFIG")) {
+        return path;
+    }
+    if (const char * home = std::getenv("HOME")) {
+        return std::string(home) + "/.config/calc_fold.conf";
+    }
+    return "calc_fold.conf";
+}
+
+Tuning autotune()
+{
+    Tuning res;
+    std::mt19937_64 random(42);
+    std::uniform_real_distribution<double> distribution(0, 1000);
+    std::vector<std::size_t> sizes;
+    std::vector<double> scalar, simd, parallel;
+    for (std::size_t n = 4; n <= (1 << 22); n *= 2) {
+        std::vector<double> args(n);
+        for (auto & arg : args) {
+            arg = distribution(random);
+        }
+        sizes.push_back(n);
+        scalar.push_back(measure(Engine::Scalar, args, res.parallel_grain));
+        simd.push_back(measure(Engine::Simd, args, res.parallel_grain));
+        parallel.push_back(measure(Engine::Parallel, args, res.parallel_grain));
+    }
+    res.simd_min_operands = crossover(sizes, simd, scalar);
+    res.parallel_min_operands = crossover(sizes, parallel, simd);
+    return res;
+}
+
+} // namespace calc
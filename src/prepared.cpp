@@ -0,0 +1,172 @@
+#include "prepared.h"
+
+#include <iostream>
+#include <sstream>
+
+namespace calc {
+
+namespace {
+
+// messages of a malformed line are printed by every run, not by compile()
+class CapturedErrors
+{
+public:
+    CapturedErrors()
+        : m_saved(std::cerr.rdbuf(m_messages.rdbuf()))
+    {
+    }
+    ~CapturedErrors()
+    {
+        std::cerr.rdbuf(m_saved);
+    }
+
+    CapturedErrors(const CapturedErrors &) = delete;
+    CapturedErrors & operator=(const CapturedErrors &) = delete;
+
+    std::string messages() const { return m_messages.str(); }
+
+private:
+    std::ostringstream m_messages;
+    std::streambuf * m_saved;
+};
+
+} // anonymous namespace
+
+bool PreparedScript::compile(const std::vector<std::string> & lines, const Options & options)
+{
+    m_options = options;
+    m_steps.clear();
+    m_variables = Variables{};
+    for (std::size_t k = 0; k < lines.size(); ++k) {
+        Step step;
+        if (!compile_step(lines, k, step)) {
+            std::cerr << step.message;
+            return false;
+        }
+        m_steps.push_back(std::move(step));
+    }
+    return true;
+}
+
+bool PreparedScript::compile_step(const std::vector<std::string> & lines, std::size_t & k, Step & step)
+{
+    const CapturedErrors errors;
+    const auto & line = lines[k];
+    if (!line.empty() && line[0] == '>') {
+        // a Session assigns whatever the register is, so the slot is known now
+        if (const auto name = assigned_name(line); !name.empty()) {
+            step.line.kind = CompiledLine::Kind::Dynamic;
+            step.assigns = true;
+            step.slot = m_variables.assign(name, 0);
+        }
+        step.message = errors.messages();
+        return true;
+    }
+    if (!line.empty() && line[0] == '=') {
+        step.line.kind = step.program.compile(std::string_view(line).substr(1), m_variables) ? CompiledLine::Kind::Dynamic : CompiledLine::Kind::Invalid;
+        step.message = errors.messages();
+        return true;
+    }
+    // a block folds its operands like a single line fold of all of them,
+    // strictly and in floating point whatever the options are
+    if (FoldBlock block; block.open(0, line, m_options)) {
+        auto fold = line.substr(0, line.find(')') + 1);
+        for (++k; k < lines.size() && !closes_block(lines[k]); ++k) {
+            fold += ' ';
+            fold += lines[k];
+        }
+        if (k == lines.size()) {
+            std::cerr << "Unterminated fold block" << std::endl;
+            step.message = errors.messages();
+            return false;
+        }
+        // a bad header is reported by open() already, a Session skips the block
+        if (errors.messages().empty()) {
+            auto options = m_options;
+            options.strict = true;
+            options.fixed_point = false;
+            step.line = compile_line(fold, options, m_variables);
+        }
+    }
+    else {
+        step.line = compile_line(line, m_options, m_variables);
+    }
+    step.message = errors.messages();
+    return true;
+}
+
+void PreparedScript::run(const std::span<double> registers) const
+{
+    // only the lines with variables need them
+    std::vector<std::vector<double>> values(registers.size(), std::vector<double>(variables()));
+    for (const auto & step : m_steps) {
+        if (step.line.kind == CompiledLine::Kind::Invalid) {
+            if (!registers.empty()) {
+                std::cerr << step.message;
+            }
+            continue;
+        }
+        if (step.line.kind == CompiledLine::Kind::Ops && step.line.loads.empty()) {
+            apply_line(step.line, registers, m_options);
+            continue;
+        }
+        for (std::size_t r = 0; r < registers.size(); ++r) {
+            auto & current = registers[r];
+            if (step.line.kind == CompiledLine::Kind::Ops) {
+                apply_line(step.line, registers.subspan(r, 1), m_options, values[r]);
+            }
+            else if (step.assigns) {
+                values[r][step.slot] = current;
+            }
+            else if (double res = 0; step.program.run(current, res, values[r])) {
+                current = res;
+            }
+        }
+    }
+}
+
+ScriptCache::ScriptCache(const std::size_t capacity, const Options & options)
+    : m_capacity(capacity)
+    , m_options(options)
+{
+}
+
+std::uint64_t ScriptCache::prepare(const std::vector<std::string> & lines)
+{
+    std::string text;
+    for (const auto & line : lines) {
+        text += line;
+        text += '\n';
+    }
+    if (const auto it = m_texts.find(text); it != m_texts.end()) {
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return it->second->handle;
+    }
+    PreparedScript script;
+    if (m_capacity == 0 || !script.compile(lines, m_options)) {
+        return 0;
+    }
+    if (m_entries.size() == m_capacity) {
+        const auto & last = m_entries.back();
+        m_handles.erase(last.handle);
+        m_texts.erase(last.text);
+        m_entries.pop_back();
+    }
+    m_entries.push_front(Entry{m_next++, std::move(text), std::move(script)});
+    const auto it = m_entries.begin();
+    m_handles.emplace(it->handle, it);
+    m_texts.emplace(it->text, it);
+    return it->handle;
+}
+
+const PreparedScript * ScriptCache::find(const std::uint64_t handle)
+{
+    const auto it = m_handles.find(handle);
+    if (it == m_handles.end()) {
+        return nullptr;
+    }
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return &it->second->script;
+}
+
+} // namespace calc
@@ -0,0 +1,166 @@
+#include "profiler.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+namespace calc {
+
+namespace {
+
+// samples by the phase and the operation, written only by the handler
+std::atomic<std::uint64_t> counts[phase_count][op_count];
+
+const char * const op_names[op_count] = {"none", "set", "+", "-", "*", "/", "%", "_", "^", "SQRT"};
+
+void on_sample(int)
+{
+    const auto phase = static_cast<std::size_t>(current_phase.load(std::memory_order_relaxed));
+    const auto op = static_cast<std::size_t>(current_op.load(std::memory_order_relaxed));
+    counts[phase][op].fetch_add(1, std::memory_order_relaxed);
+}
+
+// an operation is charged only for the work done on its operands
+bool op_phase(const std::size_t phase)
+{
+    return phase == static_cast<std::size_t>(Phase::ParseArg) || phase == static_cast<std::size_t>(Phase::Fold);
+}
+
+} // anonymous namespace
+
+const char * phase_name(const Phase phase)
+{
+    switch (phase) {
+    case Phase::Other: return "other";
+    case Phase::Read: return "read";
+    case Phase::ParseOp: return "parse_op";
+    case Phase::ParseArg: return "parse_arg";
+    case Phase::Fold: return "fold";
+    case Phase::Expression: return "expression";
+    case Phase::Format: return "format";
+    case Phase::Write: return "write";
+    }
+    return "?";
+}
+
+Profiler::~Profiler()
+{
+    stop();
+}
+
+bool Profiler::start(const std::chrono::microseconds interval)
+{
+    stop();
+    for (auto & row : counts) {
+        for (auto & count : row) {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+    struct sigaction action = {};
+    action.sa_handler = on_sample;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigevent event = {};
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGPROF;
+    event.sigev_notify_thread_id = static_cast<pid_t>(syscall(SYS_gettid));
+    if (sigaction(SIGPROF, &action, &m_saved_action) != 0) {
+        std::cerr << "Can't start the profiler: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    if (timer_create(CLOCK_PROCESS_CPUTIME_ID, &event, &m_timer) != 0) {
+        std::cerr << "Can't start the profiler: " << std::strerror(errno) << std::endl;
+        sigaction(SIGPROF, &m_saved_action, nullptr);
+        return false;
+    }
+    itimerspec period = {};
+    period.it_interval.tv_sec = interval.count() / 1000000;
+    period.it_interval.tv_nsec = interval.count() % 1000000 * 1000;
+    period.it_value = period.it_interval;
+    if (timer_settime(m_timer, 0, &period, nullptr) != 0) {
+        std::cerr << "Can't start the profiler: " << std::strerror(errno) << std::endl;
+        timer_delete(m_timer);
+        sigaction(SIGPROF, &m_saved_action, nullptr);
+        return false;
+    }
+    m_interval = interval;
+    m_running = true;
+    return true;
+}
+
+void Profiler::stop()
+{
+    if (!m_running) {
+        return;
+    }
+    timer_delete(m_timer);
+    // a sample may still be pending, ignoring the signal discards it before
+    // the old action (SIG_DFL would terminate) gets it
+    std::signal(SIGPROF, SIG_IGN);
+    sigaction(SIGPROF, &m_saved_action, nullptr);
+    m_running = false;
+}
+
+std::uint64_t Profiler::samples() const
+{
+    std::uint64_t res = 0;
+    for (std::size_t phase = 0; phase < phase_count; ++phase) {
+        res += samples(static_cast<Phase>(phase));
+    }
+    return res;
+}
+
+std::uint64_t Profiler::samples(const Phase phase) const
+{
+    std::uint64_t res = 0;
+    for (const auto & count : counts[static_cast<std::size_t>(phase)]) {
+        res += count.load(std::memory_order_relaxed);
+    }
+    return res;
+}
+
+std::uint64_t Profiler::samples(const Op op) const
+{
+    std::uint64_t res = 0;
+    for (std::size_t phase = 0; phase < phase_count; ++phase) {
+        if (op_phase(phase)) {
+            res += counts[phase][static_cast<std::size_t>(op)].load(std::memory_order_relaxed);
+        }
+    }
+    return res;
+}
+
+void Profiler::report(std::ostream & out) const
+{
+    const auto total = samples();
+    const auto line = [&out, total](const char * name, const std::uint64_t count) {
+        if (count != 0) {
+            out << "  " << std::setw(12) << std::left << name << std::right << std::setw(10) << count << std::setw(7) << std::fixed
+                << std::setprecision(1) << 100.0 * static_cast<double>(count) / static_cast<double>(total) << "%\n";
+        }
+    };
+    out << "Profile: " << total << " samples, one per " << m_interval.count() << " us of CPU time\n";
+    if (total == 0) {
+        return;
+    }
+    out << "by phase:\n";
+    for (std::size_t phase = 0; phase < phase_count; ++phase) {
+        line(phase_name(static_cast<Phase>(phase)), samples(static_cast<Phase>(phase)));
+    }
+    out << "by operation (parse_arg and fold):\n";
+    for (std::size_t op = 0; op < op_count; ++op) {
+        line(op_names[op], samples(static_cast<Op>(op)));
+    }
+    out << std::defaultfloat;
+}
+
+} // namespace calc
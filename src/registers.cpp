@@ -0,0 +1,173 @@
+#include "registers.h"
+
+#include "lz4.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace calc {
+
+struct RegisterTable::Header
+{
+    char magic[8];
+    std::uint32_t slot_size;
+    std::uint32_t reserved;
+    std::uint64_t capacity;
+};
+
+namespace {
+
+constexpr char table_magic[8] = {'C', 'A', 'L', 'C', 'R', 'E', 'G', '1'};
+
+std::uint32_t checksum(const std::uint32_t seed, const std::uint64_t value, const std::uint64_t updates)
+{
+    const std::uint64_t data[2] = {value, updates};
+    return xxh32(data, sizeof(data), seed);
+}
+
+} // anonymous namespace
+
+RegisterTable::~RegisterTable()
+{
+    if (m_table != nullptr) {
+        char * mapping = reinterpret_cast<char *>(m_table) - sizeof(Slot);
+        msync(mapping, m_mapped, MS_SYNC);
+        munmap(mapping, m_mapped);
+    }
+}
+
+bool RegisterTable::open(const std::string & path, const std::function<void(std::string_view, double)> & restore, std::size_t capacity)
+{
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        std::cerr << "Can't open register table " << path << ": " << std::strerror(errno) << std::endl;
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return false;
+    }
+    Header header{};
+    const bool created = info.st_size == 0;
+    if (created) {
+        std::memcpy(header.magic, table_magic, sizeof(table_magic));
+        header.slot_size = sizeof(Slot);
+        header.capacity = capacity;
+    }
+    else if (pread(fd, &header, sizeof(header), 0) != sizeof(header) || std::memcmp(header.magic, table_magic, sizeof(table_magic)) != 0 ||
+             header.slot_size != sizeof(Slot) || static_cast<std::uint64_t>(info.st_size) != (header.capacity + 1) * sizeof(Slot)) {
+        std::cerr << "Not a register table: " << path << std::endl;
+        ::close(fd);
+        return false;
+    }
+    m_capacity = header.capacity;
+    m_mapped = (m_capacity + 1) * sizeof(Slot);
+    // a new file is sparse, only the pages of the used slots take space
+    if (created && (ftruncate(fd, static_cast<off_t>(m_mapped)) != 0 || pwrite(fd, &header, sizeof(header), 0) != sizeof(header))) {
+        std::cerr << "Can't create register table " << path << ": " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return false;
+    }
+    void * mapping = mmap(nullptr, m_mapped, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Can't map register table " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    m_table = reinterpret_cast<Slot *>(static_cast<char *>(mapping) + sizeof(Slot));
+    m_seeds.assign(m_capacity, 0);
+    std::size_t dropped = 0;
+    for (std::size_t k = 0; k < m_capacity; ++k) {
+        Slot & slot = m_table[k];
+        if (slot.name_size == 0 && slot.sequence.load(std::memory_order_relaxed) == 0) {
+            continue;
+        }
+        const std::string_view name(slot.name, std::min<std::size_t>(slot.name_size, max_name));
+        const auto seed = xxh32(name.data(), name.size());
+        if (slot.sequence.load(std::memory_order_relaxed) % 2 != 0 || name.empty() || slot.name_size > max_name ||
+            slot.checksum != checksum(seed, slot.value, slot.updates) || m_slots.count(name) != 0) {
+            ++dropped;
+            std::memset(static_cast<void *>(&slot), 0, sizeof(Slot));
+            continue;
+        }
+        m_seeds[k] = seed;
+        m_slots.emplace(name, k);
+        double value;
+        std::memcpy(&value, &slot.value, sizeof(value));
+        restore(name, value);
+    }
+    if (dropped != 0) {
+        std::cerr << "Register table " << path << ": dropped " << dropped << " torn slots" << std::endl;
+    }
+    return true;
+}
+
+std::size_t RegisterTable::slot(const std::string_view name)
+{
+    if (const auto it = m_slots.find(name); it != m_slots.end()) {
+        return it->second;
+    }
+    while (m_next < m_capacity && m_table[m_next].name_size != 0) {
+        ++m_next;
+    }
+    if (m_table == nullptr || m_next == m_capacity || name.empty() || name.size() > max_name) {
+        return npos;
+    }
+    const std::size_t k = m_next++;
+    Slot & slot = m_table[k];
+    const auto sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(slot.name, name.data(), name.size());
+    slot.name_size = static_cast<std::uint16_t>(name.size());
+    m_seeds[k] = xxh32(name.data(), name.size());
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    write(slot, m_seeds[k], 0, 0);
+    m_slots.emplace(name, k);
+    return k;
+}
+
+void RegisterTable::store(const std::size_t slot, const double value)
+{
+    if (slot >= m_capacity) {
+        return;
+    }
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    write(m_table[slot], m_seeds[slot], bits, m_table[slot].updates + 1);
+}
+
+double RegisterTable::load(const std::size_t slot) const
+{
+    Slot & entry = m_table[slot];
+    for (;;) {
+        const auto before = entry.sequence.load(std::memory_order_acquire);
+        const auto bits = std::atomic_ref<std::uint64_t>(entry.value).load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (before % 2 == 0 && entry.sequence.load(std::memory_order_relaxed) == before) {
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+    }
+}
+
+void RegisterTable::write(Slot & slot, const std::uint32_t seed, const std::uint64_t value, const std::uint64_t updates)
+{
+    const auto sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::atomic_ref<std::uint64_t>(slot.value).store(value, std::memory_order_relaxed);
+    std::atomic_ref<std::uint64_t>(slot.updates).store(updates, std::memory_order_relaxed);
+    std::atomic_ref<std::uint32_t>(slot.checksum).store(checksum(seed, value, updates), std::memory_order_relaxed);
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+} // namespace calc
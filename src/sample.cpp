@@ -0,0 +1,210 @@
+#include "sample.h"
+
+#include "number.h"
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace calc {
+
+namespace {
+
+bool is_space(const char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+std::size_t skip_space(const std::string_view text, std::size_t p)
+{
+    while (p < text.size() && is_space(text[p])) {
+        ++p;
+    }
+    return p;
+}
+
+std::size_t skip_token(const std::string_view text, std::size_t p)
+{
+    while (p < text.size() && !is_space(text[p])) {
+        ++p;
+    }
+    return p;
+}
+
+bool parse_token(const std::string_view text, const std::size_t begin, double & value)
+{
+    const auto token = text.substr(begin, skip_token(text, begin) - begin);
+    std::size_t pos = 0;
+    bool good = true;
+    value = parse_full_arg(token, pos, good);
+    return good;
+}
+
+// mean and variance of the mean of the sample
+struct Moments
+{
+    double mean = 0;
+    double variance = 0;
+};
+
+Moments moments(const std::vector<double> & values)
+{
+    Moments res;
+    const auto n = static_cast<double>(values.size());
+    for (const auto v : values) {
+        res.mean += v;
+    }
+    res.mean /= n;
+    if (values.size() < 2) {
+        res.variance = std::numeric_limits<double>::infinity();
+        return res;
+    }
+    for (const auto v : values) {
+        res.variance += (v - res.mean) * (v - res.mean);
+    }
+    res.variance /= (n - 1) * n;
+    return res;
+}
+
+// Each operand is thought to span the bytes from its start to the start of
+// the next one (the first also takes the leading whitespace), so a byte
+// drawn uniformly picks it with probability span / size. value * size / span
+// is then an unbiased estimate of the sum (Hansen-Hurwitz).
+bool stride_sum(const std::string_view text, const SampleConfig & config, Estimate & estimate)
+{
+    const auto first = skip_space(text, 0);
+    if (config.samples >= text.size()) {
+        // every byte would be drawn, that's every operand: the exact fold
+        double sum = 0;
+        std::size_t count = 0;
+        for (auto p = first; p < text.size(); p = skip_space(text, skip_token(text, p)), ++count) {
+            double value = 0;
+            if (!parse_token(text, p, value)) {
+                return false;
+            }
+            sum += value;
+        }
+        estimate = {sum, sum, sum, count};
+        return true;
+    }
+    const auto size = static_cast<double>(text.size());
+    const auto n = config.samples;
+    const double step = size / static_cast<double>(n);
+    std::mt19937_64 random(config.seed);
+    const double start = std::uniform_real_distribution<double>(0, step)(random);
+    std::vector<double> values;
+    values.reserve(n);
+    for (std::size_t k = 0; k < n; ++k) {
+        auto p = std::min(static_cast<std::size_t>(start + step * static_cast<double>(k)), text.size() - 1);
+        while (p > first && is_space(text[p])) {
+            --p;
+        }
+        while (p > first && !is_space(text[p - 1])) {
+            --p;
+        }
+        p = std::max(p, first);
+        const auto span = skip_space(text, skip_token(text, p)) - (p == first ? 0 : p);
+        double value = 0;
+        if (!parse_token(text, p, value)) {
+            return false;
+        }
+        values.push_back(value * size / static_cast<double>(span));
+    }
+    const auto m = moments(values);
+    const auto half = normal_quantile(config.confidence) * std::sqrt(m.variance);
+    estimate = {m.mean, m.mean - half, m.mean + half, n};
+    return true;
+}
+
+// Algorithm L: after the reservoir is full the gaps between replaced
+// operands are drawn directly, so skipped operands are only tokenized.
+bool reservoir_sum(const std::string_view text, const SampleConfig & config, Estimate & estimate)
+{
+    const auto k = config.samples;
+    std::mt19937_64 random(config.seed);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    const auto draw = [&] { return std::log(1 - uniform(random)); }; // log of a uniform (0, 1]
+    std::uniform_int_distribution<std::size_t> slot(0, k - 1);
+    std::vector<std::size_t> reservoir;
+    reservoir.reserve(std::min(k, text.size() / 2 + 1));
+    double w = std::exp(draw() / static_cast<double>(k));
+    const auto gap = [&] { return static_cast<std::size_t>(std::floor(draw() / std::log1p(-w))) + 1; };
+    std::size_t count = 0;
+    std::size_t next = k;
+    for (auto p = skip_space(text, 0); p < text.size(); p = skip_space(text, skip_token(text, p)), ++count) {
+        if (count < k) {
+            reservoir.push_back(p);
+            if (count + 1 == k) {
+                next = k - 1 + gap();
+            }
+        }
+        else if (count == next) {
+            reservoir[slot(random)] = p;
+            w *= std::exp(draw() / static_cast<double>(k));
+            next += gap();
+        }
+    }
+    std::vector<double> values;
+    values.reserve(reservoir.size());
+    for (const auto p : reservoir) {
+        double value = 0;
+        if (!parse_token(text, p, value)) {
+            return false;
+        }
+        values.push_back(value);
+    }
+    if (count <= k) {
+        // every operand is in the reservoir in its order, that's the exact fold
+        double sum = 0;
+        for (const auto v : values) {
+            sum += v;
+        }
+        estimate = {sum, sum, sum, count};
+        return true;
+    }
+    const auto m = moments(values);
+    const auto total = static_cast<double>(count);
+    const auto fpc = 1 - static_cast<double>(k) / total;
+    const auto half = normal_quantile(config.confidence) * total * std::sqrt(m.variance * fpc);
+    const auto sum = m.mean * total;
+    estimate = {sum, sum - half, sum + half, k};
+    return true;
+}
+
+} // anonymous namespace
+
+double normal_quantile(const double confidence)
+{
+    double low = 0;
+    double high = 40;
+    for (int i = 0; i < 100; ++i) {
+        const double mid = (low + high) / 2;
+        (std::erf(mid / std::sqrt(2.0)) < confidence ? low : high) = mid;
+    }
+    return (low + high) / 2;
+}
+
+bool estimate_sum(const std::string_view text, const SampleConfig & config, Estimate & estimate)
+{
+    if (config.samples == 0) {
+        std::cerr << "Bad sample size: 0" << std::endl;
+        return false;
+    }
+    if (!(config.confidence > 0 && config.confidence < 1)) {
+        std::cerr << "Bad confidence level: " << config.confidence << std::endl;
+        return false;
+    }
+    if (skip_space(text, 0) == text.size()) {
+        std::cerr << "No argument for a binary operation" << std::endl;
+        return false;
+    }
+    switch (config.method) {
+    case Sampling::Stride: return stride_sum(text, config, estimate);
+    case Sampling::Reservoir: return reservoir_sum(text, config, estimate);
+    }
+    return false;
+}
+
+} // namespace calc
@@ -0,0 +1,52 @@
+#include "scan.h"
+
+#include <cctype>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace calc {
+
+namespace {
+
+bool is_number_char(const char ch)
+{
+    return (ch >= '0' && ch <= '9') || ch == '.' || std::isspace(static_cast<unsigned char>(ch));
+}
+
+#if defined(__SSE2__)
+// lanes with lo <= byte <= hi
+__m128i in_range(const __m128i bytes, const char lo, const char hi)
+{
+    const __m128i shifted = _mm_sub_epi8(bytes, _mm_set1_epi8(lo));
+    const __m128i width = _mm_set1_epi8(static_cast<char>(hi - lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(shifted, width), shifted);
+}
+#endif
+
+} // anonymous namespace
+
+bool only_number_chars(const std::string_view text)
+{
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= text.size(); i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text.data() + i));
+        const __m128i digit = in_range(bytes, '0', '9');
+        const __m128i space = _mm_or_si128(in_range(bytes, '\t', '\r'), _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')));
+        const __m128i dot = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('.'));
+        if (_mm_movemask_epi8(_mm_or_si128(digit, _mm_or_si128(space, dot))) != 0xFFFF) {
+            return false;
+        }
+    }
+#endif
+    for (; i < text.size(); ++i) {
+        if (!is_number_char(text[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace calc
@@ -0,0 +1,391 @@
+#include "server.h"
+
+#include "number.h"
+#include "output.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace calc {
+
+namespace {
+
+constexpr std::string_view session_command = "@session";
+constexpr std::string_view prepare_command = "@prepare";
+constexpr std::string_view end_command = "@end";
+constexpr std::string_view execute_command = "@execute";
+
+// the rest of the line after the command and a space, nothing if it isn't the command
+std::optional<std::string_view> arguments(const std::string_view line, const std::string_view command)
+{
+    if (line.substr(0, command.size()) != command || (line.size() != command.size() && line[command.size()] != ' ')) {
+        return std::nullopt;
+    }
+    return line.substr(std::min(line.size(), command.size() + 1));
+}
+
+// results of the replayed lines are known already, their messages too
+class MutedErrors
+{
+public:
+    MutedErrors()
+        : m_saved(std::cerr.rdbuf(nullptr))
+    {
+    }
+    ~MutedErrors()
+    {
+        std::cerr.rdbuf(m_saved);
+    }
+
+    MutedErrors(const MutedErrors &) = delete;
+    MutedErrors & operator=(const MutedErrors &) = delete;
+
+private:
+    std::streambuf * m_saved;
+};
+
+} // anonymous namespace
+
+bool valid_session_name(const std::string_view name, const std::size_t max_size)
+{
+    return !name.empty() && name.size() <= max_size &&
+            std::none_of(name.begin(), name.end(), [](const char c) { return c == ' ' || c == '\t' || c == '\r'; });
+}
+
+Server::Server(const ServerConfig & config)
+    : m_config(config)
+    , m_scripts(config.prepared_scripts, config.options)
+{
+}
+
+Server::~Server()
+{
+    commit();
+    for (auto & client : m_clients) {
+        send(client);
+        close(client.fd);
+    }
+    if (m_listen >= 0) {
+        close(m_listen);
+        unlink(m_config.socket_path.c_str());
+    }
+    for (const int fd : m_wake) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+bool Server::open()
+{
+    std::map<std::string, double, std::less<>> stored;
+    if (!m_config.registers_path.empty()) {
+        const auto restore = [&stored](const std::string_view name, const double value) { stored.emplace(name, value); };
+        if (!m_registers.open(m_config.registers_path, restore)) {
+            return false;
+        }
+    }
+    // the log restores whole sessions, so it wins over the table
+    if (!m_config.log_path.empty()) {
+        const auto apply = [this](const std::string_view name, const std::string_view line) {
+            const MutedErrors muted;
+            session(name).session.feed(std::string(line));
+        };
+        if (!m_log.open(m_config.log_path, apply)) {
+            return false;
+        }
+        m_logging = true;
+    }
+    for (const auto & [name, value] : stored) {
+        session(name, value);
+    }
+    for (auto & [name, named] : m_sessions) {
+        m_registers.store(named.slot, named.session.current());
+    }
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (m_config.socket_path.empty() || m_config.socket_path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Bad socket path: '" << m_config.socket_path << "'" << std::endl;
+        return false;
+    }
+    std::memcpy(address.sun_path, m_config.socket_path.c_str(), m_config.socket_path.size());
+    // a socket left by a previous run
+    unlink(m_config.socket_path.c_str());
+    m_listen = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_listen < 0 || bind(m_listen, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 || listen(m_listen, SOMAXCONN) != 0 ||
+        pipe2(m_wake, O_NONBLOCK | O_CLOEXEC) != 0) {
+        std::cerr << "Can't listen on " << m_config.socket_path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Server::run()
+{
+    std::vector<pollfd> fds;
+    for (;;) {
+        fds.clear();
+        fds.push_back({m_listen, POLLIN, 0});
+        fds.push_back({m_wake[0], POLLIN, 0});
+        for (const auto & client : m_clients) {
+            // a closed client only waits for its results, POLLHUP would wake us up all the time
+            fds.push_back({client.eof && client.out.empty() ? -1 : client.fd, static_cast<short>((client.eof ? 0 : POLLIN) | (client.out.empty() ? 0 : POLLOUT)), 0});
+        }
+        timespec timeout{};
+        if (m_batch_start) {
+            const auto left = std::max(std::chrono::nanoseconds::zero(), *m_batch_start + m_config.commit_window - std::chrono::steady_clock::now());
+            timeout.tv_sec = left.count() / 1000000000;
+            timeout.tv_nsec = left.count() % 1000000000;
+        }
+        if (ppoll(fds.data(), fds.size(), m_batch_start ? &timeout : nullptr, nullptr) < 0 && errno != EINTR) {
+            std::cerr << "Can't poll the clients: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        if (fds[1].revents != 0) {
+            return commit();
+        }
+        // new clients go after the polled ones, so fds[k + 2] is m_clients[k]
+        const std::size_t polled = m_clients.size();
+        for (std::size_t k = 0; k < polled; ++k) {
+            if ((fds[k + 2].revents & (POLLIN | POLLHUP | POLLERR)) != 0) {
+                receive(m_clients[k]);
+            }
+        }
+        if (fds[0].revents != 0) {
+            for (int fd; (fd = accept4(m_listen, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0;) {
+                Client client;
+                client.fd = fd;
+                m_clients.push_back(std::move(client));
+            }
+        }
+        if (m_logging && m_log.pending() != 0) {
+            const auto now = std::chrono::steady_clock::now();
+            if (!m_batch_start) {
+                m_batch_start = now;
+            }
+            if ((now - *m_batch_start >= m_config.commit_window || m_log.pending() >= m_config.commit_bytes) && !commit()) {
+                return false;
+            }
+        }
+        for (auto & client : m_clients) {
+            send(client);
+        }
+        // a client is done once it has closed its end and got all its results
+        const auto done = std::remove_if(m_clients.begin(), m_clients.end(), [](const Client & client) {
+            if (client.fd >= 0 && !(client.eof && client.held.empty() && client.out.empty())) {
+                return false;
+            }
+            if (client.fd >= 0) {
+                close(client.fd);
+            }
+            return true;
+        });
+        m_clients.erase(done, m_clients.end());
+    }
+}
+
+void Server::stop()
+{
+    const char byte = 0;
+    [[maybe_unused]] const auto n = write(m_wake[1], &byte, 1);
+}
+
+std::optional<double> Server::current(const std::string_view name) const
+{
+    const auto it = m_sessions.find(name);
+    if (it == m_sessions.end()) {
+        return std::nullopt;
+    }
+    return it->second.session.current();
+}
+
+Server::Named & Server::session(const std::string_view name, const double current)
+{
+    auto it = m_sessions.find(name);
+    if (it == m_sessions.end()) {
+        it = m_sessions.emplace(std::string(name), Named{Session(m_config.options, current), m_registers.slot(name)}).first;
+    }
+    return it->second;
+}
+
+void Server::receive(Client & client)
+{
+    char buffer[1 << 16];
+    mark_phase(Phase::Read);
+    for (;;) {
+        const auto n = read(client.fd, buffer, sizeof(buffer));
+        if (n > 0) {
+            client.in.append(buffer, static_cast<std::size_t>(n));
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            client.eof = true;
+        }
+        break;
+    }
+    mark_phase(Phase::Other);
+    std::size_t begin = 0;
+    for (std::size_t end; (end = client.in.find('\n', begin)) != std::string::npos; begin = end + 1) {
+        handle(client, std::string_view(client.in).substr(begin, end - begin));
+    }
+    // like std::getline, the last line may have no newline
+    if (client.eof && begin < client.in.size()) {
+        handle(client, std::string_view(client.in).substr(begin));
+        begin = client.in.size();
+    }
+    client.in.erase(0, begin);
+}
+
+void Server::handle(Client & client, const std::string_view line)
+{
+    if (client.script) {
+        if (line != end_command) {
+            if (client.script->size() < m_config.max_script_lines) {
+                client.script->emplace_back(line);
+            }
+            else {
+                client.script_too_long = true;
+            }
+            return;
+        }
+        const auto handle = client.script_too_long ? 0 : m_scripts.prepare(*client.script);
+        client.script.reset();
+        if (client.script_too_long) {
+            std::cerr << "Script longer than " << m_config.max_script_lines << " lines" << std::endl;
+            client.script_too_long = false;
+            answers(client) += "@error\n";
+        }
+        else if (handle == 0) {
+            std::cerr << "Can't prepare the script" << std::endl;
+            answers(client) += "@error\n";
+        }
+        else {
+            auto & out = answers(client);
+            out += "@prepared ";
+            out += std::to_string(handle);
+            out += '\n';
+        }
+        return;
+    }
+    if (const auto name = arguments(line, session_command)) {
+        if (valid_session_name(*name, m_config.registers_path.empty() ? max_session_name : RegisterTable::max_name)) {
+            client.session = *name;
+        }
+        else {
+            std::cerr << "Bad session name: '" << *name << "'" << std::endl;
+        }
+        return;
+    }
+    if (arguments(line, prepare_command)) {
+        client.script.emplace();
+        return;
+    }
+    if (const auto rest = arguments(line, execute_command)) {
+        execute(client, *rest);
+        return;
+    }
+    auto & named = session(client.session);
+    const auto current = named.session.feed(std::string(line));
+    if (m_logging) {
+        m_log.append(client.session, line);
+    }
+    if (current) {
+        m_registers.store(named.slot, *current);
+        const PhaseScope scope(Phase::Format);
+        char record[max_record];
+        auto & results = m_logging ? client.held : client.out;
+        results.append(record, format_record(*current, record));
+    }
+}
+
+void Server::execute(Client & client, const std::string_view arguments)
+{
+    std::uint64_t handle = 0;
+    const auto [end, error] = std::from_chars(arguments.data(), arguments.data() + arguments.size(), handle);
+    std::vector<double> registers;
+    bool good = error == std::errc();
+    for (auto i = static_cast<std::size_t>(end - arguments.data()); good && i < arguments.size();) {
+        if (arguments[i] == ' ') {
+            ++i;
+            continue;
+        }
+        double value = 0;
+        good = parse_decimal(arguments, i, value) && (i == arguments.size() || arguments[i] == ' ');
+        registers.push_back(value);
+    }
+    const auto * script = good ? m_scripts.find(handle) : nullptr;
+    if (script == nullptr) {
+        if (good) {
+            std::cerr << "No prepared script " << handle << std::endl;
+        }
+        else {
+            std::cerr << "Bad arguments of @execute: '" << arguments << "'" << std::endl;
+        }
+        answers(client) += "@error\n";
+        return;
+    }
+    script->run(registers);
+    const PhaseScope scope(Phase::Format);
+    auto & out = answers(client);
+    for (const double value : registers) {
+        char record[max_record];
+        out.append(record, format_record(value, record));
+    }
+}
+
+void Server::send(Client & client)
+{
+    const PhaseScope scope(Phase::Write);
+    while (!client.out.empty() && client.fd >= 0) {
+        const auto n = ::send(client.fd, client.out.data(), client.out.size(), MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                // nobody to tell the results to
+                close(client.fd);
+                client.fd = -1;
+            }
+            return;
+        }
+        client.out.erase(0, static_cast<std::size_t>(n));
+    }
+}
+
+bool Server::commit()
+{
+    m_batch_start.reset();
+    if (!m_logging || m_log.pending() == 0) {
+        return true;
+    }
+    mark_phase(Phase::Write);
+    const bool written = m_log.commit();
+    mark_phase(Phase::Other);
+    if (!written) {
+        std::cerr << "Can't write the command log: " << std::strerror(errno) << std::endl;
+        m_logging = false;
+        return false;
+    }
+    for (auto & client : m_clients) {
+        client.out += client.held;
+        client.held.clear();
+    }
+    return true;
+}
+
+} // namespace calc
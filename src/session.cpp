@@ -0,0 +1,38 @@
+#include "session.h"
+
+#include <iostream>
+
+namespace calc {
+
+Session::Session(const Options & options, const double current)
+    : m_options(options)
+    , m_current(current)
+{
+}
+
+std::optional<double> Session::feed(const std::string & line)
+{
+    if (m_block.active()) {
+        if (!m_block.feed(line)) {
+            return std::nullopt;
+        }
+        m_current = m_block.result();
+    }
+    else if (m_block.open(m_current, line, m_options, m_context.variables())) {
+        return std::nullopt;
+    }
+    else {
+        m_current = process_line(m_current, line, m_options, m_context);
+    }
+    return m_current;
+}
+
+void Session::finish()
+{
+    if (m_block.active()) {
+        std::cerr << "Unterminated fold block" << std::endl;
+        m_block = FoldBlock{};
+    }
+}
+
+} // namespace calc
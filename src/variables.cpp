@@ -0,0 +1,69 @@
+#include "variables.h"
+
+#include <iostream>
+
+namespace calc {
+
+namespace {
+
+bool is_name_char(const char c, const bool first)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || (!first && c >= '0' && c <= '9');
+}
+
+} // anonymous namespace
+
+std::size_t Variables::assign(const std::string_view name, const double value)
+{
+    auto it = m_slots.find(name);
+    if (it == m_slots.end()) {
+        it = m_slots.emplace(std::string(name), m_values.size()).first;
+        m_values.push_back(value);
+    }
+    else {
+        m_values[it->second] = value;
+    }
+    return it->second;
+}
+
+std::optional<std::size_t> Variables::find(const std::string_view name) const
+{
+    const auto it = m_slots.find(name);
+    if (it == m_slots.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+double Variables::parse(const std::string_view text, std::size_t & i, bool & good) const
+{
+    const auto name = parse_variable_name(text, i);
+    if (name.empty()) {
+        std::cerr << "Argument parsing error at " << i << ": '" << text.substr(i) << "'" << std::endl;
+        good = false;
+        return 0;
+    }
+    const auto slot = find(name);
+    if (!slot) {
+        std::cerr << "Unknown variable $" << name << std::endl;
+        good = false;
+        return 0;
+    }
+    return m_values[*slot];
+}
+
+std::string_view parse_variable_name(const std::string_view text, std::size_t & i)
+{
+    if (i + 1 >= text.size() || text[i] != '$' || !is_name_char(text[i + 1], true)) {
+        return {};
+    }
+    std::size_t end = i + 2;
+    while (end < text.size() && is_name_char(text[end], false)) {
+        ++end;
+    }
+    const auto name = text.substr(i + 1, end - i - 1);
+    i = end;
+    return name;
+}
+
+} // namespace calc
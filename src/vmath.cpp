@@ -0,0 +1,320 @@
+#include "vmath.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace calc {
+
+namespace {
+
+#if defined(__x86_64__)
+bool has_avx2_fma()
+{
+    static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return supported;
+}
+
+double from_bits(const std::uint64_t bits)
+{
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+std::uint64_t to_bits(const double value)
+{
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// log(x) = e ln2 + log(c) + log1p(z / c - 1) where x = 2^e z, z is in
+// [0x1.6ap-1, 0x1.6ap0) and c is the middle of one of 128 intervals of z
+// picked by the top bits of its mantissa
+constexpr int table_bits = 7;
+constexpr std::size_t table_size = 1 << table_bits;
+constexpr std::uint64_t log_offset = 0x3fe6a00000000000;
+
+// ln2 as a double-double
+constexpr double ln2_hi = 0x1.62e42fefa39efp-1;
+constexpr double ln2_lo = 0x1.abc9e3b39803fp-56;
+
+struct Tables
+{
+    double invc[table_size];
+    double logc_hi[table_size];
+    double logc_lo[table_size];
+    // 2^(j / 128) as a double-double
+    double exp_hi[table_size];
+    double exp_lo[table_size];
+    // ln2 and ln2 / 128 split so that their upper parts times any exponent
+    // of a double, or of a result of exp(), are exact
+    double ln2_hi;
+    double ln2_lo;
+    double ln2_128_hi;
+    double ln2_128_lo;
+};
+
+// the upper bits of x, the rest is zero
+double truncate(const double x, const int bits)
+{
+    return from_bits(to_bits(x) & ~((std::uint64_t{1} << (52 - bits)) - 1));
+}
+
+Tables build_tables()
+{
+    Tables t;
+    for (std::size_t i = 0; i < table_size; ++i) {
+        const auto low = static_cast<long double>(from_bits(log_offset + (i << (52 - table_bits))));
+        const auto high = static_cast<long double>(from_bits(log_offset + ((i + 1) << (52 - table_bits))));
+        // around 1 log(x) is tiny, c = 1 keeps it from cancelling out
+        const bool around_one = low >= 1 - 0x1p-8L && low <= 1;
+        t.invc[i] = around_one ? 1 : static_cast<double>(2 / (low + high));
+        const long double logc = -std::log(static_cast<long double>(t.invc[i]));
+        t.logc_hi[i] = static_cast<double>(logc);
+        t.logc_lo[i] = static_cast<double>(logc - t.logc_hi[i]);
+        const long double power = std::exp2(static_cast<long double>(i) / table_size);
+        t.exp_hi[i] = static_cast<double>(power);
+        t.exp_lo[i] = static_cast<double>(power - t.exp_hi[i]);
+    }
+    t.ln2_hi = truncate(ln2_hi, 42);
+    t.ln2_lo = (ln2_hi - t.ln2_hi) + ln2_lo;
+    t.ln2_128_hi = truncate(ln2_hi / table_size, 34);
+    t.ln2_128_lo = (ln2_hi / table_size - t.ln2_128_hi) + ln2_lo / table_size;
+    return t;
+}
+
+const Tables & tables()
+{
+    static const Tables t = build_tables();
+    return t;
+}
+
+__attribute__((target("avx2,fma"))) inline void two_sum(const __m256d a, const __m256d b, __m256d & sum, __m256d & error)
+{
+    sum = _mm256_add_pd(a, b);
+    const __m256d b_part = _mm256_sub_pd(sum, a);
+    error = _mm256_add_pd(_mm256_sub_pd(a, _mm256_sub_pd(sum, b_part)), _mm256_sub_pd(b, b_part));
+}
+
+__attribute__((target("avx2,fma"))) void sqrt_avx2(double * values, const std::size_t n)
+{
+    const __m256d zero = _mm256_setzero_pd();
+    std::size_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        const __m256d x = _mm256_loadu_pd(values + k);
+        const __m256d positive = _mm256_cmp_pd(x, zero, _CMP_GT_OQ);
+        _mm256_storeu_pd(values + k, _mm256_blendv_pd(x, _mm256_sqrt_pd(x), positive));
+    }
+    for (; k < n; ++k) {
+        if (values[k] > 0) {
+            values[k] = std::sqrt(values[k]);
+        }
+    }
+}
+
+__attribute__((target("avx2,fma"))) void fmod_avx2(double * values, const std::size_t n, const double divisor)
+{
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const __m256d y = _mm256_set1_pd(std::fabs(divisor));
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d limit = _mm256_set1_pd(0x1p52);
+    std::size_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        double lanes[4];
+        std::memcpy(lanes, values + k, sizeof(lanes));
+        const __m256d x = _mm256_loadu_pd(lanes);
+        const __m256d ax = _mm256_andnot_pd(sign, x);
+        const __m256d quotient = _mm256_div_pd(ax, y);
+        const __m256d q = _mm256_round_pd(quotient, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+        __m256d r = _mm256_fnmadd_pd(q, y, ax);
+        r = _mm256_add_pd(r, _mm256_and_pd(_mm256_cmp_pd(r, zero, _CMP_LT_OQ), y));
+        _mm256_storeu_pd(values + k, _mm256_or_pd(r, _mm256_and_pd(sign, x)));
+        // NaN quotients fail the comparison too
+        const int slow = _mm256_movemask_pd(_mm256_cmp_pd(quotient, limit, _CMP_NLT_UQ));
+        if (slow != 0) {
+            for (int lane = 0; lane < 4; ++lane) {
+                if ((slow >> lane) & 1) {
+                    values[k + lane] = std::fmod(lanes[lane], divisor);
+                }
+            }
+        }
+    }
+    for (; k < n; ++k) {
+        values[k] = std::fmod(values[k], divisor);
+    }
+}
+
+// degree 11 polynomial of log1p(r) = r - r^2 / 2 + r^3 P(r) for |r| < 2^-7
+constexpr double log1p_coefficients[] = {1.0 / 3, -1.0 / 4, 1.0 / 5, -1.0 / 6, 1.0 / 7, -1.0 / 8, 1.0 / 9, -1.0 / 10, 1.0 / 11};
+// exp(s) - 1 = s + s^2 Q(s) for |s| < ln2 / 256
+constexpr double expm1_coefficients[] = {1.0 / 2, 1.0 / 6, 1.0 / 24, 1.0 / 120, 1.0 / 720};
+
+__attribute__((target("avx2,fma"))) void pow_avx2(double * values, const std::size_t n, const double exponent)
+{
+    const Tables & t = tables();
+    const __m256d one = _mm256_set1_pd(1);
+    const __m256d y = _mm256_set1_pd(exponent);
+    const __m256i magic_bits = _mm256_set1_epi64x(0x4338000000000000);
+    const __m256d magic = _mm256_castsi256_pd(magic_bits);
+    const __m256i index_mask = _mm256_set1_epi64x(table_size - 1);
+    const __m256i sign_bit = _mm256_set1_epi64x(0x800);
+    double lanes[4];
+    for (std::size_t k = 0; k < n; k += 4) {
+        const std::size_t count = n - k < 4 ? n - k : 4;
+        double * data = values + k;
+        if (count < 4) {
+            // the tail is padded with ones, which are on the fast path
+            for (std::size_t lane = 0; lane < 4; ++lane) {
+                lanes[lane] = lane < count ? data[lane] : 1;
+            }
+            data = lanes;
+        }
+        const __m256d x = _mm256_loadu_pd(data);
+        const __m256i ix = _mm256_castpd_si256(x);
+
+        // x = 2^e z
+        const __m256i tmp = _mm256_sub_epi64(ix, _mm256_set1_epi64x(log_offset));
+        const __m256i i = _mm256_and_si256(_mm256_srli_epi64(tmp, 52 - table_bits), index_mask);
+        const __m256i e = _mm256_sub_epi64(_mm256_xor_si256(_mm256_srli_epi64(tmp, 52), sign_bit), sign_bit);
+        const __m256d z = _mm256_castsi256_pd(_mm256_sub_epi64(ix, _mm256_slli_epi64(e, 52)));
+        const __m256d ed = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(e, magic_bits)), magic);
+        const __m256d invc = _mm256_i64gather_pd(t.invc, i, 8);
+        const __m256d logc_hi = _mm256_i64gather_pd(t.logc_hi, i, 8);
+        const __m256d logc_lo = _mm256_i64gather_pd(t.logc_lo, i, 8);
+
+        // r = z / c - 1 exactly as r_hi + r_lo
+        const __m256d product = _mm256_mul_pd(z, invc);
+        const __m256d r_lo = _mm256_fmsub_pd(z, invc, product);
+        const __m256d r = _mm256_sub_pd(product, one);
+        __m256d poly = _mm256_set1_pd(log1p_coefficients[std::size(log1p_coefficients) - 1]);
+        for (std::size_t c = std::size(log1p_coefficients) - 1; c-- > 0;) {
+            poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(log1p_coefficients[c]));
+        }
+        const __m256d r2 = _mm256_mul_pd(r, r);
+        const __m256d tail = _mm256_mul_pd(_mm256_mul_pd(r2, r), poly);
+        const __m256d half_r = _mm256_mul_pd(_mm256_set1_pd(-0.5), r);
+        const __m256d square_hi = _mm256_mul_pd(half_r, r);
+        const __m256d square_lo = _mm256_fmsub_pd(half_r, r, square_hi);
+
+        // log(x) as a double-double l_hi + l_lo
+        __m256d sum;
+        __m256d error1;
+        __m256d error2;
+        __m256d error3;
+        two_sum(_mm256_mul_pd(ed, _mm256_set1_pd(t.ln2_hi)), logc_hi, sum, error1);
+        two_sum(sum, r, sum, error2);
+        two_sum(sum, square_hi, sum, error3);
+        __m256d low = _mm256_add_pd(_mm256_add_pd(error1, error2), error3);
+        low = _mm256_fmadd_pd(ed, _mm256_set1_pd(t.ln2_lo), low);
+        low = _mm256_add_pd(low, logc_lo);
+        low = _mm256_add_pd(low, _mm256_fnmadd_pd(r, r_lo, r_lo));
+        low = _mm256_add_pd(low, square_lo);
+        low = _mm256_add_pd(low, tail);
+        const __m256d l_hi = _mm256_add_pd(sum, low);
+        const __m256d l_lo = _mm256_add_pd(_mm256_sub_pd(sum, l_hi), low);
+
+        // y log(x) = s_hi + s_lo
+        const __m256d s_hi = _mm256_mul_pd(y, l_hi);
+        const __m256d s_lo = _mm256_fmadd_pd(y, l_lo, _mm256_fmsub_pd(y, l_hi, s_hi));
+
+        // exp(s) = 2^(m / 128) exp(s - m ln2 / 128)
+        const __m256d shifted = _mm256_fmadd_pd(s_hi, _mm256_set1_pd(table_size / ln2_hi), magic);
+        const __m256i m = _mm256_castpd_si256(shifted);
+        const __m256d md = _mm256_sub_pd(shifted, magic);
+        __m256d s = _mm256_fnmadd_pd(md, _mm256_set1_pd(t.ln2_128_hi), s_hi);
+        s = _mm256_add_pd(_mm256_fnmadd_pd(md, _mm256_set1_pd(t.ln2_128_lo), s), s_lo);
+        __m256d q = _mm256_set1_pd(expm1_coefficients[std::size(expm1_coefficients) - 1]);
+        for (std::size_t c = std::size(expm1_coefficients) - 1; c-- > 0;) {
+            q = _mm256_fmadd_pd(q, s, _mm256_set1_pd(expm1_coefficients[c]));
+        }
+        const __m256d p = _mm256_fmadd_pd(_mm256_mul_pd(s, s), q, s);
+        const __m256i j = _mm256_and_si256(m, index_mask);
+        const __m256d exp_hi = _mm256_i64gather_pd(t.exp_hi, j, 8);
+        const __m256d exp_lo = _mm256_i64gather_pd(t.exp_lo, j, 8);
+        const __m256d scaled = _mm256_add_pd(exp_hi, _mm256_fmadd_pd(exp_hi, p, _mm256_fmadd_pd(exp_lo, p, exp_lo)));
+        const __m256i scale = _mm256_slli_epi64(_mm256_sub_epi64(m, j), 52 - table_bits);
+        const __m256d res = _mm256_castsi256_pd(_mm256_add_epi64(_mm256_castpd_si256(scaled), scale));
+
+        // bases which aren't positive normal numbers, results which may not be normal
+        const __m256d normal = _mm256_and_pd(_mm256_cmp_pd(x, _mm256_set1_pd(DBL_MIN), _CMP_GE_OQ), _mm256_cmp_pd(x, _mm256_set1_pd(DBL_MAX), _CMP_LE_OQ));
+        const __m256d in_range = _mm256_cmp_pd(_mm256_andnot_pd(_mm256_set1_pd(-0.0), s_hi), _mm256_set1_pd(708), _CMP_LE_OQ);
+        const int slow = ~_mm256_movemask_pd(_mm256_and_pd(normal, in_range)) & 0xF;
+        double bases[4];
+        if (slow != 0) {
+            _mm256_storeu_pd(bases, x);
+        }
+        _mm256_storeu_pd(data, res);
+        for (int lane = 0; slow != 0 && lane < 4; ++lane) {
+            if ((slow >> lane) & 1) {
+                data[lane] = std::pow(bases[lane], exponent);
+            }
+        }
+        if (count < 4) {
+            std::copy(lanes, lanes + count, values + k);
+        }
+    }
+}
+
+} // anonymous namespace
+#endif
+
+void sqrt_lanes(double * values, const std::size_t n)
+{
+#if defined(__x86_64__)
+    if (has_avx2_fma()) {
+        sqrt_avx2(values, n);
+        return;
+    }
+#endif
+    for (std::size_t k = 0; k < n; ++k) {
+        if (values[k] > 0) {
+            values[k] = std::sqrt(values[k]);
+        }
+    }
+}
+
+bool fmod_lanes(double * values, const std::size_t n, const double divisor)
+{
+    if (divisor == 0) {
+        return false;
+    }
+#if defined(__x86_64__)
+    // NaN and infinite divisors are rare enough to leave to std::fmod
+    if (has_avx2_fma() && std::isfinite(divisor)) {
+        fmod_avx2(values, n, divisor);
+        return true;
+    }
+#endif
+    for (std::size_t k = 0; k < n; ++k) {
+        values[k] = std::fmod(values[k], divisor);
+    }
+    return true;
+}
+
+void pow_lanes(double * values, const std::size_t n, const double exponent)
+{
+    // pow(x, 1) is x and pow(x, 0) is 1 for any x, even NaN
+    if (exponent == 1) {
+        return;
+    }
+#if defined(__x86_64__)
+    if (has_avx2_fma() && exponent != 0 && std::isfinite(exponent)) {
+        pow_avx2(values, n, exponent);
+        return;
+    }
+#endif
+    for (std::size_t k = 0; k < n; ++k) {
+        values[k] = std::pow(values[k], exponent);
+    }
+}
+
+} // namespace calc
@@ -0,0 +1,128 @@
+#include "wal.h"
+
+#include "lz4.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace calc {
+
+namespace {
+
+std::uint32_t read_le(const unsigned char * p, const int bytes)
+{
+    std::uint32_t value = 0;
+    for (int k = bytes - 1; k >= 0; --k) {
+        value = (value << 8) | p[k];
+    }
+    return value;
+}
+
+void write_le(std::string & out, const std::uint32_t value, const int bytes)
+{
+    for (int k = 0; k < bytes; ++k) {
+        out += static_cast<char>((value >> (8 * k)) & 0xFF);
+    }
+}
+
+bool read_all(const int fd, std::vector<unsigned char> & content)
+{
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        return false;
+    }
+    content.resize(static_cast<std::size_t>(info.st_size));
+    for (std::size_t done = 0; done < content.size();) {
+        const auto n = pread(fd, content.data() + done, content.size() - done, static_cast<off_t>(done));
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        done += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+CommandLog::~CommandLog()
+{
+    if (m_fd >= 0) {
+        commit();
+        close(m_fd);
+    }
+}
+
+bool CommandLog::open(const std::string & path, const std::function<void(std::string_view, std::string_view)> & apply)
+{
+    m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    std::vector<unsigned char> content;
+    if (m_fd < 0 || !read_all(m_fd, content)) {
+        std::cerr << "Can't open command log " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    std::size_t pos = 0;
+    while (content.size() - pos >= 8) {
+        const auto size = read_le(&content[pos], 4);
+        const auto checksum = read_le(&content[pos + 4], 4);
+        if (size < 2 || content.size() - pos - 8 < size || xxh32(&content[pos + 8], size) != checksum) {
+            break;
+        }
+        const auto * payload = reinterpret_cast<const char *>(&content[pos + 8]);
+        const auto name_size = read_le(&content[pos + 8], 2);
+        if (name_size > size - 2) {
+            break;
+        }
+        apply(std::string_view(payload + 2, name_size), std::string_view(payload + 2 + name_size, size - 2 - name_size));
+        pos += 8 + size;
+    }
+    if (pos != content.size()) {
+        std::cerr << "Command log " << path << ": dropped " << content.size() - pos << " bytes of a torn tail" << std::endl;
+        if (ftruncate(m_fd, static_cast<off_t>(pos)) != 0 || fdatasync(m_fd) != 0) {
+            std::cerr << "Can't truncate command log " << path << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+void CommandLog::append(const std::string_view session, const std::string_view line)
+{
+    std::string payload;
+    write_le(payload, static_cast<std::uint32_t>(session.size()), 2);
+    payload += session;
+    payload += line;
+    write_le(m_buffer, static_cast<std::uint32_t>(payload.size()), 4);
+    write_le(m_buffer, xxh32(payload.data(), payload.size()), 4);
+    m_buffer += payload;
+}
+
+bool CommandLog::commit()
+{
+    if (m_buffer.empty()) {
+        return true;
+    }
+    for (std::size_t done = 0; done < m_buffer.size();) {
+        const auto n = write(m_fd, m_buffer.data() + done, m_buffer.size() - done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        done += static_cast<std::size_t>(n);
+    }
+    m_buffer.clear();
+    ++m_commits;
+    return fdatasync(m_fd) == 0;
+}
+
+} // namespace calc
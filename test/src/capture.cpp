@@ -0,0 +1,86 @@
+#include "capture.h"
+#include "line_reader.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+TEST(Capture, round_trip)
+{
+    const auto path = testing::TempDir() + "calc_fold_capture_test";
+    {
+        calc::Capture capture;
+        ASSERT_TRUE(capture.open(path));
+        capture.add("+ 1\n\n(+) 1");
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        capture.add("\t2\n");
+        capture.add("- 3");
+        ASSERT_TRUE(capture.close());
+    }
+    std::vector<calc::CapturedLine> lines;
+    ASSERT_TRUE(calc::load_capture(path, lines));
+    ASSERT_EQ(4u, lines.size());
+    EXPECT_EQ("+ 1", lines[0].line);
+    EXPECT_EQ("", lines[1].line);
+    EXPECT_EQ("(+) 1\t2", lines[2].line);
+    EXPECT_EQ("- 3", lines[3].line);
+    EXPECT_EQ(lines[0].time, lines[1].time);
+    EXPECT_GE(lines[2].time - lines[1].time, 5000000u);
+
+    // the last record is cut off
+    std::ostringstream buffer;
+    buffer << std::ifstream(path, std::ios::binary).rdbuf();
+    const std::string content = buffer.str();
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << content.substr(0, content.size() - 1);
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(calc::load_capture(path, lines));
+    EXPECT_NE(std::string::npos, testing::internal::GetCapturedStderr().find("truncated capture record"));
+    std::remove(path.c_str());
+}
+
+TEST(Capture, line_reader)
+{
+    const auto path = testing::TempDir() + "calc_fold_capture_reader_test";
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    std::thread writer([&] {
+        const std::string first = "+ 1\n+ 2\n* ";
+        const std::string second = "3\n";
+        EXPECT_EQ(static_cast<ssize_t>(first.size()), write(fds[1], first.data(), first.size()));
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        EXPECT_EQ(static_cast<ssize_t>(second.size()), write(fds[1], second.data(), second.size()));
+        close(fds[1]);
+    });
+    std::vector<std::string> read;
+    {
+        calc::Capture capture;
+        ASSERT_TRUE(capture.open(path));
+        calc::LineReader input(fds[0]);
+        input.capture(&capture);
+        for (std::string line; input.getline(line);) {
+            read.push_back(line);
+        }
+        EXPECT_TRUE(capture.close());
+    }
+    writer.join();
+    close(fds[0]);
+    std::vector<calc::CapturedLine> lines;
+    ASSERT_TRUE(calc::load_capture(path, lines));
+    ASSERT_EQ(3u, lines.size());
+    for (std::size_t k = 0; k < lines.size(); ++k) {
+        EXPECT_EQ(read[k], lines[k].line);
+    }
+    EXPECT_EQ("* 3", lines[2].line);
+    // a line arrives with its end
+    EXPECT_LT(lines[1].time - lines[0].time, 10000000u);
+    EXPECT_GE(lines[2].time - lines[1].time, 20000000u);
+    std::remove(path.c_str());
+}
@@ -0,0 +1,118 @@
+#include "datagram.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+sockaddr_un address_of(const std::string & path)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+    return address;
+}
+
+// a datagram socket bound to its own path and connected to the server
+class Client
+{
+public:
+    Client(const std::string & path, const std::string & server)
+        : m_path(path)
+    {
+        m_fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+        std::remove(path.c_str());
+        const auto own = address_of(path);
+        const auto other = address_of(server);
+        EXPECT_EQ(0, bind(m_fd, reinterpret_cast<const sockaddr *>(&own), sizeof(own)));
+        EXPECT_EQ(0, connect(m_fd, reinterpret_cast<const sockaddr *>(&other), sizeof(other)));
+    }
+    ~Client()
+    {
+        close(m_fd);
+        std::remove(m_path.c_str());
+    }
+
+    void send(const std::string & datagram) const
+    {
+        EXPECT_EQ(static_cast<ssize_t>(datagram.size()), ::send(m_fd, datagram.data(), datagram.size(), 0));
+    }
+    std::string receive() const
+    {
+        char buffer[8192];
+        const auto n = recv(m_fd, buffer, sizeof(buffer), 0);
+        return n < 0 ? "recv failed" : std::string(buffer, static_cast<std::size_t>(n));
+    }
+    std::string ask(const std::string & datagram) const
+    {
+        send(datagram);
+        return receive();
+    }
+
+private:
+    std::string m_path;
+    int m_fd;
+};
+
+} // anonymous namespace
+
+TEST(DatagramServer, sessions)
+{
+    calc::DatagramConfig config;
+    config.socket_path = testing::TempDir() + "calc_fold_datagram_test.sock";
+    config.max_datagram = 64;
+    calc::DatagramServer server(config);
+    ASSERT_TRUE(server.open());
+    std::thread serving([&] { EXPECT_TRUE(server.run()); });
+    {
+        const Client client(testing::TempDir() + "calc_fold_datagram_client.sock", config.socket_path);
+        EXPECT_EQ("5\n10\n", client.ask("+ 5\n* 2\n"));
+        EXPECT_EQ("1\n", client.ask("@session b\n+ 1"));
+        // a block spans datagrams, nothing to answer until it's closed
+        EXPECT_EQ("", client.ask("(+) {\n1 2"));
+        EXPECT_EQ("16\n", client.ask("3\n}"));
+        EXPECT_EQ("@error\n", client.ask(std::string(100, '1')));
+        // a switch on any line, a bad name ends the datagram
+        EXPECT_EQ("17\n2\n", client.ask("+ 1\n@session b\n+ 1"));
+        EXPECT_EQ("3\n@error\n", client.ask("@session b\n+ 1\n@session a\tb\n+ 1"));
+        EXPECT_EQ("@error\n", client.ask("@session"));
+    }
+    server.stop();
+    serving.join();
+    EXPECT_EQ(17, server.current("default"));
+    EXPECT_EQ(3, server.current("b"));
+    EXPECT_EQ(8U, server.datagrams());
+}
+
+TEST(DatagramServer, batches)
+{
+    calc::DatagramConfig config;
+    config.socket_path = testing::TempDir() + "calc_fold_batch_test.sock";
+    calc::DatagramServer server(config);
+    ASSERT_TRUE(server.open());
+    const Client client(testing::TempDir() + "calc_fold_batch_client.sock", config.socket_path);
+    // queued before the server runs (net.unix.max_dgram_qlen is at least 10), so one call gets them all
+    for (int k = 0; k < 10; ++k) {
+        client.send("+ 1");
+    }
+    std::thread serving([&] { EXPECT_TRUE(server.run()); });
+    for (int k = 1; k <= 10; ++k) {
+        EXPECT_EQ(std::to_string(k) + "\n", client.receive());
+    }
+    // and the ones sent while it runs are all answered in order
+    for (int k = 11; k <= 1000; ++k) {
+        EXPECT_EQ(std::to_string(k) + "\n", client.ask("+ 1"));
+    }
+    server.stop();
+    serving.join();
+    EXPECT_EQ(1000U, server.datagrams());
+    EXPECT_LE(server.batches(), 991U);
+    EXPECT_EQ(0U, server.dropped());
+}
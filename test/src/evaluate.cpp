@@ -0,0 +1,75 @@
+#include "evaluate.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+calc::Task collect(calc::AsyncGenerator<double> & values, std::vector<double> & res)
+{
+    while (const auto value = co_await values.next()) {
+        res.push_back(*value);
+    }
+}
+
+} // anonymous namespace
+
+TEST(Evaluate, lines)
+{
+    const std::vector<std::string> lines = {"5", "+ 2", "(*) {", "2", "3", "}", "= x / 4"};
+    std::vector<double> res;
+    for (const double value : calc::evaluate(lines)) {
+        res.push_back(value);
+    }
+    EXPECT_EQ((std::vector<double>{5, 7, 42, 10.5}), res);
+}
+
+TEST(Evaluate, lazy)
+{
+    std::istringstream in("1\n+ 1\n+ 1\n");
+    auto values = calc::evaluate(in);
+    auto it = values.begin();
+    EXPECT_DOUBLE_EQ(1, *it);
+    // only the first line is read so far
+    std::string rest;
+    std::getline(in, rest);
+    EXPECT_EQ("+ 1", rest);
+    ++it;
+    EXPECT_DOUBLE_EQ(2, *it);
+    ++it;
+    EXPECT_TRUE(it == values.end());
+}
+
+TEST(Evaluate, unterminated_block)
+{
+    std::vector<double> res;
+    testing::internal::CaptureStderr();
+    for (const double value : calc::evaluate(std::vector<std::string>{"3", "(+) {", "1"})) {
+        res.push_back(value);
+    }
+    EXPECT_EQ("Unterminated fold block\n", testing::internal::GetCapturedStderr());
+    EXPECT_EQ((std::vector<double>{3}), res);
+}
+
+TEST(Evaluate, async)
+{
+    calc::LineChannel channel;
+    auto values = calc::evaluate(channel);
+    std::vector<double> res;
+    const auto consumer = collect(values, res);
+    EXPECT_TRUE(res.empty());
+    channel.push("4");
+    EXPECT_EQ((std::vector<double>{4}), res);
+    channel.push("(^) {");
+    channel.push("2");
+    EXPECT_EQ((std::vector<double>{4}), res);
+    channel.push("}");
+    channel.push("_");
+    EXPECT_EQ((std::vector<double>{4, 16, -16}), res);
+    EXPECT_FALSE(consumer.done());
+    channel.close();
+    EXPECT_TRUE(consumer.done());
+}
@@ -0,0 +1,54 @@
+#include "executor.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <numeric>
+#include <vector>
+
+TEST(Executor, parse_cpu_max)
+{
+    EXPECT_EQ(0, calc::parse_cpu_max("max 100000\n"));
+    EXPECT_EQ(2, calc::parse_cpu_max("200000 100000\n"));
+    EXPECT_EQ(2, calc::parse_cpu_max("150000 100000\n"));
+    EXPECT_EQ(1, calc::parse_cpu_max("50000 100000"));
+    EXPECT_EQ(0, calc::parse_cpu_max(""));
+    EXPECT_LE(1, calc::default_concurrency());
+}
+
+TEST(Executor, parallel_for)
+{
+    calc::WorkStealingExecutor executor({4, true});
+    EXPECT_EQ(4, executor.concurrency());
+    std::vector<int> values(10007);
+    calc::parallel_for(executor, values.size(), 100, [&values](const std::size_t begin, const std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            values[i] += static_cast<int>(i);
+        }
+    });
+    std::vector<int> expected(values.size());
+    std::iota(expected.begin(), expected.end(), 0);
+    EXPECT_EQ(expected, values);
+}
+
+TEST(Executor, nested)
+{
+    calc::WorkStealingExecutor executor({2, false});
+    std::atomic<std::size_t> count{0};
+    calc::parallel_for(executor, 8, 1, [&](std::size_t, std::size_t) {
+        calc::parallel_for(executor, 100, 10, [&](const std::size_t begin, const std::size_t end) {
+            count += end - begin;
+        });
+    });
+    EXPECT_EQ(800, count);
+}
+
+TEST(Executor, replace_global)
+{
+    const auto own = std::make_shared<calc::WorkStealingExecutor>(calc::ExecutorConfig{1, false});
+    const auto old = calc::executor();
+    calc::set_executor(own);
+    EXPECT_EQ(own, calc::executor());
+    calc::set_executor(old);
+    EXPECT_EQ(old, calc::executor());
+}
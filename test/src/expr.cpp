@@ -0,0 +1,102 @@
+#include "calc.h"
+#include "expr.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <string>
+
+namespace {
+
+double eval(const char * text, const double x)
+{
+    calc::Program program;
+    double res = 0;
+    EXPECT_TRUE(program.compile(text));
+    EXPECT_TRUE(program.run(x, res));
+    return res;
+}
+
+} // anonymous namespace
+
+TEST(Expr, precedence)
+{
+    EXPECT_DOUBLE_EQ(13.5, eval("x*1.05 + 3", 10));
+    EXPECT_DOUBLE_EQ(14, eval("2 + 3 * 4", 0));
+    EXPECT_DOUBLE_EQ(20, eval("(2 + 3) * 4", 0));
+    EXPECT_DOUBLE_EQ(2, eval("10 - 5 - 3", 0));
+    EXPECT_DOUBLE_EQ(1, eval("12 / 3 / 4", 0));
+    EXPECT_DOUBLE_EQ(2, eval("17 % 5", 0));
+    EXPECT_DOUBLE_EQ(512, eval("2 ^ 3 ^ 2", 0));
+    EXPECT_DOUBLE_EQ(-9, eval("-x ^ 2", 3));
+    EXPECT_DOUBLE_EQ(-6, eval("-x * 2", 3));
+    EXPECT_DOUBLE_EQ(0.5, eval("2 ^ -1", 0));
+    EXPECT_DOUBLE_EQ(5, eval("sqrt(x * x + 16)", 3));
+    EXPECT_DOUBLE_EQ(1.5e-3, eval("\t1.5e-3 ", 0));
+}
+
+TEST(Expr, bytecode)
+{
+    using Code = calc::Program::Code;
+    calc::Program program;
+    ASSERT_TRUE(program.compile("-(x - 1) ^ 2"));
+    const std::vector<Code> expected = {Code::X, Code::CONST, Code::SUB, Code::CONST, Code::POW, Code::NEG};
+    EXPECT_EQ(expected, program.code());
+}
+
+TEST(Expr, err)
+{
+    calc::Program program;
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(program.compile("x +"));
+    EXPECT_EQ("Expression parsing error at 3: ''\n", testing::internal::GetCapturedStderr());
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(program.compile("(x + 1"));
+    EXPECT_EQ("Expression parsing error at 6: ''\n", testing::internal::GetCapturedStderr());
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(program.compile("2 y"));
+    EXPECT_EQ("Expression parsing error at 2: 'y'\n", testing::internal::GetCapturedStderr());
+    double res = 0;
+    EXPECT_FALSE(program.run(1, res));
+
+    ASSERT_TRUE(program.compile("1 / (x - 1)"));
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(program.run(1, res));
+    EXPECT_EQ("Bad right argument for division: 0\n", testing::internal::GetCapturedStderr());
+    ASSERT_TRUE(program.compile("sqrt(x)"));
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(program.run(-4, res));
+    EXPECT_EQ("Bad argument for SQRT: -4\n", testing::internal::GetCapturedStderr());
+}
+
+TEST(Expr, nesting)
+{
+    const auto nested = [](const std::size_t depth) { return std::string(depth, '(') + "x" + std::string(depth, ')'); };
+    EXPECT_EQ(2, eval(nested(200).c_str(), 2));
+    EXPECT_EQ(-2, eval((std::string(199, '-') + "x").c_str(), 2));
+    calc::Program program;
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(program.compile(nested(1000000)));
+    EXPECT_EQ("Expression is nested deeper than 256 at 256\n", testing::internal::GetCapturedStderr());
+    testing::internal::CaptureStderr();
+    std::string power = "x";
+    for (int k = 0; k < 100000; ++k) {
+        power += "^x";
+    }
+    EXPECT_FALSE(program.compile(power));
+    EXPECT_EQ("Expression is nested deeper than 256 at 512\n", testing::internal::GetCapturedStderr());
+}
+
+TEST(Expr, process_line)
+{
+    calc::Context context;
+    EXPECT_DOUBLE_EQ(13.5, process_line(10, "= x*1.05 + 3", {}, context));
+    EXPECT_DOUBLE_EQ(17.175, process_line(13.5, "= x*1.05 + 3", {}, context));
+    EXPECT_DOUBLE_EQ(13.5, process_line(10, "=x*1.05+3"));
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(7, process_line(7, "= x % 0", {}, context));
+    EXPECT_EQ("Bad right argument for remainder: 0\n", testing::internal::GetCapturedStderr());
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(7, process_line(7, "= x *", {}, context));
+    EXPECT_EQ("Expression parsing error at 4: ''\n", testing::internal::GetCapturedStderr());
+}
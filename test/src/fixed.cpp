@@ -0,0 +1,53 @@
+#include "calc.h"
+#include "fixed.h"
+
+#include <gtest/gtest.h>
+
+#include <limits>
+
+TEST(Fixed, conversions)
+{
+    calc::Fixed value;
+    ASSERT_TRUE(calc::to_fixed(0.1, value));
+    EXPECT_TRUE(value == 1000000000);
+    ASSERT_TRUE(calc::to_fixed(-12345.6789, value));
+    EXPECT_TRUE(value == -123456789000000);
+    ASSERT_TRUE(calc::to_fixed(2e-10, value));
+    EXPECT_TRUE(value == 2);
+    // the digits below 10^-10 don't fit
+    EXPECT_FALSE(calc::to_fixed(1e-11, value));
+    EXPECT_FALSE(calc::to_fixed(2.5e-10, value));
+    EXPECT_FALSE(calc::to_fixed(0.1 + 0.2, value));
+    ASSERT_TRUE(calc::to_fixed(1e20, value));
+    EXPECT_EQ(1e20, calc::to_double(value));
+    EXPECT_FALSE(calc::to_fixed(std::numeric_limits<double>::infinity(), value));
+    EXPECT_FALSE(calc::to_fixed(1e30, value));
+    for (const double x : {0.0, 0.3, -0.7, 1234567890.0, 0.0000000001, 98765.4321}) {
+        ASSERT_TRUE(calc::to_fixed(x, value));
+        EXPECT_EQ(x, calc::to_double(value));
+    }
+}
+
+TEST(Fixed, process_line)
+{
+    calc::Options options;
+    options.fixed_point = true;
+    EXPECT_EQ(0.3, process_line(0, "(+) 0.1 0.2", options));
+    EXPECT_NE(0.3, process_line(0, "(+) 0.1 0.2"));
+    EXPECT_EQ(0, process_line(0.3, "(-) 0.1 0.1 0.1", options));
+    EXPECT_EQ(34579.8345, process_line(0, "(+) 1 2 34567.8345 9", options));
+    EXPECT_EQ(119.988, process_line(1, "(*) 15 2.4 3.333", options));
+    EXPECT_EQ(0.0000000001, process_line(0.00001, "(*) .00001", options));
+    // 0.5 * 1e-10 rounds half to even
+    EXPECT_EQ(0, process_line(0.0000000001, "(*) 0.5", options));
+    EXPECT_EQ(0.0000000002, process_line(0.0000000003, "(*) 0.5", options));
+    // beyond the fixed-point range the usual evaluation takes over
+    EXPECT_DOUBLE_EQ(1e300, process_line(1e299, "(*) 10", options));
+    // and so it does for a register with digits below 10^-10
+    const double tiny = 1.0 / 1000000000 / 1000000000 * 7.7;
+    EXPECT_EQ(process_line(tiny, "(*) 3540903414 85257"), process_line(tiny, "(*) 3540903414 85257", options));
+    EXPECT_EQ(process_line(1e-18, "(+) 1 2"), process_line(1e-18, "(+) 1 2", options));
+    testing::internal::CaptureStderr();
+    EXPECT_EQ(7, process_line(7, "(+) 1 2 3 a", options));
+    EXPECT_EQ("Argument parsing error at 0: 'a'\n", testing::internal::GetCapturedStderr());
+}
@@ -0,0 +1,117 @@
+#include "calc.h"
+#include "huge_pages.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// VmFlags of the mapping holding the address, empty if there is none
+std::string vm_flags(const void * address)
+{
+    const auto value = reinterpret_cast<std::uintptr_t>(address);
+    std::ifstream smaps("/proc/self/smaps");
+    bool inside = false;
+    for (std::string line; std::getline(smaps, line);) {
+        std::uintptr_t begin = 0;
+        std::uintptr_t end = 0;
+        char dash = 0;
+        std::istringstream in(line);
+        if (in >> std::hex >> begin >> dash >> end && dash == '-') {
+            inside = begin <= value && value < end;
+        }
+        else if (inside && line.starts_with("VmFlags:")) {
+            return line + " ";
+        }
+    }
+    return {};
+}
+
+struct Policy
+{
+    explicit Policy(const calc::HugePages policy) { calc::set_huge_pages(policy); }
+    ~Policy() { calc::set_huge_pages(calc::HugePages::Off); }
+};
+
+} // anonymous namespace
+
+TEST(HugePages, buffer)
+{
+    for (const auto policy : {calc::HugePages::Off, calc::HugePages::Transparent, calc::HugePages::Explicit}) {
+        const Policy scope(policy);
+        calc::PageBuffer buffer(100000);
+        ASSERT_FALSE(buffer.empty());
+        EXPECT_GE(buffer.size(), 100000u);
+        std::memset(buffer.data(), 'x', buffer.size());
+        EXPECT_EQ('x', buffer.data()[buffer.size() - 1]);
+        if (policy != calc::HugePages::Off) {
+            EXPECT_EQ(calc::huge_page_size, buffer.size());
+            EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(buffer.data()) % calc::huge_page_size);
+        }
+        else {
+            EXPECT_LT(buffer.size(), calc::huge_page_size);
+            EXPECT_FALSE(buffer.explicit_pages());
+        }
+        auto moved = std::move(buffer);
+        EXPECT_TRUE(buffer.empty());
+        EXPECT_EQ('x', moved.data()[0]);
+    }
+    EXPECT_TRUE(calc::PageBuffer(0).empty());
+}
+
+TEST(HugePages, reserve)
+{
+    std::vector<double> values(3);
+    calc::reserve_huge(values, 2);
+    EXPECT_EQ(3u, values.capacity());
+    calc::reserve_huge(values, 4);
+    EXPECT_EQ(6u, values.capacity());
+    calc::reserve_huge(values, 100);
+    EXPECT_EQ(100u, values.capacity());
+    EXPECT_EQ(3u, values.size());
+}
+
+TEST(HugePages, advise)
+{
+    if (!std::filesystem::exists("/sys/kernel/mm/transparent_hugepage")) {
+        GTEST_SKIP() << "no transparent huge pages";
+    }
+    const auto advised = [](const calc::HugePages policy, const std::size_t count) {
+        const Policy scope(policy);
+        std::vector<double> values;
+        calc::reserve_huge(values, count);
+        const auto * middle = values.data() + count / 2;
+        return vm_flags(middle).find(" hg ") != std::string::npos;
+    };
+    // the advice stays with the memory after free(), so the ones which
+    // must not advise go first
+    EXPECT_FALSE(advised(calc::HugePages::Off, 4 * calc::huge_page_size / sizeof(double)));
+    // too small to have a whole huge page inside
+    EXPECT_FALSE(advised(calc::HugePages::Transparent, calc::huge_page_size / sizeof(double)));
+    EXPECT_TRUE(advised(calc::HugePages::Transparent, 4 * calc::huge_page_size / sizeof(double)));
+    EXPECT_TRUE(advised(calc::HugePages::Explicit, 4 * calc::huge_page_size / sizeof(double)));
+}
+
+TEST(HugePages, fold)
+{
+    std::string line = "(+)";
+    for (int k = 0; k < 600000; ++k) {
+        line += " ";
+        line += std::to_string(k % 1000);
+        line += ".5";
+    }
+    calc::Options options;
+    options.strict = false;
+    const auto expected = process_line(0, line, options);
+    const Policy scope(calc::HugePages::Transparent);
+    EXPECT_EQ(expected, process_line(0, line, options));
+    options.strict = true;
+    EXPECT_EQ(299700000 + 300000, process_line(0, line, options));
+}
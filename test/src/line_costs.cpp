@@ -0,0 +1,69 @@
+#include "line_costs.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+TEST(LineCosts, top)
+{
+    calc::LineCosts costs(3);
+    costs.add(1, "+ 1", false, 10);
+    costs.add(2, "(^) 1.5 2 3", false, 500);
+    costs.add(3, "(^) {", false, 20);
+    costs.add(4, "1 2 3 4", true, 300);
+    costs.add(5, "}", true, 5);
+    costs.add(6, "SQRT", false, 400);
+    costs.add(7, "= $x + 1", false, 30);
+    costs.add(8, "12", false, 1);
+    const auto top = costs.top();
+    ASSERT_EQ(3u, top.size());
+    EXPECT_EQ(2u, top[0].number);
+    EXPECT_EQ("(^)", top[0].op);
+    EXPECT_EQ(3u, top[0].operands);
+    EXPECT_EQ(11u, top[0].bytes);
+    EXPECT_EQ(500u, top[0].ticks);
+    EXPECT_EQ(6u, top[1].number);
+    EXPECT_EQ("SQRT", top[1].op);
+    EXPECT_EQ(0u, top[1].operands);
+    EXPECT_EQ(4u, top[2].number);
+    EXPECT_EQ("block", top[2].op);
+    EXPECT_EQ(4u, top[2].operands);
+}
+
+TEST(LineCosts, kinds)
+{
+    const auto op = [](const std::string & line) {
+        calc::LineCosts costs(1);
+        costs.add(1, line, false, 1);
+        return costs.top().at(0).op;
+    };
+    EXPECT_EQ("+", op("+ 1"));
+    EXPECT_EQ("_", op("_"));
+    EXPECT_EQ("set", op("12"));
+    EXPECT_EQ("set", op("$x"));
+    EXPECT_EQ("(%)", op("(%) 1 2"));
+    EXPECT_EQ("=", op("= 1 + 2"));
+    EXPECT_EQ(">", op("> x"));
+    EXPECT_EQ("empty", op(""));
+    EXPECT_EQ("error", op("(_) 1"));
+    EXPECT_EQ("error", op("SQ"));
+    EXPECT_EQ("error", op("x"));
+}
+
+TEST(LineCosts, report)
+{
+    calc::LineCosts costs(2);
+    costs.add(1, "+ 1", false, 10);
+    costs.add(2, "+ 2", false, 10);
+    costs.add(3, std::string(100, '1'), false, 40);
+    std::ostringstream out;
+    costs.report(out);
+    const auto text = out.str();
+    EXPECT_NE(std::string::npos, text.find("Line costs: 3 lines"));
+    EXPECT_NE(std::string::npos, text.find("top 2 lines:"));
+    // the long line is cut
+    EXPECT_NE(std::string::npos, text.find(std::string(calc::LineCosts::text_size, '1') + "...\n"));
+    // '+' lines come after the more expensive 'set' one
+    EXPECT_LT(text.find("  set "), text.find("  +  "));
+}
@@ -0,0 +1,148 @@
+#include "line_reader.h"
+#include "lz4.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// decompresses the frames, handing them to the decoder a few bytes at a time
+std::string decompress(const std::string & frames, std::string * error = nullptr)
+{
+    std::size_t pos = 0;
+    std::mt19937 random(3);
+    calc::Lz4FrameReader reader([&](char * data, const std::size_t size) {
+        const auto n = std::min({size, frames.size() - pos, std::size_t{1} + random() % 7});
+        std::copy_n(frames.data() + pos, n, data);
+        pos += n;
+        return n;
+    });
+    std::string res;
+    for (auto chunk = reader.next(); !chunk.empty(); chunk = reader.next()) {
+        res += chunk;
+    }
+    if (error != nullptr) {
+        *error = reader.error();
+    }
+    else {
+        EXPECT_EQ("", reader.error());
+    }
+    return res;
+}
+
+std::string script(const std::size_t lines)
+{
+    std::mt19937_64 random(5);
+    const char * ops[] = {"+ ", "- ", "* ", "/ ", "(+) ", "(*) "};
+    std::string res;
+    for (std::size_t n = 0; n < lines; ++n) {
+        res += ops[random() % 6];
+        res += std::to_string(random() % 1000) + "." + std::to_string(random() % 100) + "\n";
+    }
+    return res;
+}
+
+} // anonymous namespace
+
+TEST(Lz4, xxh32)
+{
+    EXPECT_EQ(0x02CC5D05U, calc::xxh32("", 0));
+    EXPECT_EQ(0x550D7456U, calc::xxh32("a", 1));
+    EXPECT_EQ(0x32D153FFU, calc::xxh32("abc", 3));
+    const auto text = script(100);
+    calc::Xxh32 hash;
+    for (std::size_t begin = 0, step = 1; begin < text.size(); begin += step, step = step * 3 % 37 + 1) {
+        hash.update(text.data() + begin, std::min(step, text.size() - begin));
+    }
+    EXPECT_EQ(calc::xxh32(text.data(), text.size()), hash.digest());
+}
+
+TEST(Lz4, frames)
+{
+    // the frame the reference lz4 tool writes for no data
+    const std::string empty("\x04\x22\x4d\x18\x64\x40\xa7\x00\x00\x00\x00\x05\x5d\xcc\x02", 15);
+    EXPECT_EQ("", decompress(empty));
+    EXPECT_EQ(empty, calc::lz4_compress(""));
+
+    const auto text = script(20000);
+    const auto frame = calc::lz4_compress(text);
+    EXPECT_LT(frame.size(), text.size());
+    EXPECT_EQ(text, decompress(frame));
+    // concatenated and skippable frames
+    const std::string skippable("\x5a\x2a\x4d\x18\x03\x00\x00\x00xyz", 11);
+    EXPECT_EQ(text + "abc" + text, decompress(frame + skippable + calc::lz4_compress("abc") + frame));
+
+    std::mt19937_64 random(9);
+    std::string noise(200000, '\0');
+    for (auto & c : noise) {
+        c = static_cast<char>(random());
+    }
+    EXPECT_EQ(noise, decompress(calc::lz4_compress(noise)));
+}
+
+TEST(Lz4, linked_blocks)
+{
+    std::string frame("\x04\x22\x4d\x18\x40\x40", 6);
+    frame += static_cast<char>((calc::xxh32("\x40\x40", 2) >> 8) & 0xFF);
+    // a stored block, then one which copies it from the previous block
+    frame += std::string("\x08\x00\x00\x80", 4) + "abcdefgh";
+    frame += std::string("\x05\x00\x00\x00\x04\x08\x00\x10", 8) + "Z";
+    frame += std::string(4, '\0');
+    EXPECT_EQ("abcdefghabcdefghZ", decompress(frame));
+}
+
+TEST(Lz4, err)
+{
+    const auto frame = calc::lz4_compress(script(100));
+    std::string error;
+    auto corrupted = frame;
+    corrupted[corrupted.size() - 1] ^= 1;
+    decompress(corrupted, &error);
+    EXPECT_EQ("content checksum mismatch", error);
+    decompress(frame.substr(0, frame.size() / 2), &error);
+    EXPECT_EQ("truncated block", error);
+    corrupted = frame;
+    corrupted[6] ^= 1;
+    decompress(corrupted, &error);
+    EXPECT_EQ("frame header checksum mismatch", error);
+    decompress(frame + "junk", &error);
+    EXPECT_EQ("unknown frame magic number", error);
+    // damaged blocks are rejected, not decoded out of bounds
+    std::mt19937 random(11);
+    for (int k = 0; k < 300; ++k) {
+        corrupted = frame;
+        corrupted[7 + random() % (corrupted.size() - 7)] ^= static_cast<char>(1 + random() % 255);
+        decompress(corrupted, &error);
+        EXPECT_NE("", error);
+    }
+}
+
+TEST(Lz4, line_reader)
+{
+    const std::string path = testing::TempDir() + "calc_fold_lz4_test";
+    const auto text = script(5000) + "\n+ 1";
+    for (const bool compress : {false, true}) {
+        std::ofstream(path, std::ios::binary) << (compress ? calc::lz4_compress(text) : text);
+        const int fd = open(path.c_str(), O_RDONLY);
+        ASSERT_GE(fd, 0);
+        calc::LineReader reader(fd);
+        EXPECT_EQ(compress, reader.compressed());
+        std::string expected;
+        std::size_t lines = 0;
+        for (std::string line; reader.getline(line); ++lines) {
+            expected += line + "\n";
+        }
+        close(fd);
+        EXPECT_EQ(5002, lines);
+        EXPECT_EQ(text + "\n", expected);
+        EXPECT_EQ("", reader.error());
+    }
+    std::remove(path.c_str());
+}
@@ -0,0 +1,102 @@
+#include "calc.h"
+#include "number.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+namespace {
+
+void expect_parsed(const std::string & text)
+{
+    std::size_t i = 0;
+    double value = 0;
+    ASSERT_TRUE(calc::parse_decimal(text, i, value)) << text;
+    EXPECT_EQ(text.size(), i) << text;
+    const double expected = std::strtod(text.c_str(), nullptr);
+    EXPECT_EQ(0, std::memcmp(&expected, &value, sizeof(value))) << text << ": " << value << " vs " << expected;
+}
+
+} // anonymous namespace
+
+TEST(Number, parse_decimal)
+{
+    for (const char * text : {"0", "-0", "+1", "1.5", "-.5", "5.", "123456789012345678901234567890",
+                              "0.000000000000000000000000000001", "1e308", "1.8e308", "2e-308", "4.9e-324", "2.4e-324",
+                              "2.5e-324", "1e-400", "1e400", "9007199254740993", "9007199254740992.5",
+                              "1.00000000000000011102230246251565404236316680908203125",
+                              "1.00000000000000011102230246251565404236316680908203124",
+                              "1.00000000000000011102230246251565404236316680908203126",
+                              "2.2250738585072011e-308", "2.2250738585072014e-308", "7.1e-10", "3.14159E+2", "1e-5"}) {
+        expect_parsed(text);
+    }
+    std::mt19937_64 random(7);
+    for (int n = 0; n < 100000; ++n) {
+        std::string text = random() % 2 != 0 ? "-" : "";
+        const auto digits = 1 + random() % 25;
+        const auto dot = random() % (digits + 1);
+        for (std::size_t k = 0; k < digits; ++k) {
+            if (k == dot) {
+                text += '.';
+            }
+            text += static_cast<char>('0' + random() % 10);
+        }
+        if (random() % 2 != 0) {
+            text += 'e' + std::to_string(static_cast<int>(random() % 700) - 350);
+        }
+        expect_parsed(text);
+    }
+}
+
+TEST(Number, parse_decimal_stops)
+{
+    std::size_t i = 0;
+    double value = 0;
+    EXPECT_FALSE(calc::parse_decimal("-.e5", i, value));
+    EXPECT_EQ(0, i);
+    EXPECT_TRUE(calc::parse_decimal("12e+", i, value));
+    EXPECT_EQ(2, i);
+    EXPECT_EQ(12, value);
+    i = 0;
+    EXPECT_TRUE(calc::parse_decimal("1.2.3", i, value));
+    EXPECT_EQ(3, i);
+}
+
+TEST(Number, full_numbers)
+{
+    calc::Options options;
+    options.full_numbers = true;
+    EXPECT_EQ(12345678900000, process_line(1, "12345678900000", options));
+    EXPECT_EQ(-4, process_line(1, "+ -5", options));
+    EXPECT_EQ(6, process_line(1, "- -5", options));
+    EXPECT_EQ(1.5e20, process_line(1, "* 1.5e20", options));
+    EXPECT_EQ(0.1 + 0.2 + 3e-5, process_line(0.1, "(+) 0.2 3e-5", options));
+    testing::internal::CaptureStderr();
+    EXPECT_EQ(99, process_line(99, "+ -", options));
+    EXPECT_EQ("Argument parsing error at 2: '-'\nNo argument for a binary operation\n", testing::internal::GetCapturedStderr());
+    testing::internal::CaptureStderr();
+    EXPECT_EQ(99, process_line(99, "+ 1.2.3e1", options));
+    EXPECT_EQ("Argument parsing error at 5: '.3e1'\n", testing::internal::GetCapturedStderr());
+    // whatever the historical format accepts keeps its value
+    EXPECT_EQ(process_line(99, "+ 1.2.3"), process_line(99, "+ 1.2.3", options));
+    EXPECT_EQ(99, process_line(99, "(+) . 0.", options));
+    testing::internal::CaptureStderr();
+    EXPECT_EQ(5, process_line(5, "(/) 1 -0", options));
+    EXPECT_EQ("Bad right argument for division: -0\n", testing::internal::GetCapturedStderr());
+    options.short_circuit = true;
+    testing::internal::CaptureStderr();
+    EXPECT_EQ(5, process_line(5, "(*) 0 1 x", options));
+    EXPECT_EQ("Argument parsing error at 0: 'x'\n", testing::internal::GetCapturedStderr());
+    // the validation pass reports a zero divisor with its sign too
+    options.short_circuit = false;
+    options.two_phase = true;
+    testing::internal::CaptureStderr();
+    EXPECT_EQ(5, process_line(5, "(/) 5 1 -0", options));
+    EXPECT_EQ("Bad right argument for division: -0\n", testing::internal::GetCapturedStderr());
+    testing::internal::CaptureStderr();
+    EXPECT_EQ(5, process_line(5, "(%) 5 1 -0.0e5", options));
+    EXPECT_EQ("Bad right argument for remainder: -0\n", testing::internal::GetCapturedStderr());
+}
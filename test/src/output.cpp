@@ -0,0 +1,184 @@
+#include "line_reader.h"
+#include "output.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace {
+
+std::vector<double> values()
+{
+    std::vector<double> res = {0, -0.0, 1, -1, 0.1, 123456, 1234567, 1e-5, 1e-4, 1.5e300, 4.9e-324, std::numeric_limits<double>::infinity(),
+                               -std::numeric_limits<double>::infinity(), std::nan(""), -std::nan("")};
+    std::mt19937_64 random(2);
+    for (int k = 0; k < 100000; ++k) {
+        double value;
+        const std::uint64_t bits = random();
+        std::memcpy(&value, &bits, sizeof(value));
+        res.push_back(value);
+        res.push_back(static_cast<double>(random() % 100000000) / 1000);
+    }
+    return res;
+}
+
+std::string expected(const std::vector<double> & values)
+{
+    std::ostringstream out;
+    for (const auto value : values) {
+        out << value << "\n";
+    }
+    return out.str();
+}
+
+} // anonymous namespace
+
+TEST(Output, file)
+{
+    const auto all = values();
+    const std::string path = testing::TempDir() + "calc_fold_output_test";
+    {
+        const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        ASSERT_GE(fd, 0);
+        calc::Output output(fd);
+        EXPECT_FALSE(output.spliced());
+        for (const auto value : all) {
+            output.write(value);
+        }
+        output.flush();
+        EXPECT_EQ("", output.error());
+        close(fd);
+    }
+    std::ifstream in(path);
+    std::stringstream content;
+    content << in.rdbuf();
+    EXPECT_EQ(expected(all), content.str());
+    std::remove(path.c_str());
+}
+
+TEST(Output, pipe)
+{
+    const auto all = values();
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    std::string received;
+    std::thread reader([&] {
+        char buffer[4096];
+        for (ssize_t n; (n = read(fds[0], buffer, sizeof(buffer))) > 0;) {
+            received.append(buffer, static_cast<std::size_t>(n));
+        }
+    });
+    {
+        calc::Output output(fds[1]);
+        EXPECT_TRUE(output.spliced());
+        for (std::size_t k = 0; k < all.size(); ++k) {
+            output.write(all[k]);
+            // what an interactive reader would cause
+            if (k % 10000 == 0) {
+                output.flush();
+            }
+        }
+        EXPECT_TRUE(output.spliced());
+    }
+    close(fds[1]);
+    reader.join();
+    close(fds[0]);
+    EXPECT_EQ(expected(all), received);
+}
+
+TEST(Output, spliced_on)
+{
+    // a reader which splices the pages on and reads them only at the end,
+    // like a relay into other pipes or a zero-copy send; enough buffers for
+    // a reused one to show
+    std::vector<double> all;
+    for (int k = 0; k < 4; ++k) {
+        const auto more = values();
+        all.insert(all.end(), more.begin(), more.end());
+    }
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    std::vector<std::array<int, 2>> relays;
+    const auto add_relay = [&relays] {
+        std::array<int, 2> next{};
+        ASSERT_EQ(0, pipe(next.data()));
+        fcntl(next[1], F_SETPIPE_SZ, 1 << 20);
+        relays.push_back(next);
+    };
+    std::thread relay([&] {
+        add_relay();
+        for (pollfd ready{fds[0], POLLIN, 0}; poll(&ready, 1, -1) > 0;) {
+            const auto n = splice(fds[0], nullptr, relays.back()[1], nullptr, 1 << 20, SPLICE_F_NONBLOCK);
+            if (n < 0 && errno == EAGAIN) {
+                // this one is full
+                add_relay();
+            }
+            else if (n <= 0) {
+                break;
+            }
+        }
+    });
+    {
+        calc::Output output(fds[1]);
+        EXPECT_TRUE(output.spliced());
+        for (const auto value : all) {
+            output.write(value);
+        }
+    }
+    close(fds[1]);
+    relay.join();
+    close(fds[0]);
+    std::string received;
+    for (const auto & [read_end, write_end] : relays) {
+        close(write_end);
+        char buffer[4096];
+        for (ssize_t n; (n = read(read_end, buffer, sizeof(buffer))) > 0;) {
+            received.append(buffer, static_cast<std::size_t>(n));
+        }
+        close(read_end);
+    }
+    EXPECT_GT(relays.size(), 1u);
+    // not EXPECT_EQ(), a diff of megabytes takes forever
+    EXPECT_TRUE(expected(all) == received);
+}
+
+TEST(Output, would_block)
+{
+    // the main loop flushes only when the next line isn't there yet
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    ASSERT_EQ(4, write(fds[1], "+ 1\n", 4));
+    ASSERT_EQ(8, write(fds[1], "+ 2\n+ 3\n", 8));
+    calc::LineReader input(fds[0]);
+    std::string line;
+    ASSERT_TRUE(input.getline(line));
+    EXPECT_FALSE(input.would_block());
+    ASSERT_TRUE(input.getline(line));
+    EXPECT_FALSE(input.would_block());
+    ASSERT_TRUE(input.getline(line));
+    EXPECT_EQ("+ 3", line);
+    EXPECT_TRUE(input.would_block());
+    ASSERT_EQ(4, write(fds[1], "+ 4\n", 4));
+    EXPECT_FALSE(input.would_block());
+    ASSERT_TRUE(input.getline(line));
+    EXPECT_TRUE(input.would_block());
+    close(fds[1]);
+    // the end of the input doesn't wait either
+    EXPECT_FALSE(input.would_block());
+    EXPECT_FALSE(input.getline(line));
+    EXPECT_FALSE(input.would_block());
+    close(fds[0]);
+}
@@ -0,0 +1,41 @@
+#include "perf_corpus.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+
+TEST(PerfCorpus, round_trip)
+{
+    const std::string path = testing::TempDir() + "calc_fold_corpus_test";
+    const std::vector<calc::PerfCase> cases = {{"default", 10, 1.5, "(+) 1 2"}, {"short-circuit two-phase", 2.5, -0.1, "a\\b\tc\nd\r"}, {"fast", 1, 0, ""}};
+    ASSERT_TRUE(calc::save_perf_corpus(path, cases));
+    std::vector<calc::PerfCase> loaded;
+    ASSERT_TRUE(calc::load_perf_corpus(path, loaded));
+    ASSERT_EQ(cases.size(), loaded.size());
+    for (std::size_t k = 0; k < cases.size(); ++k) {
+        EXPECT_EQ(cases[k].mode, loaded[k].mode);
+        EXPECT_EQ(cases[k].budget, loaded[k].budget);
+        EXPECT_EQ(cases[k].current, loaded[k].current);
+        EXPECT_EQ(cases[k].line, loaded[k].line);
+    }
+    std::ofstream(path) << "default\t1\t0\tbad \\x escape\n";
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(calc::load_perf_corpus(path, loaded));
+    EXPECT_EQ("Bad corpus entry at " + path + ":1\n", testing::internal::GetCapturedStderr());
+    std::remove(path.c_str());
+}
+
+TEST(PerfCorpus, ns_per_byte)
+{
+    const auto modes = calc::modes();
+    // short lines are charged for min_charged_bytes
+    const double empty = calc::ns_per_byte(modes[0], 0, "", 1);
+    EXPECT_GT(empty, 0);
+    std::string fold = "(+)";
+    for (int k = 0; k < 1000; ++k) {
+        fold += " 1";
+    }
+    // the cost of a fold grows with its length, not faster
+    EXPECT_LT(calc::ns_per_byte(modes[0], 0, fold, 3), 20 * calc::ns_per_byte(modes[0], 0, fold.substr(0, 203), 3));
+}
@@ -0,0 +1,85 @@
+#include "calc.h"
+#include "planner.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+TEST(Planner, plan)
+{
+    calc::Tuning tuning;
+    tuning.simd_min_operands = 8;
+    tuning.parallel_min_operands = 100;
+    EXPECT_EQ(calc::Engine::Scalar, calc::plan(calc::Op::ADD, 1000, true, tuning));
+    EXPECT_EQ(calc::Engine::Scalar, calc::plan(calc::Op::ADD, 7, false, tuning));
+    EXPECT_EQ(calc::Engine::Simd, calc::plan(calc::Op::MUL, 8, false, tuning));
+    EXPECT_EQ(calc::Engine::Parallel, calc::plan(calc::Op::SUB, 100, false, tuning));
+    EXPECT_EQ(calc::Engine::Scalar, calc::plan(calc::Op::REM, 1000, false, tuning));
+    EXPECT_EQ(calc::Engine::Rewrite, calc::plan(calc::Op::POW, 3, false, tuning));
+}
+
+TEST(Planner, engines)
+{
+    std::vector<double> args;
+    for (int i = 1; i <= 1000; ++i) {
+        args.push_back(1 + i / 1000.0);
+    }
+    for (const auto op : {calc::Op::ADD, calc::Op::SUB, calc::Op::MUL, calc::Op::DIV}) {
+        const auto expected = calc::fold(calc::Engine::Scalar, op, 3, args);
+        EXPECT_NEAR(expected, calc::fold(calc::Engine::Simd, op, 3, args), 1e-9 * std::abs(expected));
+        EXPECT_NEAR(expected, calc::fold(calc::Engine::Parallel, op, 3, args, 64), 1e-9 * std::abs(expected));
+    }
+    EXPECT_DOUBLE_EQ(65536, calc::fold(calc::Engine::Rewrite, calc::Op::POW, 2, {2, 2, 2, 2}));
+    EXPECT_DOUBLE_EQ(-27, calc::fold(calc::Engine::Rewrite, calc::Op::POW, -3, {3, 1}));
+    // neither is a partial product or sum which over- or underflows
+    EXPECT_TRUE(std::isnan(calc::fold(calc::Engine::Simd, calc::Op::MUL, -8.646e299, {379870764, 0})));
+    EXPECT_TRUE(std::isinf(calc::fold(calc::Engine::Simd, calc::Op::MUL, 1e300, {9999999999, 0.0000000001})));
+    EXPECT_EQ(calc::fold(calc::Engine::Scalar, calc::Op::DIV, 1e-300, {9999999999, 0.0000000001}),
+              calc::fold(calc::Engine::Parallel, calc::Op::DIV, 1e-300, {9999999999, 0.0000000001}, 1));
+    EXPECT_TRUE(std::isinf(calc::fold(calc::Engine::Simd, calc::Op::ADD, 1.7e308, {1e308, 0})));
+    EXPECT_EQ(-0.0, calc::fold(calc::Engine::Simd, calc::Op::MUL, -0.0, {1e300, 1e300}));
+    std::vector<double> scales(32, 10);
+    scales.insert(scales.end(), 32, 0.1);
+    EXPECT_TRUE(std::isinf(calc::fold(calc::Engine::Simd, calc::Op::MUL, 1e300, scales)));
+    EXPECT_TRUE(std::isinf(calc::fold(calc::Engine::Parallel, calc::Op::MUL, 1e300, scales, 8)));
+    // an intermediate power which under- or overflows isn't folded away
+    EXPECT_EQ(0, calc::fold(calc::Engine::Rewrite, calc::Op::POW, 0.5, {2000, 0.001}));
+    EXPECT_TRUE(std::isinf(calc::fold(calc::Engine::Rewrite, calc::Op::POW, 2, {2000, 0.001})));
+}
+
+TEST(Planner, process_line_fast)
+{
+    calc::Options options;
+    options.strict = false;
+    options.tuning.simd_min_operands = 2;
+    options.tuning.parallel_min_operands = 4;
+    options.tuning.parallel_grain = 2;
+    EXPECT_DOUBLE_EQ(34579.8345, process_line(0, "(+) 1 2 34567.8345 9", options));
+    EXPECT_DOUBLE_EQ(2, process_line(1024, "(/) 4 8 16", options));
+    EXPECT_DOUBLE_EQ(65536, process_line(2, "(^) 2 2 2 2", options));
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(11, process_line(11, "(/) 1 0 a", options));
+    EXPECT_EQ("Bad right argument for division: 0\n", testing::internal::GetCapturedStderr());
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(37, process_line(37, "(+) 1 2 3 a 4 5 6", options));
+    EXPECT_EQ("Argument parsing error at 0: 'a'\n", testing::internal::GetCapturedStderr());
+}
+
+TEST(Planner, config)
+{
+    const std::string path = testing::TempDir() + "calc_fold_tuning.conf";
+    calc::Tuning tuning;
+    tuning.simd_min_operands = 17;
+    tuning.parallel_min_operands = 123456;
+    tuning.parallel_grain = 999;
+    ASSERT_TRUE(calc::save_tuning(path, tuning));
+    calc::Tuning loaded;
+    ASSERT_TRUE(calc::load_tuning(path, loaded));
+    EXPECT_EQ(17, loaded.simd_min_operands);
+    EXPECT_EQ(123456, loaded.parallel_min_operands);
+    EXPECT_EQ(999, loaded.parallel_grain);
+    std::remove(path.c_str());
+    EXPECT_FALSE(calc::load_tuning(path, loaded));
+}
@@ -0,0 +1,169 @@
+#include "prepared.h"
+#include "session.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace {
+
+// the registers after the script fed line by line to a Session from each of them
+std::vector<double> feed(const std::vector<std::string> & lines, const std::vector<double> & registers, const calc::Options & options = {})
+{
+    std::vector<double> res;
+    for (const double current : registers) {
+        calc::Session session(options, current);
+        for (const auto & line : lines) {
+            session.feed(line);
+        }
+        session.finish();
+        res.push_back(session.current());
+    }
+    return res;
+}
+
+} // anonymous namespace
+
+TEST(PreparedScript, run)
+{
+    const std::vector<double> registers = {0, 1.5, -2, 7, 1e6};
+    const std::vector<std::vector<std::string>> scripts = {
+            {"+ 5", "* 1.5", "(-) 1 2 3", "SQRT", "_"},
+            {"(^) {", "1.5 2", "0.5", "}", "% 3.25"},
+            {"= x * x - 3", "/ 2"},
+            {"12", "(*) 1.01 1.02 1.03"},
+            {"+ 1", "> $a", "* 3", "- $a"},
+            {"(+) {", "$a", "}"},
+    };
+    for (const auto & lines : scripts) {
+        calc::PreparedScript script;
+        ASSERT_TRUE(script.compile(lines, {}));
+        auto values = registers;
+        script.run(values);
+        const auto expected = feed(lines, registers);
+        for (std::size_t k = 0; k < values.size(); ++k) {
+            EXPECT_TRUE(values[k] == expected[k] || (std::isnan(values[k]) && std::isnan(expected[k]))) << lines[0] << " from " << registers[k];
+        }
+    }
+}
+
+TEST(PreparedScript, variables)
+{
+    // each register has variables of its own, the lines without them are still applied to all at once
+    const std::vector<std::string> lines = {"+ 1", "> $a", "* 3", "> $b", "(+) $a 1 $b", "= x / $a + $b", "(-) {", "$a 2", "}", "% $a", "$b", "> $a", "- $a"};
+    const std::vector<double> registers = {0, -1, 1.5, -2, 1e6};
+    calc::PreparedScript script;
+    ASSERT_TRUE(script.compile(lines, {}));
+    EXPECT_EQ(2u, script.variables());
+    auto values = registers;
+    testing::internal::CaptureStderr();
+    script.run(values);
+    const auto messages = testing::internal::GetCapturedStderr();
+    testing::internal::CaptureStderr();
+    EXPECT_EQ(feed(lines, registers), values);
+    EXPECT_EQ(testing::internal::GetCapturedStderr(), messages);
+    // the one from -1 divides by zero
+    EXPECT_NE("", messages);
+    // a variable read before it's assigned is unknown like in a Session
+    ASSERT_TRUE(script.compile({"+ $a", "> $a", "+ $a"}, {}));
+    values = {1, 2};
+    testing::internal::CaptureStderr();
+    script.run(values);
+    EXPECT_EQ("Unknown variable $a\n", testing::internal::GetCapturedStderr());
+    EXPECT_EQ((std::vector<double>{2, 4}), values);
+}
+
+TEST(PreparedScript, fixed_point)
+{
+    calc::Options options;
+    options.fixed_point = true;
+    const std::vector<double> registers = {0, 0.1, -2.5, 1e300, 1.0 / 3};
+    const std::vector<std::vector<std::string>> scripts = {
+            {"(+) 0.1 0.2", "(*) 1.1 1.1 1.1", "(-) 0.3"},
+            {"(+) {", "0.1 0.2", "}"},
+            {"> $a", "(+) 0.1 $a", "(+) 0.1 12345678901"},
+    };
+    for (const auto & lines : scripts) {
+        calc::PreparedScript script;
+        ASSERT_TRUE(script.compile(lines, options));
+        auto values = registers;
+        testing::internal::CaptureStderr();
+        script.run(values);
+        const auto messages = testing::internal::GetCapturedStderr();
+        testing::internal::CaptureStderr();
+        const auto expected = feed(lines, registers, options);
+        EXPECT_EQ(testing::internal::GetCapturedStderr().substr(0, messages.size()), messages) << lines[0];
+        EXPECT_EQ(expected, values) << lines[0];
+    }
+    calc::PreparedScript script;
+    ASSERT_TRUE(script.compile({"(+) 0.1 0.2"}, options));
+    std::vector<double> values = {0};
+    script.run(values);
+    EXPECT_EQ(0.3, values[0]);
+}
+
+TEST(PreparedScript, errors)
+{
+    calc::PreparedScript script;
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(script.compile({"(+) {", "1 2"}, {}));
+    EXPECT_EQ("Unterminated fold block\n", testing::internal::GetCapturedStderr());
+    // a malformed line is skipped with its messages printed once a run, like process_batch() does
+    const std::vector<std::vector<std::string>> scripts = {
+            {"+ 1", "/ 0", "* 2"},
+            {"+ 1", "SQRT 2", "* 2"},
+            {"+ 1", "= x +", "* 2"},
+            {"+ 1", "(+) {", "}", "* 2"},
+            {"+ 1", "(/) {", "2 0 3", "}", "* 2"},
+            {"+ 1", "(=) {", "2", "}", "* 2"},
+    };
+    for (const auto & lines : scripts) {
+        testing::internal::CaptureStderr();
+        ASSERT_TRUE(script.compile(lines, {}));
+        EXPECT_EQ("", testing::internal::GetCapturedStderr()) << lines[1];
+        std::vector<double> values = {5, -1, 0.5};
+        testing::internal::CaptureStderr();
+        script.run(values);
+        const auto messages = testing::internal::GetCapturedStderr();
+        EXPECT_EQ((std::vector<double>{12, 0, 3}), values) << lines[1];
+        testing::internal::CaptureStderr();
+        calc::Session session({}, 5);
+        for (const auto & line : lines) {
+            session.feed(line);
+        }
+        session.finish();
+        EXPECT_EQ(testing::internal::GetCapturedStderr(), messages) << lines[1];
+    }
+    // the ones which depend on the register come with the run
+    ASSERT_TRUE(script.compile({"SQRT"}, {}));
+    std::vector<double> values = {4, -4};
+    testing::internal::CaptureStderr();
+    script.run(values);
+    EXPECT_EQ("Bad argument for SQRT: -4\n", testing::internal::GetCapturedStderr());
+    EXPECT_EQ(2, values[0]);
+}
+
+TEST(ScriptCache, handles)
+{
+    calc::ScriptCache cache(2, {});
+    const auto a = cache.prepare({"+ 1"});
+    const auto b = cache.prepare({"+ 2"});
+    EXPECT_NE(0u, a);
+    EXPECT_NE(a, b);
+    EXPECT_EQ(a, cache.prepare({"+ 1"}));
+    testing::internal::CaptureStderr();
+    EXPECT_EQ(0u, cache.prepare({"(+) {"}));
+    testing::internal::GetCapturedStderr();
+    // a was used after b, so b goes
+    EXPECT_NE(nullptr, cache.find(a));
+    const auto c = cache.prepare({"+ 3"});
+    EXPECT_EQ(2u, cache.size());
+    EXPECT_EQ(nullptr, cache.find(b));
+    EXPECT_NE(nullptr, cache.find(a));
+    EXPECT_NE(nullptr, cache.find(c));
+    // a handle isn't reused for the same text
+    EXPECT_NE(b, cache.prepare({"+ 2"}));
+    EXPECT_EQ(nullptr, cache.find(a));
+}
@@ -0,0 +1,97 @@
+#include "calc.h"
+#include "profiler.h"
+
+#include <gtest/gtest.h>
+
+#include <csignal>
+#include <sstream>
+#include <string>
+
+TEST(Profiler, phase_scope)
+{
+    EXPECT_EQ(calc::Phase::Other, calc::current_phase.load());
+    {
+        const calc::PhaseScope read(calc::Phase::Read);
+        {
+            const calc::PhaseScope fold(calc::Phase::Fold);
+            EXPECT_EQ(calc::Phase::Fold, calc::current_phase.load());
+        }
+        EXPECT_EQ(calc::Phase::Read, calc::current_phase.load());
+    }
+    EXPECT_EQ(calc::Phase::Other, calc::current_phase.load());
+    // a line leaves no mark behind
+    process_line(2, "(^) 1.5 2 3");
+    EXPECT_EQ(calc::Phase::Other, calc::current_phase.load());
+    EXPECT_EQ(calc::Op::POW, calc::current_op.load());
+}
+
+TEST(Profiler, samples)
+{
+    std::string line = "(^)";
+    for (int k = 0; k < 1000; ++k) {
+        line += " 1.0001";
+    }
+    calc::Profiler profiler;
+    ASSERT_TRUE(profiler.start());
+    double res = 0;
+    while (profiler.samples() < 50) {
+        res += process_line(1.5, line);
+    }
+    profiler.stop();
+    EXPECT_GT(res, 0);
+    const auto total = profiler.samples();
+    // the operands are where the time goes, most of it even in sanitizer builds
+    EXPECT_GT(profiler.samples(calc::Phase::Fold), 0u);
+#ifdef SANITIZED_BUILD
+    EXPECT_GT(profiler.samples(calc::Phase::Fold) + profiler.samples(calc::Phase::ParseArg), total * 2 / 3);
+#else
+    EXPECT_GT(profiler.samples(calc::Phase::Fold) + profiler.samples(calc::Phase::ParseArg), total * 9 / 10);
+#endif
+    EXPECT_EQ(profiler.samples(calc::Phase::Fold) + profiler.samples(calc::Phase::ParseArg), profiler.samples(calc::Op::POW));
+    EXPECT_EQ(0u, profiler.samples(calc::Op::ADD));
+    std::ostringstream report;
+    profiler.report(report);
+    EXPECT_NE(std::string::npos, report.str().find("fold"));
+    EXPECT_NE(std::string::npos, report.str().find("^"));
+    // stopped, nothing is sampled any more
+    for (int k = 0; k < 100; ++k) {
+        res += process_line(1.5, line);
+    }
+    EXPECT_EQ(total, profiler.samples());
+}
+
+namespace {
+
+void ignore_sigprof(int)
+{
+}
+
+} // anonymous namespace
+
+TEST(Profiler, restores_sigprof)
+{
+    struct sigaction action = {};
+    action.sa_handler = ignore_sigprof;
+    sigemptyset(&action.sa_mask);
+    struct sigaction old = {};
+    ASSERT_EQ(0, sigaction(SIGPROF, &action, &old));
+    {
+        calc::Profiler profiler;
+        ASSERT_TRUE(profiler.start());
+        struct sigaction during = {};
+        sigaction(SIGPROF, nullptr, &during);
+        EXPECT_NE(&ignore_sigprof, during.sa_handler);
+        profiler.stop();
+    }
+    struct sigaction after = {};
+    sigaction(SIGPROF, nullptr, &after);
+    EXPECT_EQ(&ignore_sigprof, after.sa_handler);
+    sigaction(SIGPROF, &old, nullptr);
+    // and by the destructor
+    {
+        calc::Profiler profiler;
+        ASSERT_TRUE(profiler.start());
+    }
+    sigaction(SIGPROF, nullptr, &after);
+    EXPECT_EQ(old.sa_handler, after.sa_handler);
+}
@@ -0,0 +1,57 @@
+#include "differential.h"
+#include "reference.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+TEST(Reference, frozen)
+{
+    const auto run = [](const double current, const std::string & line) { return calc::run_captured(calc::reference::process_line, current, line); };
+    EXPECT_EQ(16, run(1, "(+) 1 2 3 4 5").value);
+    EXPECT_EQ(0.5, run(1, "(/) 2").value);
+    EXPECT_EQ(1, run(1, "(/) 2 0").value);
+    EXPECT_EQ("Bad right argument for division: 0\n", run(1, "(/) 2 0").messages);
+    EXPECT_EQ("Unknown operation x\n", run(1, "x").messages);
+    EXPECT_EQ("Argument isn't fully parsed, suffix left: '1'\n", run(1, "+ 12345678901").messages);
+}
+
+TEST(Reference, all_modes_agree)
+{
+    for (const auto & mode : calc::modes()) {
+        const auto divergence = calc::find_divergence(mode, 5, 20000);
+        if (divergence) {
+            std::ostringstream report;
+            report << *divergence;
+            ADD_FAILURE() << report.str();
+        }
+    }
+}
+
+TEST(Reference, minimize)
+{
+    // diverges on any line with a '7' in it
+    const calc::Mode broken{"broken", "", calc::Agreement::Exact, "", [](const double current, const std::string & line) {
+                                return line.find('7') == std::string::npos ? calc::reference::process_line(current, line) : current + 1;
+                            }};
+    EXPECT_EQ("7", calc::minimize(broken, 1, "(+) 1 2 37 4"));
+    const auto divergence = calc::find_divergence(broken, 1, 1000);
+    ASSERT_TRUE(divergence);
+    EXPECT_EQ("7", divergence->line);
+    std::ostringstream report;
+    report << *divergence;
+    EXPECT_NE(std::string::npos, report.str().find("| calc_fold\n")) << report.str();
+    // agreements
+    const calc::Outcome one{1, ""};
+    EXPECT_FALSE(calc::agrees(calc::Agreement::Exact, one, {1 + 1e-12, ""}));
+    EXPECT_TRUE(calc::agrees(calc::Agreement::Close, one, {1 + 1e-12, ""}));
+    EXPECT_FALSE(calc::agrees(calc::Agreement::Close, one, {1, "message\n"}));
+    EXPECT_TRUE(calc::agrees(calc::Agreement::Extends, {1, "error\n"}, {2, ""}));
+    EXPECT_TRUE(calc::agrees(calc::Agreement::Extends, one, {1 + 1e-12, ""}));
+    EXPECT_FALSE(calc::agrees(calc::Agreement::Extends, one, {2, ""}));
+    EXPECT_TRUE(calc::agrees(calc::Agreement::Accepts, one, {2, ""}));
+    EXPECT_FALSE(calc::agrees(calc::Agreement::Accepts, one, {1, "error\n"}));
+    const calc::Mode loose{"loose", "", calc::Agreement::Extends, "%", broken.process};
+    EXPECT_EQ(calc::Agreement::Extends, calc::agreement(loose, "+ 1"));
+    EXPECT_EQ(calc::Agreement::Accepts, calc::agreement(loose, "(%) 1"));
+}
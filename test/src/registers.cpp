@@ -0,0 +1,105 @@
+#include "registers.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+
+namespace {
+
+using Stored = std::map<std::string, double>;
+
+Stored reopen(const std::string & path)
+{
+    Stored res;
+    calc::RegisterTable table;
+    EXPECT_TRUE(table.open(path, [&](const std::string_view name, const double value) { res.emplace(name, value); }));
+    return res;
+}
+
+} // anonymous namespace
+
+TEST(RegisterTable, restore)
+{
+    const std::string path = testing::TempDir() + "calc_fold_registers_test";
+    std::remove(path.c_str());
+    {
+        calc::RegisterTable table;
+        ASSERT_TRUE(table.open(path, [](std::string_view, double) { FAIL(); }, 16));
+        const auto a = table.slot("a");
+        EXPECT_EQ(a, table.slot("a"));
+        table.store(a, 1.5);
+        table.store(table.slot("b"), -2);
+        table.store(a, 3.25);
+        EXPECT_EQ(3.25, table.load(a));
+        EXPECT_EQ(calc::RegisterTable::npos, table.slot(std::string(calc::RegisterTable::max_name + 1, 'x')));
+    }
+    const Stored expected = {{"a", 3.25}, {"b", -2}};
+    EXPECT_EQ(expected, reopen(path));
+    // the capacity is the one of the file
+    calc::RegisterTable table;
+    ASSERT_TRUE(table.open(path, [](std::string_view, double) {}, 1024));
+    for (int k = 0; k < 14; ++k) {
+        EXPECT_NE(calc::RegisterTable::npos, table.slot(std::to_string(k)));
+    }
+    EXPECT_EQ(calc::RegisterTable::npos, table.slot("full"));
+    std::remove(path.c_str());
+}
+
+TEST(RegisterTable, torn_slots)
+{
+    const std::string path = testing::TempDir() + "calc_fold_torn_test";
+    std::remove(path.c_str());
+    {
+        calc::RegisterTable table;
+        ASSERT_TRUE(table.open(path, [](std::string_view, double) {}, 16));
+        table.store(table.slot("a"), 1);
+        table.store(table.slot("b"), 2);
+        table.store(table.slot("c"), 3);
+    }
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        // the sequence of "a" left odd, as if the process died in the middle of a store
+        file.seekp(256);
+        file.put(1);
+        // a bit flip in the value of "b"
+        file.seekp(512 + 8);
+        file.put(1);
+    }
+    EXPECT_EQ(Stored({{"c", 3}}), reopen(path));
+    // the dropped slots are free again
+    EXPECT_EQ(Stored({{"c", 3}}), reopen(path));
+    // not a table
+    std::ofstream(path) << "something else";
+    calc::RegisterTable table;
+    EXPECT_FALSE(table.open(path, [](std::string_view, double) {}));
+    std::remove(path.c_str());
+}
+
+TEST(RegisterTable, concurrent_load)
+{
+    const std::string path = testing::TempDir() + "calc_fold_seqlock_test";
+    std::remove(path.c_str());
+    calc::RegisterTable table;
+    ASSERT_TRUE(table.open(path, [](std::string_view, double) {}, 16));
+    const auto slot = table.slot("a");
+    std::atomic<bool> done{false};
+    std::thread reader([&] {
+        double last = 0;
+        while (!done.load()) {
+            const double value = table.load(slot);
+            EXPECT_GE(value, last);
+            last = value;
+        }
+    });
+    for (int k = 1; k <= 1000000; ++k) {
+        table.store(slot, k);
+    }
+    done = true;
+    reader.join();
+    std::remove(path.c_str());
+}
@@ -0,0 +1,107 @@
+#include "mapped_file.h"
+#include "sample.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+
+namespace {
+
+std::string make_operands(const std::size_t count, double & sum)
+{
+    std::mt19937_64 random(7);
+    std::string text;
+    sum = 0;
+    for (std::size_t n = 0; n < count; ++n) {
+        // lengths and values vary together, which a byte-offset sample has to undo
+        const auto value = static_cast<double>(random() % 100000) / 100;
+        sum += value;
+        text += std::to_string(value) + (n % 10 == 9 ? "\n" : " ");
+    }
+    return text;
+}
+
+} // anonymous namespace
+
+TEST(Sample, quantile)
+{
+    EXPECT_NEAR(1.959964, calc::normal_quantile(0.95), 1e-6);
+    EXPECT_NEAR(2.575829, calc::normal_quantile(0.99), 1e-6);
+}
+
+TEST(Sample, interval_covers_sum)
+{
+    double sum = 0;
+    const auto text = make_operands(200000, sum);
+    for (const auto method : {calc::Sampling::Stride, calc::Sampling::Reservoir}) {
+        calc::SampleConfig config;
+        config.method = method;
+        config.samples = 2000;
+        config.confidence = 0.999;
+        calc::Estimate estimate;
+        ASSERT_TRUE(calc::estimate_sum(text, config, estimate));
+        EXPECT_EQ(2000, estimate.samples);
+        EXPECT_LE(estimate.low, sum);
+        EXPECT_GE(estimate.high, sum);
+        EXPECT_LT(estimate.high - estimate.low, sum * 0.1);
+    }
+}
+
+TEST(Sample, reservoir_small_input_is_exact)
+{
+    calc::SampleConfig config;
+    config.method = calc::Sampling::Reservoir;
+    calc::Estimate estimate;
+    ASSERT_TRUE(calc::estimate_sum("  1 2.5\n-3e1 ", config, estimate));
+    EXPECT_DOUBLE_EQ(-26.5, estimate.value);
+    EXPECT_DOUBLE_EQ(estimate.value, estimate.low);
+    EXPECT_DOUBLE_EQ(estimate.value, estimate.high);
+    EXPECT_EQ(3, estimate.samples);
+}
+
+TEST(Sample, stride_small_input_is_exact)
+{
+    calc::SampleConfig config;
+    config.method = calc::Sampling::Stride;
+    calc::Estimate estimate;
+    ASSERT_TRUE(calc::estimate_sum("1 2 3 4 5 6 7 8 9 10\n", config, estimate));
+    EXPECT_EQ(55, estimate.value);
+    EXPECT_EQ(55, estimate.low);
+    EXPECT_EQ(55, estimate.high);
+    EXPECT_EQ(10, estimate.samples);
+}
+
+TEST(Sample, err)
+{
+    calc::SampleConfig config;
+    calc::Estimate estimate;
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(calc::estimate_sum(" \n ", config, estimate));
+    EXPECT_EQ("No argument for a binary operation\n", testing::internal::GetCapturedStderr());
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(calc::estimate_sum("1 2x 3", config, estimate));
+    EXPECT_EQ("Argument parsing error at 1: 'x'\n", testing::internal::GetCapturedStderr());
+    config.confidence = 1;
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(calc::estimate_sum("1", config, estimate));
+    EXPECT_EQ("Bad confidence level: 1\n", testing::internal::GetCapturedStderr());
+}
+
+TEST(Sample, mapped_file)
+{
+    const std::string path = testing::TempDir() + "calc_fold_sample_test";
+    std::ofstream(path) << "1 2 3\n";
+    calc::MappedFile file;
+    ASSERT_TRUE(file.open(path));
+    EXPECT_EQ("1 2 3\n", file.data());
+    calc::MappedFile moved = std::move(file);
+    EXPECT_TRUE(file.data().empty());
+    EXPECT_EQ("1 2 3\n", moved.data());
+    std::remove(path.c_str());
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(file.open(path));
+    EXPECT_FALSE(testing::internal::GetCapturedStderr().empty());
+}
@@ -0,0 +1,21 @@
+#include "scan.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+TEST(Scan, only_number_chars)
+{
+    EXPECT_TRUE(calc::only_number_chars(""));
+    EXPECT_TRUE(calc::only_number_chars("1 2.5\t3"));
+    EXPECT_TRUE(calc::only_number_chars("0123456789 .0123456789 \t\r\n\v\f 99"));
+    EXPECT_FALSE(calc::only_number_chars("1 2 3 a"));
+    EXPECT_FALSE(calc::only_number_chars("1 -2"));
+    for (std::size_t i = 0; i < 40; ++i) {
+        std::string text(40, '7');
+        text[i] = ',';
+        EXPECT_FALSE(calc::only_number_chars(text)) << i;
+        text[i] = ' ';
+        EXPECT_TRUE(calc::only_number_chars(text)) << i;
+    }
+}
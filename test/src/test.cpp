@@ -2,6 +2,8 @@
 
 #include <gtest/gtest.h>
 
+#include <cmath>
+
 TEST(Calc, err)
 {
     testing::internal::CaptureStderr();
@@ -278,3 +280,93 @@ TEST(Calc, fold_rem)
     EXPECT_DOUBLE_EQ(7, process_line(7, "(((((%))))) 10 100"));
     EXPECT_FALSE(testing::internal::GetCapturedStderr().empty());
 }
+
+TEST(Calc, fold_short_circuit)
+{
+    calc::Options options;
+    options.short_circuit = true;
+    EXPECT_DOUBLE_EQ(0, process_line(5, "(*) 2 0 3 4 5", options));
+    EXPECT_DOUBLE_EQ(1, process_line(1, "(^) 2 3 4", options));
+    EXPECT_DOUBLE_EQ(0, process_line(0, "(%) 7 3", options));
+    EXPECT_TRUE(std::isnan(process_line(-8, "(^) 0.5", options)));
+    // the rest of operands is still validated
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(5, process_line(5, "(*) 0 1 2a 3", options));
+    EXPECT_EQ("Argument parsing error at 1: 'a'\n", testing::internal::GetCapturedStderr());
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(5, process_line(5, "(%) 5 1 0 1", options));
+    EXPECT_EQ("Bad right argument for remainder: 0\n", testing::internal::GetCapturedStderr());
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(7, process_line(7, "(/) 0.5 0 0x", options));
+    EXPECT_EQ("Bad right argument for division: 0\n", testing::internal::GetCapturedStderr());
+}
+
+TEST(Calc, fold_two_phase)
+{
+    calc::Options options;
+    options.two_phase = true;
+    EXPECT_DOUBLE_EQ(65536, process_line(2, "(^) 2 2 2 2", options));
+    EXPECT_DOUBLE_EQ(3, process_line(469, "(%) 123 93 11 4", options));
+    EXPECT_DOUBLE_EQ(2, process_line(1024, "(/) 4 8 16", options));
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(7, process_line(7, "(^) 10 100 1000 x", options));
+    EXPECT_EQ("Argument parsing error at 0: 'x'\n", testing::internal::GetCapturedStderr());
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(7, process_line(7, "(%) 10 100 0.00 3", options));
+    EXPECT_EQ("Bad right argument for remainder: 0\n", testing::internal::GetCapturedStderr());
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(7, process_line(7, "(^) 1 1.5 12345678901", options));
+    EXPECT_EQ("Argument isn't fully parsed, suffix left: '1'\n", testing::internal::GetCapturedStderr());
+}
+
+namespace {
+
+double run_block(calc::FoldBlock & block, const double current, std::initializer_list<const char *> lines, const calc::Options & options = {})
+{
+    auto it = lines.begin();
+    EXPECT_TRUE(block.open(current, *it++, options));
+    for (; it != lines.end(); ++it) {
+        EXPECT_TRUE(block.active());
+        if (block.feed(*it)) {
+            EXPECT_EQ(it + 1, lines.end());
+        }
+    }
+    EXPECT_FALSE(block.active());
+    return block.result();
+}
+
+} // anonymous namespace
+
+TEST(Calc, fold_block)
+{
+    calc::FoldBlock block;
+    EXPECT_FALSE(block.open(0, "(+) 1 2", {}));
+    EXPECT_FALSE(block.open(0, "+ {", {}));
+    EXPECT_DOUBLE_EQ(16, run_block(block, 10, {"(+) {", "1 2", "", "  3\t", "}"}));
+    EXPECT_DOUBLE_EQ(process_line(1024, "(/) 4 8 16"), run_block(block, 1024, {"(/)  {  ", "4", "8 16", " } "}));
+    EXPECT_DOUBLE_EQ(65536, run_block(block, 2, {"(^) {", "2 2", "2 2", "}"}));
+    calc::Options options;
+    options.short_circuit = true;
+    EXPECT_DOUBLE_EQ(0, run_block(block, 5, {"(*) {", "2 0", "3", "}"}, options));
+}
+
+TEST(Calc, fold_block_err)
+{
+    calc::FoldBlock block;
+    // all or nothing: an error anywhere keeps the register
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(5, run_block(block, 5, {"(+) {", "1 2", "3x 4", "y", "}"}));
+    EXPECT_EQ("Argument parsing error at 1: 'x'\n", testing::internal::GetCapturedStderr());
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(5, run_block(block, 5, {"(%) {", "3", "0", "}"}));
+    EXPECT_EQ("Bad right argument for remainder: 0\n", testing::internal::GetCapturedStderr());
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(5, run_block(block, 5, {"(*) {", "}"}));
+    EXPECT_EQ("No argument for a binary operation\n", testing::internal::GetCapturedStderr());
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(5, run_block(block, 5, {"(1) {", "2", "}"}));
+    EXPECT_EQ("Wrong operation left fold\n", testing::internal::GetCapturedStderr());
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(5, run_block(block, 5, {"(x) {", "2", "}"}));
+    EXPECT_EQ("Unknown operation x {\n", testing::internal::GetCapturedStderr());
+}
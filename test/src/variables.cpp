@@ -0,0 +1,148 @@
+#include "calc.h"
+#include "variables.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+TEST(Variables, slots)
+{
+    calc::Variables variables;
+    EXPECT_EQ(0, variables.assign("a", 1.5));
+    EXPECT_EQ(1, variables.assign("rate_2", 2));
+    EXPECT_EQ(0, variables.assign("a", 3));
+    EXPECT_EQ(0, variables.find("a"));
+    EXPECT_FALSE(variables.find("b"));
+    EXPECT_EQ((std::vector<double>{3, 2}), variables.values());
+    std::size_t i = 0;
+    EXPECT_EQ("rate_2", calc::parse_variable_name("$rate_2+1", i));
+    EXPECT_EQ(7, i);
+    i = 0;
+    EXPECT_EQ("", calc::parse_variable_name("$2", i));
+    EXPECT_EQ(0, i);
+}
+
+TEST(Variables, process_line)
+{
+    calc::Context context;
+    const calc::Options options;
+    EXPECT_DOUBLE_EQ(1.05, process_line(1.05, "> $rate", options, context));
+    EXPECT_DOUBLE_EQ(12, process_line(12, ">$base", options, context));
+    EXPECT_DOUBLE_EQ(12.6, process_line(12, "* $rate", options, context));
+    EXPECT_DOUBLE_EQ(25.05, process_line(0, "(+) $base 12 $rate", options, context));
+    EXPECT_DOUBLE_EQ(12, process_line(0, "$base", options, context));
+    EXPECT_DOUBLE_EQ(8.1, process_line(2, "= x * $rate + $base / 4 * x", options, context));
+    // reassignment changes the value, not the slot
+    EXPECT_DOUBLE_EQ(2, process_line(2, "> $rate", options, context));
+    EXPECT_DOUBLE_EQ(10, process_line(2, "= x * $rate + $base / 4 * x", options, context));
+}
+
+TEST(Variables, fold_modes)
+{
+    calc::Context context;
+    calc::Options options;
+    process_line(0, "> $zero", options, context);
+    process_line(0.1, "> $tenth", options, context);
+    options.fixed_point = true;
+    EXPECT_DOUBLE_EQ(0.3, process_line(0, "(+) $tenth 0.2", options, context));
+    options.short_circuit = true;
+    options.two_phase = true;
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(5, process_line(5, "(*) $zero 2 $missing", options, context));
+    EXPECT_EQ("Unknown variable $missing\n", testing::internal::GetCapturedStderr());
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(5, process_line(5, "(/) 2 $zero", options, context));
+    EXPECT_EQ("Bad right argument for division: 0\n", testing::internal::GetCapturedStderr());
+    calc::FoldBlock block;
+    EXPECT_TRUE(block.open(1, "(+) {", options, context.variables()));
+    EXPECT_FALSE(block.feed("$tenth 1"));
+    EXPECT_TRUE(block.feed("}"));
+    EXPECT_DOUBLE_EQ(2.1, block.result());
+}
+
+TEST(Variables, short_circuit)
+{
+    // variables may be negative or infinite, unlike historical operands
+    calc::Context context;
+    calc::Options options;
+    process_line(-5, "> $m", options, context);
+    const auto inf = std::numeric_limits<double>::infinity();
+    process_line(-inf, "> $ni", options, context);
+    const auto zero = process_line(0, "(*) 0 $m", options, context);
+    const auto nan = process_line(inf, "(+) 1 $ni", options, context);
+    EXPECT_TRUE(std::signbit(zero));
+    EXPECT_TRUE(std::isnan(nan));
+    calc::FoldBlock block;
+    EXPECT_TRUE(block.open(1, "(*) {", options, context.variables()));
+    EXPECT_FALSE(block.feed("0"));
+    EXPECT_FALSE(block.feed("2 $m"));
+    EXPECT_TRUE(block.feed("}"));
+    const auto block_zero = block.result();
+    options.short_circuit = true;
+    EXPECT_EQ(std::signbit(zero), std::signbit(process_line(0, "(*) 0 $m", options, context)));
+    EXPECT_EQ(std::isnan(nan), std::isnan(process_line(inf, "(+) 1 $ni", options, context)));
+    EXPECT_EQ(std::signbit(nan), std::signbit(process_line(inf, "(+) 1 $ni", options, context)));
+    EXPECT_TRUE(block.open(1, "(*) {", options, context.variables()));
+    EXPECT_FALSE(block.feed("0"));
+    EXPECT_FALSE(block.feed("2 $m"));
+    EXPECT_TRUE(block.feed("}"));
+    EXPECT_EQ(std::signbit(block_zero), std::signbit(block.result()));
+}
+
+TEST(Variables, err)
+{
+    calc::Context context;
+    const calc::Options options;
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(3, process_line(3, "+ $a", options, context));
+    EXPECT_EQ("Unknown variable $a\n", testing::internal::GetCapturedStderr());
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(3, process_line(3, "= x + $a", options, context));
+    EXPECT_EQ("Unknown variable $a\n", testing::internal::GetCapturedStderr());
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(3, process_line(3, "> a", options, context));
+    EXPECT_EQ("Bad variable name: ' a'\n", testing::internal::GetCapturedStderr());
+    process_line(1, "> $a", options, context);
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(3, process_line(3, "+ $a1x!", options, context));
+    EXPECT_EQ("Unknown variable $a1x\n", testing::internal::GetCapturedStderr());
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(3, process_line(3, "+ $a!", options, context));
+    EXPECT_EQ("Argument parsing error at 4: '!'\n", testing::internal::GetCapturedStderr());
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(3, process_line(3, "+ $", options, context));
+    EXPECT_EQ("Argument parsing error at 2: '$'\nNo argument for a binary operation\n", testing::internal::GetCapturedStderr());
+}
+
+TEST(Variables, compile_line)
+{
+    calc::Variables variables;
+    variables.assign("a", 2);
+    variables.assign("zero", 0);
+    const calc::Options options;
+    const auto line = calc::compile_line("(*) 3 $a 1.5", options, variables);
+    ASSERT_EQ(calc::CompiledLine::Kind::Ops, line.kind);
+    EXPECT_EQ((std::vector<std::pair<std::size_t, std::size_t>>{{1, 0}}), line.loads);
+    // the values are taken when the line is applied
+    std::vector<double> registers = {1, 2};
+    calc::apply_line(line, registers, options, {10, 0});
+    EXPECT_EQ((std::vector<double>{45, 90}), registers);
+    calc::apply_line(line, registers, options, {-1, 0});
+    EXPECT_EQ((std::vector<double>{-202.5, -405}), registers);
+    // a zero divisor only when it's there
+    const auto divide = calc::compile_line("(/) 2 $zero", options, variables);
+    ASSERT_EQ(calc::CompiledLine::Kind::Ops, divide.kind);
+    testing::internal::CaptureStderr();
+    calc::apply_line(divide, registers, options, {10, 0});
+    EXPECT_EQ("Bad right argument for division: 0\n", testing::internal::GetCapturedStderr());
+    EXPECT_EQ((std::vector<double>{-202.5, -405}), registers);
+    calc::apply_line(divide, registers, options, {10, 4});
+    EXPECT_EQ((std::vector<double>{-25.3125, -50.625}), registers);
+    testing::internal::CaptureStderr();
+    EXPECT_EQ(calc::CompiledLine::Kind::Invalid, calc::compile_line("+ $missing", options, variables).kind);
+    EXPECT_EQ(calc::CompiledLine::Kind::Invalid, calc::compile_line("(+) 1 $a!", options, variables).kind);
+    EXPECT_EQ("Unknown variable $missing\nArgument parsing error at 2: '!'\n", testing::internal::GetCapturedStderr());
+}
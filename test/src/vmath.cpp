@@ -0,0 +1,170 @@
+#include "calc.h"
+#include "vmath.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+bool same_bits(const double a, const double b)
+{
+    return std::memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+// error of the value in units in the last place of the exact result
+double ulp_error(const double value, const long double exact)
+{
+    const double rounded = static_cast<double>(exact);
+    const double ulp = std::nextafter(std::fabs(rounded), std::numeric_limits<double>::infinity()) - std::fabs(rounded);
+    return static_cast<double>(std::fabs(static_cast<long double>(value) - exact) / ulp);
+}
+
+std::vector<double> specials()
+{
+    const double inf = std::numeric_limits<double>::infinity();
+    return {0.0, -0.0, 1, -1, 2.5, -2.5, 1e300, -1e300, 5e-324, 2.2250738585072014e-308, inf, -inf, std::numeric_limits<double>::quiet_NaN(), 3, 7, 0.1};
+}
+
+} // anonymous namespace
+
+TEST(Vmath, sqrt)
+{
+    std::mt19937_64 random(1);
+    std::vector<double> values = specials();
+    for (int k = 0; k < 1000; ++k) {
+        values.push_back(std::uniform_real_distribution<double>(-10, 1e6)(random));
+    }
+    auto res = values;
+    calc::sqrt_lanes(res.data(), res.size());
+    for (std::size_t k = 0; k < values.size(); ++k) {
+        // bad arguments keep their values
+        EXPECT_TRUE(same_bits(values[k] > 0 ? std::sqrt(values[k]) : values[k], res[k])) << values[k];
+    }
+}
+
+TEST(Vmath, fmod)
+{
+    std::mt19937_64 random(2);
+    std::vector<double> values = specials();
+    for (int k = 0; k < 3000; ++k) {
+        const double magnitude = std::exp2(std::uniform_real_distribution<double>(-1074, 1023)(random));
+        values.push_back(random() % 2 == 0 ? magnitude : -magnitude);
+    }
+    for (const double divisor : {2.25, -0.1, 1e-300, 3e200, 5e-324, 1.0, 7.0, std::numeric_limits<double>::infinity()}) {
+        auto res = values;
+        EXPECT_TRUE(calc::fmod_lanes(res.data(), res.size(), divisor));
+        for (std::size_t k = 0; k < values.size(); ++k) {
+            const double expected = std::fmod(values[k], divisor);
+            EXPECT_TRUE(same_bits(expected, res[k]) || (std::isnan(expected) && std::isnan(res[k]))) << values[k] << " % " << divisor;
+        }
+    }
+    auto res = values;
+    EXPECT_FALSE(calc::fmod_lanes(res.data(), res.size(), 0));
+    EXPECT_TRUE(std::equal(values.begin(), values.end(), res.begin(), same_bits));
+}
+
+TEST(Vmath, pow)
+{
+    std::mt19937_64 random(3);
+    const auto uniform = [&random](const double low, const double high) { return std::uniform_real_distribution<double>(low, high)(random); };
+    double worst = 0;
+    for (int round = 0; round < 200; ++round) {
+        std::vector<double> values(101);
+        double exponent;
+        switch (round % 4) {
+        case 0:
+            exponent = uniform(-10, 10);
+            for (auto & value : values) {
+                value = uniform(0, 100);
+            }
+            break;
+        case 1:
+            // log(x) is tiny, the exponent big
+            exponent = uniform(-1e6, 1e6);
+            for (auto & value : values) {
+                value = 1 + uniform(-1e-4, 1e-4);
+            }
+            break;
+        case 2:
+            exponent = uniform(-200, 200);
+            for (auto & value : values) {
+                value = std::exp(uniform(-3, 3));
+            }
+            break;
+        default:
+            exponent = uniform(-1, 1);
+            for (auto & value : values) {
+                value = std::exp2(uniform(-1020, 1020));
+            }
+            break;
+        }
+        auto res = values;
+        calc::pow_lanes(res.data(), res.size(), exponent);
+        for (std::size_t k = 0; k < values.size(); ++k) {
+            const long double exact = std::pow(static_cast<long double>(values[k]), static_cast<long double>(exponent));
+            if (std::fabs(exact) >= std::numeric_limits<double>::min() && std::fabs(exact) <= std::numeric_limits<double>::max()) {
+                worst = std::max(worst, ulp_error(res[k], exact));
+            }
+            else {
+                EXPECT_TRUE(same_bits(std::pow(values[k], exponent), res[k])) << values[k] << " ^ " << exponent;
+            }
+        }
+    }
+    EXPECT_LT(worst, 0.6);
+    // everything but positive normal bases is std::pow's
+    const auto values = specials();
+    for (const double exponent : {0.0, 1.0, 2.0, -3.0, 0.5, 1e10, -1e-10, std::numeric_limits<double>::infinity(), std::numeric_limits<double>::quiet_NaN()}) {
+        auto res = values;
+        calc::pow_lanes(res.data(), res.size(), exponent);
+        for (std::size_t k = 0; k < values.size(); ++k) {
+            const double expected = std::pow(values[k], exponent);
+            if (std::isnormal(values[k]) && values[k] > 0 && std::isnormal(expected)) {
+                EXPECT_LE(std::fabs(res[k] - expected), std::fabs(expected) * 0x1p-52) << values[k] << " ^ " << exponent;
+            }
+            else {
+                EXPECT_TRUE(same_bits(expected, res[k]) || (std::isnan(expected) && std::isnan(res[k]))) << values[k] << " ^ " << exponent;
+            }
+        }
+    }
+}
+
+TEST(Vmath, batch)
+{
+    const char * lines[] = {"+ 1.5", "(*) 2 3.25", "_", "SQRT", "(%) 7 2.5", "% 0.3", "(^) 1.5 0.25", "^ 3", "(/) 4 .5", "- 100", "12", "(+) 1 2 {", "/ 0", "(%) 3 0", "+ 1x", "* ", "(-) ", "SQRT 2", "(SET) 1", "(1) 1", "blah", "$x", "= 1 + 2", "> y"};
+    std::vector<double> registers;
+    for (int k = -20; k <= 20; ++k) {
+        registers.push_back(k * 0.75);
+    }
+    registers.push_back(std::numeric_limits<double>::quiet_NaN());
+    for (const char * line : lines) {
+        auto expected = registers;
+        std::ostringstream expected_messages;
+        auto * const saved = std::cerr.rdbuf(expected_messages.rdbuf());
+        for (auto & current : expected) {
+            current = process_line(current, line);
+        }
+        std::ostringstream messages;
+        std::cerr.rdbuf(messages.rdbuf());
+        auto res = registers;
+        process_batch(res, line);
+        std::cerr.rdbuf(saved);
+        for (std::size_t k = 0; k < registers.size(); ++k) {
+            EXPECT_TRUE(same_bits(expected[k], res[k]) || (std::isnan(expected[k]) && std::isnan(res[k]))) << line << " at " << registers[k];
+        }
+        // the messages of SQRT depend on the register, the rest is printed once
+        if (messages.str().find("SQRT") == std::string::npos && !messages.str().empty()) {
+            EXPECT_EQ(0u, expected_messages.str().size() % messages.str().size()) << line;
+            EXPECT_EQ(expected_messages.str().substr(0, messages.str().size()), messages.str()) << line;
+        }
+        else {
+            EXPECT_EQ(expected_messages.str(), messages.str()) << line;
+        }
+        registers = res;
+    }
+}
@@ -0,0 +1,229 @@
+#include "server.h"
+#include "wal.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+using Records = std::vector<std::pair<std::string, std::string>>;
+
+Records replay(const std::string & path)
+{
+    Records res;
+    calc::CommandLog log;
+    EXPECT_TRUE(log.open(path, [&](const std::string_view session, const std::string_view line) {
+        res.emplace_back(session, line);
+    }));
+    return res;
+}
+
+int connect_to(const std::string & path)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    EXPECT_EQ(0, connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)));
+    return fd;
+}
+
+// sends the script and reads the results until the server closes the connection
+std::string run_script(const std::string & path, const std::string & script)
+{
+    const int fd = connect_to(path);
+    EXPECT_EQ(static_cast<ssize_t>(script.size()), write(fd, script.data(), script.size()));
+    shutdown(fd, SHUT_WR);
+    std::string res;
+    char buffer[256];
+    for (ssize_t n; (n = read(fd, buffer, sizeof(buffer))) > 0;) {
+        res.append(buffer, static_cast<std::size_t>(n));
+    }
+    close(fd);
+    return res;
+}
+
+} // anonymous namespace
+
+TEST(CommandLog, replay)
+{
+    const std::string path = testing::TempDir() + "calc_fold_wal_test";
+    std::remove(path.c_str());
+    {
+        calc::CommandLog log;
+        ASSERT_TRUE(log.open(path, [](std::string_view, std::string_view) { FAIL(); }));
+        log.append("a", "+ 1");
+        log.append("b", "");
+        ASSERT_TRUE(log.commit());
+        log.append("a", "(+) 1 2");
+        ASSERT_TRUE(log.commit());
+        EXPECT_EQ(2U, log.commits());
+    }
+    const Records expected = {{"a", "+ 1"}, {"b", ""}, {"a", "(+) 1 2"}};
+    EXPECT_EQ(expected, replay(path));
+    // a torn last record is dropped, the next ones follow the good ones
+    const off_t size = std::ifstream(path, std::ios::ate).tellg();
+    ASSERT_EQ(0, truncate(path.c_str(), size - 3));
+    {
+        calc::CommandLog log;
+        ASSERT_TRUE(log.open(path, [](std::string_view, std::string_view) {}));
+        log.append("c", "* 2");
+        ASSERT_TRUE(log.commit());
+    }
+    const Records recovered = {{"a", "+ 1"}, {"b", ""}, {"c", "* 2"}};
+    EXPECT_EQ(recovered, replay(path));
+    // so is a corrupted one
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-1, std::ios::end);
+        file.put('3');
+    }
+    EXPECT_EQ(Records(recovered.begin(), recovered.begin() + 2), replay(path));
+    std::remove(path.c_str());
+}
+
+TEST(Server, sessions)
+{
+    calc::ServerConfig config;
+    config.socket_path = testing::TempDir() + "calc_fold_server_test.sock";
+    config.log_path = testing::TempDir() + "calc_fold_server_test.log";
+    std::remove(config.log_path.c_str());
+    {
+        calc::Server server(config);
+        ASSERT_TRUE(server.open());
+        std::thread serving([&] { EXPECT_TRUE(server.run()); });
+        EXPECT_EQ("5\n10\n", run_script(config.socket_path, "+ 5\n@session b\n(+) {\n1 2\n3 4\n}\n"));
+        EXPECT_EQ("12\n3\n", run_script(config.socket_path, "@session b\n+ 2\n@session default\n- 2\n"));
+        // the block stays open, nothing to print yet
+        EXPECT_EQ("", run_script(config.socket_path, "(+) {\n1 2"));
+        EXPECT_EQ("1\n", run_script(config.socket_path, "@session " + std::string(255, 'n') + "\n+ 1\n"));
+        testing::internal::CaptureStderr();
+        EXPECT_EQ("", run_script(config.socket_path, "@session " + std::string(256, 'n') + "\n"));
+        EXPECT_NE(std::string::npos, testing::internal::GetCapturedStderr().find("Bad session name"));
+        server.stop();
+        serving.join();
+        EXPECT_EQ(3, server.current("default"));
+        EXPECT_EQ(12, server.current("b"));
+        EXPECT_FALSE(server.current("c"));
+    }
+    // a restart recovers the registers and the open fold block
+    calc::Server server(config);
+    ASSERT_TRUE(server.open());
+    EXPECT_EQ(3, server.current("default"));
+    EXPECT_EQ(12, server.current("b"));
+    std::thread serving([&] { EXPECT_TRUE(server.run()); });
+    EXPECT_EQ("6\n", run_script(config.socket_path, "}\n"));
+    server.stop();
+    serving.join();
+    std::remove(config.log_path.c_str());
+}
+
+TEST(Server, group_commit)
+{
+    calc::ServerConfig config;
+    config.socket_path = testing::TempDir() + "calc_fold_group_test.sock";
+    config.log_path = testing::TempDir() + "calc_fold_group_test.log";
+    config.commit_window = std::chrono::milliseconds(50);
+    std::remove(config.log_path.c_str());
+    calc::Server server(config);
+    ASSERT_TRUE(server.open());
+    std::thread serving([&] { EXPECT_TRUE(server.run()); });
+    std::string script;
+    for (int k = 0; k < 1000; ++k) {
+        script += "+ 1\n";
+    }
+    std::vector<std::thread> clients;
+    for (int k = 0; k < 4; ++k) {
+        clients.emplace_back([&, k] {
+            const auto results = run_script(config.socket_path, "@session " + std::to_string(k) + "\n" + script);
+            EXPECT_EQ(1000, std::count(results.begin(), results.end(), '\n'));
+            EXPECT_EQ("1000\n", results.substr(results.size() - 5));
+        });
+    }
+    for (auto & client : clients) {
+        client.join();
+    }
+    server.stop();
+    serving.join();
+    // far fewer syncs than commands
+    EXPECT_LT(server.commits(), 100U);
+    EXPECT_EQ(4000U, replay(config.log_path).size());
+    std::remove(config.log_path.c_str());
+}
+
+TEST(Server, register_table)
+{
+    calc::ServerConfig config;
+    config.socket_path = testing::TempDir() + "calc_fold_table_test.sock";
+    config.registers_path = testing::TempDir() + "calc_fold_table_test";
+    config.log_path = testing::TempDir() + "calc_fold_table_test.log";
+    std::remove(config.registers_path.c_str());
+    std::remove(config.log_path.c_str());
+    {
+        calc::Server server(config);
+        ASSERT_TRUE(server.open());
+        std::thread serving([&] { EXPECT_TRUE(server.run()); });
+        EXPECT_EQ("5\n7\n7\n", run_script(config.socket_path, "+ 5\n@session b\n+ 7\n> $v\n(+) {\n1\n"));
+        // the table keeps shorter names
+        testing::internal::CaptureStderr();
+        EXPECT_EQ("1\n", run_script(config.socket_path, "@session " + std::string(calc::RegisterTable::max_name, 'n') + "\n+ 1\n"));
+        EXPECT_EQ("", run_script(config.socket_path, "@session " + std::string(calc::RegisterTable::max_name + 1, 'n') + "\n"));
+        EXPECT_NE(std::string::npos, testing::internal::GetCapturedStderr().find("Bad session name"));
+        server.stop();
+        serving.join();
+    }
+    // with the log the variables and the open block are back too
+    {
+        calc::Server server(config);
+        ASSERT_TRUE(server.open());
+        std::thread serving([&] { EXPECT_TRUE(server.run()); });
+        EXPECT_EQ("8\n15\n", run_script(config.socket_path, "@session b\n}\n+ $v\n"));
+        server.stop();
+        serving.join();
+    }
+    // without it, only the registers
+    std::remove(config.log_path.c_str());
+    config.log_path.clear();
+    calc::Server server(config);
+    ASSERT_TRUE(server.open());
+    EXPECT_EQ(5, server.current("default"));
+    EXPECT_EQ(15, server.current("b"));
+    std::remove(config.registers_path.c_str());
+}
+
+TEST(Server, prepared)
+{
+    calc::ServerConfig config;
+    config.socket_path = testing::TempDir() + "calc_fold_prepared_test.sock";
+    config.log_path = testing::TempDir() + "calc_fold_prepared_test.log";
+    config.max_script_lines = 4;
+    std::remove(config.log_path.c_str());
+    calc::Server server(config);
+    ASSERT_TRUE(server.open());
+    std::thread serving([&] { EXPECT_TRUE(server.run()); });
+    EXPECT_EQ("@prepared 1\n5\n", run_script(config.socket_path, "@prepare\n+ 1\n(*) {\n2 3\n}\n@end\n+ 5\n"));
+    // another connection, the same script and its handle
+    EXPECT_EQ("@prepared 1\n6\n12\n-6\n", run_script(config.socket_path, "@prepare\n+ 1\n(*) {\n2 3\n}\n@end\n@execute 1 0 1 -2\n"));
+    EXPECT_EQ("@error\n@error\n@error\n@prepared 2\n", run_script(config.socket_path, "@execute 7 1\n@execute 1 x\n@prepare\n(+) {\n@end\n@prepare\nSQRT\n@end\n"));
+    // a malformed line leaves the registers as they are
+    EXPECT_EQ("@prepared 3\n12\n", run_script(config.socket_path, "@prepare\n+ 1\n/ 0\n* 2\n@end\n@execute 3 5\n"));
+    // the lines past the limit don't reach the session either
+    EXPECT_EQ("@error\n", run_script(config.socket_path, "@prepare\n+ 1\n+ 2\n+ 3\n+ 4\n+ 5\n@end\n"));
+    server.stop();
+    serving.join();
+    // the sessions don't see any of it
+    EXPECT_EQ(5, server.current("default"));
+    EXPECT_EQ(1U, replay(config.log_path).size());
+    std::remove(config.log_path.c_str());
+}